@@ -0,0 +1,97 @@
+#include "stdafx.h"
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef HEADLESS_COUNT_ALLOCATIONS
+
+namespace
+{
+	thread_local uint64_t t_AllocationCount = 0;
+
+	void* CountedAllocate(std::size_t size)
+	{
+		++t_AllocationCount;
+		return std::malloc(size == 0 ? 1 : size);
+	}
+}
+
+bool AllocationCounter::IsEnabled()
+{
+	return true;
+}
+
+uint64_t AllocationCounter::GetThreadCount()
+{
+	return t_AllocationCount;
+}
+
+void* operator new(std::size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (pMemory == nullptr) throw std::bad_alloc();
+	return pMemory;
+}
+
+void* operator new[](std::size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (pMemory == nullptr) throw std::bad_alloc();
+	return pMemory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	std::free(pMemory);
+}
+
+#else
+
+bool AllocationCounter::IsEnabled()
+{
+	return false;
+}
+
+uint64_t AllocationCounter::GetThreadCount()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+//-----------------------------------------------------------------
+// ALLOCATION COUNTER
+// Counts every call to the global operator new, per thread, in builds
+// with HEADLESS_COUNT_ALLOCATIONS defined (Debug builds, or the CMake
+// option of the same name). FrameArena only sees its own heap blocks;
+// this also catches std::vector, std::string and everything else.
+//-----------------------------------------------------------------
+namespace AllocationCounter
+{
+	// False when the counting operator new isn't built in, the count stays 0 then
+	bool IsEnabled();
+	// Calls to operator new on this thread so far
+	uint64_t GetThreadCount();
+}
@@ -0,0 +1,92 @@
+#include "stdafx.h"
+
+#include "EpisodeRunner.h"
+#include "TestBoxPlugin.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+SampleSummary Summarize(const std::vector<double>& samples)
+{
+	SampleSummary summary;
+	summary.Samples = (int)samples.size();
+	if (samples.empty())
+		return summary;
+
+	double sum = 0.0;
+	for (double sample : samples) sum += sample;
+	summary.Mean = sum / samples.size();
+
+	if (samples.size() > 1)
+	{
+		double squaredDeviations = 0.0;
+		for (double sample : samples) squaredDeviations += (sample - summary.Mean) * (sample - summary.Mean);
+		summary.StdDev = sqrt(squaredDeviations / (samples.size() - 1));
+		summary.HalfWidth95 = 1.96 * summary.StdDev / sqrt((double)samples.size());
+	}
+	return summary;
+}
+
+EpisodeResult RunEpisode(const EpisodeConfig& config)
+{
+	EpisodeResult result;
+
+	HeadlessWorld world(config.Seed);
+	if (!world.LoadLevel(config.LevelPath))
+		return result;
+	world.Initialize(config.Params);
+
+	HeadlessWorld::SetActive(&world);
+	TestBoxPlugin* pPlugin = new TestBoxPlugin();
+	HeadlessWorld::SetActive(nullptr);
+
+	pPlugin->SetLevelPath(config.LocalNavigation ? config.LevelPath : std::string());
+	if (config.FleeWeightNearEnemies >= 0.0f)
+	{
+		pPlugin->SetFleeWeightNearEnemies(config.FleeWeightNearEnemies);
+	}
+	pPlugin->Start();
+	for (int tick = 0; tick < config.MaxTicks && !world.IsAgentDead(); tick++)
+	{
+		pPlugin->UpdateInternal(config.DeltaTime);
+	}
+	pPlugin->End();
+	SafeDelete(pPlugin);
+
+	result.Completed = true;
+	result.Stats = world.GetStats();
+	return result;
+}
+
+void RunEpisodes(const std::vector<EpisodeConfig>& configs, int threadCount, std::vector<EpisodeResult>& results)
+{
+	results.assign(configs.size(), EpisodeResult());
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	threadCount = std::min(threadCount, std::max((int)configs.size(), 1));
+
+	// Episodes vary a lot in length, so threads pull the next one instead of taking fixed chunks
+	std::atomic<size_t> nextEpisode(0);
+	auto worker = [&]()
+	{
+		for (size_t i = nextEpisode++; i < configs.size(); i = nextEpisode++)
+		{
+			results[i] = RunEpisode(configs[i]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "HeadlessWorld.h"
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------
+// EPISODE RUNNER
+// Runs independent episodes of TestBoxPlugin, each in its own
+// HeadlessWorld, spread over a pool of threads. Worlds and plugins
+// bind per thread (see HeadlessWorld::SetActive), so episodes share
+// nothing. Results are stored by episode index, so they don't
+// depend on the thread count.
+//-----------------------------------------------------------------
+struct EpisodeConfig
+{
+	std::string LevelPath;
+	unsigned int Seed = 0;
+	GameDebugParams Params;
+	int MaxTicks = 100000;
+	float DeltaTime = 0.016f;
+	bool LocalNavigation = true;
+	float FleeWeightNearEnemies = -1.0f; // < 0 keeps the plugin's default
+};
+
+struct EpisodeResult
+{
+	bool Completed = false; // False when the level couldn't be loaded
+	HeadlessStats Stats;
+};
+
+// Mean with a 95% confidence interval (normal approximation)
+struct SampleSummary
+{
+	double Mean = 0.0;
+	double StdDev = 0.0;
+	double HalfWidth95 = 0.0;
+	int Samples = 0;
+};
+SampleSummary Summarize(const std::vector<double>& samples);
+
+EpisodeResult RunEpisode(const EpisodeConfig& config);
+// threadCount <= 0 uses every hardware thread
+void RunEpisodes(const std::vector<EpisodeConfig>& configs, int threadCount, std::vector<EpisodeResult>& results);
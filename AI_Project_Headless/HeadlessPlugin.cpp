@@ -0,0 +1,224 @@
+#include "stdafx.h"
+
+#include "IBehaviourPlugin.h"
+#include "AllocationCounter.h"
+#include "HeadlessPlugin.h"
+#include "HeadlessWorld.h"
+#include "TickTrace.h"
+
+#include <cstdarg>
+
+//-----------------------------------------------------------------
+// IBehaviourPlugin implementation for the headless host.
+// Every call is forwarded to the HeadlessWorld that was active on
+// this thread when the plugin was constructed, or answered from the
+// active replay trace.
+//-----------------------------------------------------------------
+namespace
+{
+	thread_local TickTraceReader* g_pActiveReplay = nullptr;
+	thread_local UpdateAllocationStats g_UpdateAllocations;
+	thread_local uint64_t g_FrameworkAllocations = 0; // This tick
+
+	// Counts what a framework call allocates, only the ones that return containers need it
+	class FrameworkAllocationScope final
+	{
+	public:
+		FrameworkAllocationScope() : m_Before(AllocationCounter::GetThreadCount()) {}
+		~FrameworkAllocationScope() { g_FrameworkAllocations += AllocationCounter::GetThreadCount() - m_Before; }
+
+	private:
+		uint64_t m_Before;
+	};
+}
+
+void HeadlessPlugin::SetActiveReplay(TickTraceReader* pTrace)
+{
+	g_pActiveReplay = pTrace;
+}
+
+TickTraceReader* HeadlessPlugin::GetActiveReplay()
+{
+	return g_pActiveReplay;
+}
+
+const UpdateAllocationStats& HeadlessPlugin::GetUpdateAllocations()
+{
+	return g_UpdateAllocations;
+}
+
+class IBehaviourPlugin::Impl
+{
+public:
+	Impl(HeadlessWorld* pWorld, TickTraceReader* pReplay) :
+		pWorld(pWorld),
+		pReplay(pReplay)
+	{
+		if (pWorld == nullptr && pReplay == nullptr)
+		{
+			printf("WARNING: No active HeadlessWorld, plugin runs in an empty world\n");
+			pOwnedWorld.reset(new HeadlessWorld());
+			this->pWorld = pOwnedWorld.get();
+		}
+	}
+
+	HeadlessWorld* pWorld = nullptr;
+	std::unique_ptr<HeadlessWorld> pOwnedWorld;
+	TickTraceReader* pReplay = nullptr;
+};
+
+IBehaviourPlugin::IBehaviourPlugin(GameDebugParams params) :
+	_impl(new Impl(HeadlessWorld::GetActive(), HeadlessPlugin::GetActiveReplay()))
+{
+	if (_impl->pReplay == nullptr && !_impl->pWorld->IsInitialized())
+	{
+		_impl->pWorld->Initialize(params);
+	}
+	g_UpdateAllocations = UpdateAllocationStats();
+}
+
+IBehaviourPlugin::~IBehaviourPlugin()
+{
+}
+
+void IBehaviourPlugin::UpdateInternal(float dt)
+{
+	const uint64_t allocationsBefore = AllocationCounter::GetThreadCount();
+	g_FrameworkAllocations = 0;
+	PluginOutput output = Update(dt);
+	const uint64_t allocations = AllocationCounter::GetThreadCount() - allocationsBefore;
+
+	UpdateAllocationStats& stats = g_UpdateAllocations;
+	stats.Allocations += allocations;
+	if (allocations > stats.MaxPerTick) stats.MaxPerTick = allocations;
+	if (++stats.Ticks > UpdateAllocationStats::WarmupTicks)
+	{
+		++stats.SteadyTicks;
+		stats.SteadyAllocations += allocations;
+		stats.SteadyFrameworkAllocations += g_FrameworkAllocations;
+		stats.SteadyTicksAllocating += allocations > g_FrameworkAllocations ? 1 : 0;
+	}
+
+	if (_impl->pReplay != nullptr)
+	{
+		_impl->pReplay->EndTick(output);
+	}
+	else
+	{
+		_impl->pWorld->Step(output, dt);
+	}
+}
+
+void IBehaviourPlugin::RenderInternal(float /*dt*/)
+{
+}
+
+//INVENTORY
+bool IBehaviourPlugin::INVENTORY_AddItem(int slotId, ItemInfo item)
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadInventoryAdd(slotId, item);
+	return _impl->pWorld->InventoryAddItem(slotId, item);
+}
+
+bool IBehaviourPlugin::INVENTORY_UseItem(int slotId)
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadInventoryUse(slotId);
+	return _impl->pWorld->InventoryUseItem(slotId);
+}
+
+bool IBehaviourPlugin::INVENTORY_RemoveItem(int slotId)
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadInventoryRemove(slotId);
+	return _impl->pWorld->InventoryRemoveItem(slotId);
+}
+
+bool IBehaviourPlugin::INVENTORY_GetItem(int slotId, ItemInfo& item)
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadInventoryGet(slotId, item);
+	return _impl->pWorld->InventoryGetItem(slotId, item);
+}
+
+int IBehaviourPlugin::INVENTORY_GetCapacity() const
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadInventoryCapacity();
+	return _impl->pWorld->InventoryGetCapacity();
+}
+
+//WORLD INFO
+WorldInfo IBehaviourPlugin::WORLD_GetInfo() const
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadWorldInfo();
+	return _impl->pWorld->GetWorldInfo();
+}
+
+//FOV
+std::vector<EntityInfo> IBehaviourPlugin::FOV_GetEntities() const
+{
+	FrameworkAllocationScope allocationScope;
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadEntities();
+	return _impl->pWorld->GetEntitiesInFOV();
+}
+
+std::vector<HouseInfo> IBehaviourPlugin::FOV_GetHouses() const
+{
+	FrameworkAllocationScope allocationScope;
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadHouses();
+	return _impl->pWorld->GetHousesInFOV();
+}
+
+//ITEM
+bool IBehaviourPlugin::ITEM_Grab(EntityInfo entity, ItemInfo& item)
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadItemGrab(entity, item);
+	return _impl->pWorld->GrabItem(entity, item);
+}
+
+bool IBehaviourPlugin::GetItemMeta(ItemInfo item, std::string category, CheapVariant& val) const
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadItemMetadata(item, category, val);
+	return _impl->pWorld->GetItemMetadata(item, category, val);
+}
+
+//ENEMY
+bool IBehaviourPlugin::ENEMY_GetInfo(EntityInfo entity, EnemyInfo& enemy)
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadEnemyInfo(entity, enemy);
+	return _impl->pWorld->GetEnemyInfo(entity, enemy);
+}
+
+//MISC
+b2Vec2 IBehaviourPlugin::NAVMESH_GetClosestPathPoint(b2Vec2 goal) const
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadPathPoint(goal);
+	return _impl->pWorld->GetClosestPathPoint(goal);
+}
+
+AgentInfo IBehaviourPlugin::AGENT_GetInfo() const
+{
+	if (_impl->pReplay != nullptr) return _impl->pReplay->ReadAgentInfo();
+	return _impl->pWorld->GetAgentInfo();
+}
+
+//DEBUG HELPERS (Nothing to render to, only logging is kept when verbose)
+b2Vec2 IBehaviourPlugin::DEBUG_ConvertScreenPosToWorldPos(b2Vec2 screenPos)
+{
+	return screenPos;
+}
+
+void IBehaviourPlugin::DEBUG_LogMessage(std::string message, ...)
+{
+	if (_impl->pWorld == nullptr || !_impl->pWorld->IsVerbose())
+		return;
+
+	va_list args;
+	va_start(args, message);
+	vprintf(message.c_str(), args);
+	va_end(args);
+}
+
+void IBehaviourPlugin::DEBUG_DrawPoint(const b2Vec2& /*p*/, float /*size*/, const b2Color& /*color*/) {}
+void IBehaviourPlugin::DEBUG_DrawCircle(const b2Vec2& /*center*/, float /*radius*/, const b2Color& /*color*/) {}
+void IBehaviourPlugin::DEBUG_DrawSegment(const b2Vec2& /*p1*/, const b2Vec2& /*p2*/, const b2Color& /*color*/) {}
+void IBehaviourPlugin::DEBUG_DrawSolidCircle(const b2Vec2& /*center*/, float32 /*radius*/, const b2Vec2& /*axis*/, const b2Color& /*color*/) {}
+void IBehaviourPlugin::DEBUG_DrawSolidPolygon(const b2Vec2* /*points*/, int /*count*/, const b2Color& /*color*/, float /*depth*/, bool /*triangulate*/) {}
+void IBehaviourPlugin::DEBUG_DrawString(const b2Vec2& /*pw*/, const char* /*string*/, ...) {}
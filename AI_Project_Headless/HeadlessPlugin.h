@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+class TickTraceReader;
+
+// Global operator new calls made inside Update, see AllocationCounter.h
+struct UpdateAllocationStats
+{
+	static const int WarmupTicks = 1000; // Left out of the steady state, while buffers still grow
+
+	int Ticks = 0;
+	uint64_t Allocations = 0;
+	uint64_t MaxPerTick = 0;
+	int SteadyTicks = 0;
+	uint64_t SteadyAllocations = 0;
+	// Made by the framework, building the vectors FOV_GetEntities and FOV_GetHouses return by value
+	uint64_t SteadyFrameworkAllocations = 0;
+	int SteadyTicksAllocating = 0; // In the plugin itself
+};
+
+//-----------------------------------------------------------------
+// Binds the next IBehaviourPlugin constructed on this thread to a
+// recorded trace instead of the active HeadlessWorld: every query
+// is answered from the trace and the returned PluginOutput is
+// checked against the recorded one.
+//-----------------------------------------------------------------
+namespace HeadlessPlugin
+{
+	void SetActiveReplay(TickTraceReader* pTrace);
+	TickTraceReader* GetActiveReplay();
+
+	// For the last plugin constructed on this thread, all zero unless AllocationCounter::IsEnabled
+	const UpdateAllocationStats& GetUpdateAllocations();
+}
@@ -0,0 +1,65 @@
+#include "stdafx.h"
+
+#include <chrono>
+
+//-----------------------------------------------------------------
+// The few Box2D and ImGui symbols the plugin sources link against,
+// so the headless host builds without either library. Nothing is
+// drawn headless, so the ImGui calls do nothing, and b2Timer is
+// backed by the steady clock.
+// Only built when HEADLESS_LINK_LIBRARIES is off, see CMakeLists.txt.
+//-----------------------------------------------------------------
+namespace
+{
+	double GetSteadyMilliseconds()
+	{
+		const auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration<double, std::milli>(sinceEpoch).count();
+	}
+}
+
+const b2Vec2 b2Vec2_zero(0.0f, 0.0f);
+
+#if defined(_WIN32)
+float64 b2Timer::s_invFrequency = 0.0;
+
+b2Timer::b2Timer()
+{
+	Reset();
+}
+
+void b2Timer::Reset()
+{
+	m_start = GetSteadyMilliseconds();
+}
+
+float32 b2Timer::GetMilliseconds() const
+{
+	return (float32)(GetSteadyMilliseconds() - m_start);
+}
+#else
+b2Timer::b2Timer()
+{
+	Reset();
+}
+
+void b2Timer::Reset()
+{
+	const double milliseconds = GetSteadyMilliseconds();
+	m_start_sec = (unsigned long)(milliseconds / 1000.0);
+	m_start_usec = (unsigned long)((milliseconds - m_start_sec * 1000.0) * 1000.0);
+}
+
+float32 b2Timer::GetMilliseconds() const
+{
+	const double start = m_start_sec * 1000.0 + m_start_usec / 1000.0;
+	return (float32)(GetSteadyMilliseconds() - start);
+}
+#endif
+
+namespace ImGui
+{
+	void Text(const char* /*fmt*/, ...) {}
+	void TextColored(const ImVec4& /*col*/, const char* /*fmt*/, ...) {}
+	bool Button(const char* /*label*/, const ImVec2& /*size*/) { return false; }
+}
@@ -0,0 +1,612 @@
+#include "stdafx.h"
+
+#include "HeadlessWorld.h"
+
+
+namespace
+{
+	thread_local HeadlessWorld* s_pActiveWorld = nullptr;
+
+	const float AgentAcceleration = 10.0f; // Fraction of the steering applied per second
+	const float EnemySightRange = 20.0f;
+	const float EnemyBiteRange = 1.5f;
+	const float EnemyBiteCooldown = 1.5f;
+	const float EnergyDrainPerSecond = 0.1f;
+	const float StarvationDamagePerSecond = 0.2f;
+	const float ShootConeAngle = 0.15f; // Radians either side of the facing direction
+
+	void PolygonBounds(const GpplPolygon& polygon, b2Vec2& min, b2Vec2& max)
+	{
+		min = b2Vec2(FLT_MAX, FLT_MAX);
+		max = b2Vec2(-FLT_MAX, -FLT_MAX);
+		for (const b2Vec2& p : polygon)
+		{
+			min = b2Min(min, p);
+			max = b2Max(max, p);
+		}
+	}
+}
+
+HeadlessWorld::HeadlessWorld(unsigned int seed) :
+	m_Random(seed)
+{
+	m_WorldInfo.Center = b2Vec2_zero;
+	m_WorldInfo.Dimensions = b2Vec2(300.0f, 300.0f);
+}
+
+void HeadlessWorld::SetActive(HeadlessWorld* pWorld)
+{
+	s_pActiveWorld = pWorld;
+}
+
+HeadlessWorld* HeadlessWorld::GetActive()
+{
+	return s_pActiveWorld;
+}
+
+bool HeadlessWorld::LoadLevel(const std::string& path)
+{
+	if (!m_Level.Open(path))
+	{
+		m_Houses = {};
+		m_Navigation.Clear();
+		return false;
+	}
+
+	m_WorldInfo = m_Level.GetWorldInfo();
+	m_Houses = m_Level.GetHouses();
+	m_Navigation.Build(m_Level);
+	m_CachedPathStartCell = -1;
+	m_CachedPathGoalCell = -1;
+	return true;
+}
+
+void HeadlessWorld::Initialize(const GameDebugParams& params)
+{
+	m_Params = params;
+	if (!m_Params.OverrideDifficulty)
+	{
+		m_Params.Difficulty = GameDebugParams().Difficulty;
+	}
+
+	m_Agent = {};
+	m_Agent.Health = m_MaxHealth;
+	m_Agent.Energy = m_MaxEnergy;
+	m_Agent.Stamina = m_MaxStamina;
+	m_Agent.GrabRange = 2.5f;
+	m_Agent.FOV_Angle = 1.0f;
+	m_Agent.FOV_Range = 25.0f;
+	m_Agent.MaxLinearSpeed = 6.0f;
+	m_Agent.MaxAngularSpeed = 5.0f;
+	m_Agent.AgentSize = 1.0f;
+	m_Agent.Position = m_WorldInfo.Center;
+
+	m_Inventory.assign(5, WorldItem{});
+
+	m_Enemies.clear();
+	for (int i = 0; i < m_Params.EnemySpawnAmount; i++)
+	{
+		SpawnEnemy();
+	}
+
+	m_GroundItems.clear();
+	m_ItemsOnGroundTarget = (int)m_Houses.size() * 2;
+	for (int i = 0; i < m_ItemsOnGroundTarget; i++)
+	{
+		SpawnItem();
+	}
+
+	m_Stats = {};
+	m_Initialized = true;
+}
+
+void HeadlessWorld::Step(const PluginOutput& output, float dt)
+{
+	if (m_Agent.Death)
+		return;
+
+	m_Agent.Bitten = false;
+
+	StepAgent(output, dt);
+	StepEnemies(dt);
+
+	if (m_Agent.Health <= 0.0f)
+	{
+		m_Agent.Health = 0.0f;
+		m_Agent.Death = true;
+		m_Stats.Died = true;
+	}
+
+	m_Stats.SecondsSurvived += dt;
+	++m_Stats.TicksSimulated;
+}
+
+void HeadlessWorld::StepAgent(const PluginOutput& output, float dt)
+{
+	m_Agent.RunMode = output.RunMode && m_Agent.Stamina > 0.0f;
+	const float maxSpeed = m_Agent.MaxLinearSpeed * (m_Agent.RunMode ? 2.0f : 1.0f);
+
+	// The plugin outputs steering (desired - current), integrate it like the framework's rigid body would
+	b2Vec2 velocity = m_Agent.LinearVelocity + output.LinearVelocity * std::min(1.0f, AgentAcceleration * dt);
+	velocity = Clamp(velocity, maxSpeed);
+	if (!velocity.IsValid())
+	{
+		velocity = b2Vec2_zero;
+	}
+
+	m_Agent.LinearVelocity = velocity;
+	m_Agent.CurrentLinearSpeed = velocity.Length();
+	m_Agent.Position += velocity * dt;
+	ResolveWallCollisions(m_Agent.Position, m_Agent.AgentSize * 0.5f);
+
+	const b2Vec2 halfDimensions = m_WorldInfo.Dimensions / 2.0f;
+	m_Agent.Position = b2Clamp(m_Agent.Position, m_WorldInfo.Center - halfDimensions, m_WorldInfo.Center + halfDimensions);
+
+	if (output.AutoOrientate)
+	{
+		if (m_Agent.CurrentLinearSpeed > 0.01f)
+		{
+			m_Agent.Orientation = GetOrientationFromVelocity(velocity);
+		}
+		m_Agent.AngularVelocity = 0.0f;
+	}
+	else
+	{
+		m_Agent.AngularVelocity = Clamp(output.AngularVelocity, -m_Agent.MaxAngularSpeed, m_Agent.MaxAngularSpeed);
+		m_Agent.Orientation += m_Agent.AngularVelocity * dt;
+	}
+
+	if (m_Agent.RunMode)
+	{
+		m_Agent.Stamina = std::max(0.0f, m_Agent.Stamina - 2.0f * dt);
+	}
+	else
+	{
+		m_Agent.Stamina = std::min(m_MaxStamina, m_Agent.Stamina + dt);
+	}
+
+	if (!m_Params.IgnoreEnergy)
+	{
+		m_Agent.Energy = std::max(0.0f, m_Agent.Energy - EnergyDrainPerSecond * dt);
+		if (m_Agent.Energy <= 0.0f)
+		{
+			m_Agent.Health -= StarvationDamagePerSecond * dt;
+		}
+	}
+
+	m_Agent.IsInHouse = false;
+	for (const GpplHouse& house : m_Houses)
+	{
+		if (PointInAABB(m_Agent.Position, house.Info.Center, house.Info.Size))
+		{
+			m_Agent.IsInHouse = true;
+			break;
+		}
+	}
+}
+
+void HeadlessWorld::StepEnemies(float dt)
+{
+	const float speed = 2.0f + 2.0f * m_Params.Difficulty;
+	std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+
+	for (WorldEnemy& enemy : m_Enemies)
+	{
+		const b2Vec2 toAgent = m_Agent.Position - enemy.Entity.Position;
+		const float distSqr = toAgent.LengthSquared();
+
+		b2Vec2 direction;
+		if (distSqr < EnemySightRange * EnemySightRange)
+		{
+			direction = toAgent;
+		}
+		else
+		{
+			enemy.WanderAngle += jitter(m_Random) * dt * 2.0f;
+			direction = b2Vec2(cos(enemy.WanderAngle), sin(enemy.WanderAngle));
+		}
+		direction.Normalize();
+
+		enemy.Velocity = direction * speed;
+		enemy.Entity.Position += enemy.Velocity * dt;
+		ResolveWallCollisions(enemy.Entity.Position, 0.5f);
+
+		const b2Vec2 halfDimensions = m_WorldInfo.Dimensions / 2.0f;
+		enemy.Entity.Position = b2Clamp(enemy.Entity.Position, m_WorldInfo.Center - halfDimensions, m_WorldInfo.Center + halfDimensions);
+
+		enemy.BiteCooldown = std::max(0.0f, enemy.BiteCooldown - dt);
+		if (enemy.BiteCooldown <= 0.0f && b2DistanceSquared(enemy.Entity.Position, m_Agent.Position) < EnemyBiteRange * EnemyBiteRange)
+		{
+			enemy.BiteCooldown = EnemyBiteCooldown;
+			m_Agent.Bitten = true;
+			++m_Stats.TimesBitten;
+			if (!m_Params.GodMode)
+			{
+				m_Agent.Health -= 1.0f;
+			}
+		}
+	}
+}
+
+void HeadlessWorld::Shoot(const WorldItem& pistol)
+{
+	++m_Stats.ShotsFired;
+
+	const b2Vec2 facing = FacingDirection();
+	auto hitIter = m_Enemies.end();
+	float closestDist = pistol.Range;
+	for (auto iter = m_Enemies.begin(); iter != m_Enemies.end(); ++iter)
+	{
+		b2Vec2 toEnemy = iter->Entity.Position - m_Agent.Position;
+		const float dist = toEnemy.Normalize();
+		if (dist < closestDist && acos(Clamp(b2Dot(facing, toEnemy), -1.0f, 1.0f)) < ShootConeAngle)
+		{
+			closestDist = dist;
+			hitIter = iter;
+		}
+	}
+
+	if (hitIter == m_Enemies.end())
+		return;
+
+	hitIter->Info.Health -= std::max(1, (int)pistol.DPS);
+	if (hitIter->Info.Health <= 0)
+	{
+		++m_Stats.EnemiesKilled;
+		m_Enemies.erase(hitIter);
+		SpawnEnemy(); // Keep the population stable
+	}
+}
+
+std::vector<EntityInfo> HeadlessWorld::GetEntitiesInFOV() const
+{
+	std::vector<EntityInfo> entities;
+	for (const WorldEnemy& enemy : m_Enemies)
+	{
+		if (PointInFOV(enemy.Entity.Position))
+		{
+			entities.push_back(enemy.Entity);
+		}
+	}
+	for (const WorldItem& item : m_GroundItems)
+	{
+		if (PointInFOV(item.Entity.Position))
+		{
+			entities.push_back(item.Entity);
+		}
+	}
+	return entities;
+}
+
+std::vector<HouseInfo> HeadlessWorld::GetHousesInFOV() const
+{
+	std::vector<HouseInfo> houses;
+
+	// Inside a house you only see the house you're standing in
+	for (const GpplHouse& house : m_Houses)
+	{
+		if (PointInAABB(m_Agent.Position, house.Info.Center, house.Info.Size))
+		{
+			houses.push_back(house.Info);
+			return houses;
+		}
+	}
+
+	for (const GpplHouse& house : m_Houses)
+	{
+		const b2Vec2 halfSize = house.Info.Size / 2.0f;
+		const b2Vec2 closestPoint = b2Clamp(m_Agent.Position, house.Info.Center - halfSize, house.Info.Center + halfSize);
+		if (b2DistanceSquared(closestPoint, m_Agent.Position) < m_Agent.FOV_Range * m_Agent.FOV_Range)
+		{
+			houses.push_back(house.Info);
+		}
+	}
+	return houses;
+}
+
+bool HeadlessWorld::GrabItem(const EntityInfo& entity, ItemInfo& item) const
+{
+	const WorldItem* pItem = FindItemByEntity(entity.EntityHash);
+	if (pItem == nullptr)
+		return false;
+
+	if (b2DistanceSquared(pItem->Entity.Position, m_Agent.Position) > m_Agent.GrabRange * m_Agent.GrabRange)
+		return false;
+
+	item = pItem->Info;
+	return true;
+}
+
+bool HeadlessWorld::GetEnemyInfo(const EntityInfo& entity, EnemyInfo& enemy) const
+{
+	for (const WorldEnemy& worldEnemy : m_Enemies)
+	{
+		if (worldEnemy.Entity.EntityHash == entity.EntityHash)
+		{
+			enemy = worldEnemy.Info;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HeadlessWorld::GetItemMetadata(const ItemInfo& item, const std::string& category, CheapVariant& val) const
+{
+	const WorldItem* pItem = FindItemByItem(item.ItemHash);
+	if (pItem == nullptr)
+		return false;
+
+	switch (pItem->Info.Type)
+	{
+	case eItemType::PISTOL:
+		if (category == "ammo") { val = CheapVariant(pItem->Ammo); return true; }
+		if (category == "dps") { val = CheapVariant(pItem->DPS); return true; }
+		if (category == "range") { val = CheapVariant(pItem->Range); return true; }
+		break;
+	case eItemType::HEALTH:
+		if (category == "health") { val = CheapVariant(pItem->Amount); return true; }
+		break;
+	case eItemType::FOOD:
+		if (category == "energy") { val = CheapVariant(pItem->Amount); return true; }
+		break;
+	default:
+		break;
+	}
+	return false;
+}
+
+b2Vec2 HeadlessWorld::GetClosestPathPoint(const b2Vec2& goal) const
+{
+	if (!m_Navigation.IsBuilt() || m_Navigation.IsLineClear(m_Agent.Position, goal))
+		return goal;
+
+	// The plugin asks ten times a second, usually from the same cell
+	const int startCell = m_Navigation.CellAt(m_Agent.Position);
+	const int goalCell = m_Navigation.CellAt(goal);
+	if (startCell == m_CachedPathStartCell && goalCell == m_CachedPathGoalCell)
+		return m_CachedPathPoint;
+
+	m_CachedPathStartCell = startCell;
+	m_CachedPathGoalCell = goalCell;
+	m_CachedPathPoint = m_Navigation.GetClosestPathPoint(m_Agent.Position, goal);
+	return m_CachedPathPoint;
+}
+
+bool HeadlessWorld::InventoryAddItem(int slotId, const ItemInfo& item)
+{
+	if (slotId < 0 || slotId >= (int)m_Inventory.size() || m_Inventory[slotId].Info.ItemHash != 0)
+		return false;
+
+	for (auto iter = m_GroundItems.begin(); iter != m_GroundItems.end(); ++iter)
+	{
+		if (iter->Info.ItemHash == item.ItemHash)
+		{
+			if (iter->Info.Type != eItemType::GARBAGE)
+			{
+				++m_Stats.ItemsCollected;
+			}
+
+			m_Inventory[slotId] = *iter;
+			m_GroundItems.erase(iter);
+			SpawnItem(); // Keep the item density stable
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HeadlessWorld::InventoryUseItem(int slotId)
+{
+	if (slotId < 0 || slotId >= (int)m_Inventory.size() || m_Inventory[slotId].Info.ItemHash == 0)
+		return false;
+
+	WorldItem& item = m_Inventory[slotId];
+	switch (item.Info.Type)
+	{
+	case eItemType::PISTOL:
+		if (item.Ammo <= 0)
+			return false;
+		--item.Ammo;
+		Shoot(item);
+		break;
+	case eItemType::HEALTH:
+		m_Agent.Health = std::min(m_MaxHealth, m_Agent.Health + item.Amount);
+		item.Amount = 0;
+		break;
+	case eItemType::FOOD:
+		m_Agent.Energy = std::min(m_MaxEnergy, m_Agent.Energy + item.Amount);
+		item.Amount = 0;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+bool HeadlessWorld::InventoryRemoveItem(int slotId)
+{
+	if (slotId < 0 || slotId >= (int)m_Inventory.size() || m_Inventory[slotId].Info.ItemHash == 0)
+		return false;
+
+	m_Inventory[slotId] = WorldItem{};
+	return true;
+}
+
+bool HeadlessWorld::InventoryGetItem(int slotId, ItemInfo& item) const
+{
+	if (slotId < 0 || slotId >= (int)m_Inventory.size() || m_Inventory[slotId].Info.ItemHash == 0)
+		return false;
+
+	item = m_Inventory[slotId].Info;
+	return true;
+}
+
+bool HeadlessWorld::PointInFOV(const b2Vec2& point) const
+{
+	b2Vec2 toPoint = point - m_Agent.Position;
+	const float dist = toPoint.Normalize();
+	if (dist > m_Agent.FOV_Range)
+		return false;
+	if (dist < m_Agent.AgentSize * 2.0f) // Peripheral vision
+		return true;
+
+	return acos(Clamp(b2Dot(FacingDirection(), toPoint), -1.0f, 1.0f)) < m_Agent.FOV_Angle;
+}
+
+b2Vec2 HeadlessWorld::FacingDirection() const
+{
+	// Matches GetOrientationFromVelocity (zero orientation faces {0,-1})
+	return b2Vec2(sin(m_Agent.Orientation), -cos(m_Agent.Orientation));
+}
+
+b2Vec2 HeadlessWorld::RandomPointInWorld(float edgeBuffer)
+{
+	const b2Vec2 halfDimensions = m_WorldInfo.Dimensions / 2.0f - b2Vec2(edgeBuffer, edgeBuffer);
+	std::uniform_real_distribution<float> x(-halfDimensions.x, halfDimensions.x);
+	std::uniform_real_distribution<float> y(-halfDimensions.y, halfDimensions.y);
+	return m_WorldInfo.Center + b2Vec2(x(m_Random), y(m_Random));
+}
+
+b2Vec2 HeadlessWorld::RandomPointInHouse(const HouseInfo& house)
+{
+	// Stay clear of the walls
+	const b2Vec2 halfSize = house.Size / 2.0f - b2Vec2(3.0f, 3.0f);
+	std::uniform_real_distribution<float> x(-std::max(halfSize.x, 0.0f), std::max(halfSize.x, 0.0f));
+	std::uniform_real_distribution<float> y(-std::max(halfSize.y, 0.0f), std::max(halfSize.y, 0.0f));
+	return house.Center + b2Vec2(x(m_Random), y(m_Random));
+}
+
+void HeadlessWorld::ResolveWallCollisions(b2Vec2& position, float radius) const
+{
+	for (const GpplHouse& house : m_Houses)
+	{
+		// Cheap reject on the house bounds first
+		const b2Vec2 houseHalfSize = house.Info.Size / 2.0f + b2Vec2(radius + 1.0f, radius + 1.0f);
+		if (!PointInAABB(position, house.Info.Center, houseHalfSize * 2.0f))
+			continue;
+
+		for (const GpplPolygon& box : house.WallBoxes)
+		{
+			b2Vec2 min, max;
+			PolygonBounds(box, min, max);
+
+			const b2Vec2 closestPoint = b2Clamp(position, min, max);
+			b2Vec2 push = position - closestPoint;
+			const float distSqr = push.LengthSquared();
+			if (distSqr >= radius * radius)
+				continue;
+
+			if (distSqr > FLT_EPSILON)
+			{
+				const float dist = push.Normalize();
+				position += push * (radius - dist);
+			}
+			else
+			{
+				// Center is inside the wall, push out along the shallowest axis
+				const float left = position.x - min.x, right = max.x - position.x;
+				const float bottom = position.y - min.y, top = max.y - position.y;
+				const float smallest = std::min(std::min(left, right), std::min(bottom, top));
+				if (smallest == left) position.x = min.x - radius;
+				else if (smallest == right) position.x = max.x + radius;
+				else if (smallest == bottom) position.y = min.y - radius;
+				else position.y = max.y + radius;
+			}
+		}
+	}
+}
+
+void HeadlessWorld::SpawnEnemy()
+{
+	// Don't spawn on top of the agent
+	b2Vec2 position = RandomPointInWorld(5.0f);
+	for (int attempt = 0; attempt < 8 && b2DistanceSquared(position, m_Agent.Position) < EnemySightRange * EnemySightRange; attempt++)
+	{
+		position = RandomPointInWorld(5.0f);
+	}
+
+	std::uniform_real_distribution<float> angle(0.0f, 2.0f * b2_pi);
+
+	WorldEnemy enemy = {};
+	enemy.Entity.Type = eEntityType::ENEMY;
+	enemy.Entity.EntityHash = m_NextEntityHash++;
+	enemy.Entity.Position = position;
+	enemy.Info.EnemyHash = m_NextEnemyHash++;
+	enemy.Info.Health = 3 + (int)(2.0f * m_Params.Difficulty);
+	enemy.WanderAngle = angle(m_Random);
+	m_Enemies.push_back(enemy);
+}
+
+void HeadlessWorld::SpawnItem()
+{
+	if (m_Houses.empty())
+		return;
+
+	std::uniform_int_distribution<size_t> houseIndex(0, m_Houses.size() - 1);
+	std::uniform_int_distribution<int> type(0, 99);
+	std::uniform_int_distribution<int> ammo(5, 15);
+	std::uniform_real_distribution<float> dps(1.0f, 3.0f);
+	std::uniform_real_distribution<float> range(10.0f, 25.0f);
+	std::uniform_int_distribution<int> amount(1, 5);
+
+	WorldItem item = {};
+	item.Entity.Type = eEntityType::ITEM;
+	item.Entity.EntityHash = m_NextEntityHash++;
+	item.Entity.Position = RandomPointInHouse(m_Houses[houseIndex(m_Random)].Info);
+	item.Info.ItemHash = m_NextItemHash++;
+
+	const int roll = type(m_Random);
+	if (roll < 25)
+	{
+		item.Info.Type = eItemType::PISTOL;
+		item.Ammo = ammo(m_Random);
+		item.DPS = dps(m_Random);
+		item.Range = range(m_Random);
+	}
+	else if (roll < 50)
+	{
+		item.Info.Type = eItemType::HEALTH;
+		item.Amount = amount(m_Random);
+	}
+	else if (roll < 80)
+	{
+		item.Info.Type = eItemType::FOOD;
+		item.Amount = amount(m_Random);
+	}
+	else
+	{
+		item.Info.Type = eItemType::GARBAGE;
+	}
+
+	m_GroundItems.push_back(item);
+}
+
+HeadlessWorld::WorldItem* HeadlessWorld::FindItemByEntity(int entityHash)
+{
+	for (WorldItem& item : m_GroundItems)
+	{
+		if (item.Entity.EntityHash == entityHash)
+			return &item;
+	}
+	return nullptr;
+}
+
+const HeadlessWorld::WorldItem* HeadlessWorld::FindItemByEntity(int entityHash) const
+{
+	return const_cast<HeadlessWorld*>(this)->FindItemByEntity(entityHash);
+}
+
+const HeadlessWorld::WorldItem* HeadlessWorld::FindItemByItem(int itemHash) const
+{
+	for (const WorldItem& item : m_GroundItems)
+	{
+		if (item.Info.ItemHash == itemHash)
+			return &item;
+	}
+	for (const WorldItem& item : m_Inventory)
+	{
+		if (item.Info.ItemHash == itemHash)
+			return &item;
+	}
+	return nullptr;
+}
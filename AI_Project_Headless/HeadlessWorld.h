@@ -0,0 +1,135 @@
+#pragma once
+
+#include "GpplLevel.h"
+#include "HelperStructs.h"
+#include "NavigationGrid.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------
+// HEADLESS WORLD
+// Minimal stand-in for the closed framework: owns the agent, the
+// enemies, the items and the level geometry, and answers every
+// IBehaviourPlugin query without SDL, GL or a real-time clock.
+//-----------------------------------------------------------------
+struct HeadlessStats
+{
+	float SecondsSurvived = 0.0f;
+	int TicksSimulated = 0;
+	int ItemsCollected = 0; // Non-garbage items that ended up in the inventory
+	int EnemiesKilled = 0;
+	int ShotsFired = 0;
+	int TimesBitten = 0;
+	bool Died = false;
+};
+
+class HeadlessWorld final
+{
+public:
+	explicit HeadlessWorld(unsigned int seed = 0);
+	~HeadlessWorld() {}
+
+	// Makes this world the one the next constructed IBehaviourPlugin binds to (per thread)
+	static void SetActive(HeadlessWorld* pWorld);
+	static HeadlessWorld* GetActive();
+
+	bool LoadLevel(const std::string& path);
+	// Spawns agent, enemies and items. When not called by the host, the first
+	// IBehaviourPlugin bound to this world calls it with its own debug params
+	void Initialize(const GameDebugParams& params);
+	bool IsInitialized() const { return m_Initialized; }
+
+	// Integrates the plugin's output and advances the rest of the world
+	void Step(const PluginOutput& output, float dt);
+
+	//Framework queries
+	AgentInfo GetAgentInfo() const { return m_Agent; }
+	WorldInfo GetWorldInfo() const { return m_WorldInfo; }
+	std::vector<EntityInfo> GetEntitiesInFOV() const;
+	std::vector<HouseInfo> GetHousesInFOV() const;
+	bool GrabItem(const EntityInfo& entity, ItemInfo& item) const;
+	bool GetEnemyInfo(const EntityInfo& entity, EnemyInfo& enemy) const;
+	bool GetItemMetadata(const ItemInfo& item, const std::string& category, CheapVariant& val) const;
+	b2Vec2 GetClosestPathPoint(const b2Vec2& goal) const;
+
+	bool InventoryAddItem(int slotId, const ItemInfo& item);
+	bool InventoryUseItem(int slotId);
+	bool InventoryRemoveItem(int slotId);
+	bool InventoryGetItem(int slotId, ItemInfo& item) const;
+	int InventoryGetCapacity() const { return (int)m_Inventory.size(); }
+
+	const HeadlessStats& GetStats() const { return m_Stats; }
+	GpplSpan<GpplHouse> GetHouses() const { return m_Houses; }
+	bool IsAgentDead() const { return m_Agent.Death; }
+	void SetVerbose(bool verbose) { m_Verbose = verbose; }
+	bool IsVerbose() const { return m_Verbose; }
+
+private:
+	struct WorldItem
+	{
+		EntityInfo Entity;
+		ItemInfo Info;
+		int Ammo;
+		float DPS;
+		float Range;
+		int Amount; // Healing or energy
+	};
+
+	struct WorldEnemy
+	{
+		EntityInfo Entity;
+		EnemyInfo Info;
+		b2Vec2 Velocity;
+		float WanderAngle;
+		float BiteCooldown;
+	};
+
+	bool PointInFOV(const b2Vec2& point) const;
+	b2Vec2 FacingDirection() const;
+	b2Vec2 RandomPointInWorld(float edgeBuffer);
+	b2Vec2 RandomPointInHouse(const HouseInfo& house);
+	void ResolveWallCollisions(b2Vec2& position, float radius) const;
+
+	void SpawnEnemy();
+	void SpawnItem();
+	void StepAgent(const PluginOutput& output, float dt);
+	void StepEnemies(float dt);
+	void Shoot(const WorldItem& pistol);
+
+	WorldItem* FindItemByEntity(int entityHash);
+	const WorldItem* FindItemByEntity(int entityHash) const;
+	const WorldItem* FindItemByItem(int itemHash) const;
+
+	std::mt19937 m_Random;
+	GameDebugParams m_Params;
+	bool m_Initialized = false;
+	bool m_Verbose = false;
+
+	WorldInfo m_WorldInfo = {};
+	GpplLevel m_Level; // Mapped for the world's lifetime, the house walls point into it
+	GpplSpan<GpplHouse> m_Houses;
+
+	// Coarse walkability grid standing in for the framework's navmesh
+	NavigationGrid m_Navigation;
+	mutable int m_CachedPathStartCell = -1;
+	mutable int m_CachedPathGoalCell = -1;
+	mutable b2Vec2 m_CachedPathPoint;
+
+	AgentInfo m_Agent = {};
+	float m_MaxHealth = 10.0f;
+	float m_MaxEnergy = 10.0f;
+	float m_MaxStamina = 10.0f;
+
+	std::vector<WorldEnemy> m_Enemies;
+	std::vector<WorldItem> m_GroundItems;
+	std::vector<WorldItem> m_Inventory; // ItemInfo.ItemHash == 0 for empty slots
+	int m_ItemsOnGroundTarget = 0;
+
+	int m_NextEntityHash = 1;
+	int m_NextItemHash = 1;
+	int m_NextEnemyHash = 1;
+
+	HeadlessStats m_Stats;
+};
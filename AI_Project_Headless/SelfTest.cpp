@@ -0,0 +1,800 @@
+#include "stdafx.h"
+
+#include "SelfTest.h"
+#include "BehaviourNodeArena.h"
+#include "FlatBehaviourTree.h"
+#include "Perception.h"
+#include "SpatialGrid.h"
+#include "StaticBehaviourTree.h"
+#include "TimingWheel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdarg>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	//-----------------------------------------------------------------
+	// REPORTING
+	//-----------------------------------------------------------------
+	const int MaxFailuresPrintedPerSuite = 20;
+
+	const char* g_pSuite = "";
+	int g_SuiteChecks = 0;
+	int g_SuiteFailures = 0;
+	int g_TotalFailures = 0;
+
+	void BeginSuite(const char* pName)
+	{
+		g_pSuite = pName;
+		g_SuiteChecks = 0;
+		g_SuiteFailures = 0;
+	}
+
+	void EndSuite()
+	{
+		printf("%-24s %8i checks, %i failed\n", g_pSuite, g_SuiteChecks, g_SuiteFailures);
+		g_TotalFailures += g_SuiteFailures;
+	}
+
+	bool Check(bool passed, const char* format, ...)
+	{
+		++g_SuiteChecks;
+		if (passed)
+			return true;
+
+		if (g_SuiteFailures++ < MaxFailuresPrintedPerSuite)
+		{
+			printf("FAILED [%s]: ", g_pSuite);
+			va_list args;
+			va_start(args, format);
+			vprintf(format, args);
+			va_end(args);
+			printf("\n");
+		}
+		return false;
+	}
+
+	//-----------------------------------------------------------------
+	// TIMING WHEEL
+	// Times are whole ticks, so a timer is due at exactly one tick and
+	// has to fire on the first Advance that reaches it: not before, and
+	// not on a later one.
+	//-----------------------------------------------------------------
+	const uint32_t WheelSpan = 1u << 24; // Ticks the wheel's top level reaches ahead
+
+	float TickToTime(uint32_t tick)
+	{
+		return (float)tick / TimingWheel::TicksPerSecond;
+	}
+
+	// Same rounding as the wheel, large ticks aren't all representable as a float time
+	uint32_t TimeToTick(float time)
+	{
+		return (uint32_t)std::floor((double)time * TimingWheel::TicksPerSecond);
+	}
+
+	struct ExpectedTimer
+	{
+		uint32_t DueTick;
+		TimerHandle Handle;
+		bool Cancelled;
+		int FireCount;
+		uint32_t FiredTick;
+	};
+
+	// Advances the wheel to tick and checks what fired against the expected timers
+	void AdvanceAndCheck(TimingWheel& wheel, uint32_t tick, std::vector<ExpectedTimer>& timers, std::vector<TimerEvent>& fired)
+	{
+		const float now = TickToTime(tick);
+		const uint32_t nowTick = TimeToTick(now);
+		fired.clear();
+		wheel.Advance(now, fired);
+
+		for (const TimerEvent& event : fired)
+		{
+			if (!Check(event.Id >= 0 && event.Id < (int)timers.size(), "unknown timer %i fired", event.Id))
+				continue;
+
+			ExpectedTimer& timer = timers[event.Id];
+			Check(!timer.Cancelled, "timer %i fired at tick %u after being cancelled", event.Id, nowTick);
+			Check(timer.DueTick <= nowTick, "timer %i due at tick %u fired early, at tick %u", event.Id, timer.DueTick, nowTick);
+			++timer.FireCount;
+			timer.FiredTick = nowTick;
+		}
+
+		for (size_t i = 0; i < timers.size(); i++)
+		{
+			const ExpectedTimer& timer = timers[i];
+			if (timer.Cancelled || timer.DueTick > nowTick)
+				continue;
+			// Checked after every Advance, so this also catches timers that fire late
+			Check(timer.FireCount == 1, "timer %i due at tick %u fired %i times by tick %u", (int)i, timer.DueTick, timer.FireCount, nowTick);
+		}
+	}
+
+	void TestTimingWheelBoundaries()
+	{
+		// Every level boundary from either side, and timers beyond the top level that
+		// have to be placed again when it cascades
+		const uint32_t deltas[] =
+		{
+			0, 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+			WheelSpan - 1, WheelSpan, WheelSpan + 1, WheelSpan + 4096, 2 * WheelSpan + 64
+		};
+		// Start on and just off boundaries, so cascades happen at every offset into a span
+		const uint32_t starts[] = { 0, 37, 4095, 262143, 262144 + 63 };
+
+		std::vector<TimerEvent> fired;
+		for (uint32_t start : starts)
+		{
+			TimingWheel wheel;
+			wheel.Advance(TickToTime(start), fired);
+
+			std::vector<ExpectedTimer> timers;
+			std::vector<uint32_t> dueTicks;
+			for (uint32_t delta : deltas)
+			{
+				ExpectedTimer timer = {};
+				timer.DueTick = TimeToTick(TickToTime(start + delta));
+				timer.Handle = wheel.Schedule(TickToTime(timer.DueTick), { 0, (int)timers.size() });
+				timers.push_back(timer);
+				dueTicks.push_back(timer.DueTick);
+			}
+			Check(wheel.GetPendingCount() == (int)timers.size(), "start %u: %i pending after scheduling %i", start, wheel.GetPendingCount(), (int)timers.size());
+
+			// Stop on the tick before each due tick and on the tick itself
+			std::sort(dueTicks.begin(), dueTicks.end());
+			for (uint32_t due : dueTicks)
+			{
+				if (due > start + 1) AdvanceAndCheck(wheel, due - 1, timers, fired);
+				AdvanceAndCheck(wheel, due, timers, fired);
+			}
+			AdvanceAndCheck(wheel, dueTicks.back() + WheelSpan / 2, timers, fired);
+
+			for (size_t i = 0; i < timers.size(); i++)
+			{
+				Check(timers[i].FireCount == 1, "start %u, delta %u: fired %i times", start, deltas[i], timers[i].FireCount);
+				Check(timers[i].FiredTick == timers[i].DueTick, "start %u, delta %u: due at tick %u, fired at %u",
+					start, deltas[i], timers[i].DueTick, timers[i].FiredTick);
+				Check(!wheel.Cancel(timers[i].Handle), "start %u, delta %u: cancelled after it fired", start, deltas[i]);
+			}
+			Check(wheel.GetPendingCount() == 0, "start %u: %i still pending", start, wheel.GetPendingCount());
+		}
+	}
+
+	void TestTimingWheelCancel()
+	{
+		// Each timer is cancelled once it has cascaded down to level 0, its twin a few ticks later
+		// (beyond the top level float times are only exact to the even tick) must still fire
+		const uint32_t deltas[] = { 64 + 5, 4096 + 5, 262144 + 5, WheelSpan + 72 };
+		const uint32_t twinOffset = 4;
+
+		TimingWheel wheel;
+		std::vector<ExpectedTimer> timers;
+		for (uint32_t delta : deltas)
+		{
+			for (uint32_t twin = 0; twin < 2; twin++)
+			{
+				ExpectedTimer timer = {};
+				timer.DueTick = TimeToTick(TickToTime(delta + twin * twinOffset));
+				timer.Handle = wheel.Schedule(TickToTime(timer.DueTick), { 0, (int)timers.size() });
+				timers.push_back(timer);
+			}
+		}
+
+		std::vector<TimerEvent> fired;
+		for (size_t i = 0; i < timers.size(); i += 2)
+		{
+			// The start of the level 0 span holding the due tick, every cascade has happened by then
+			const uint32_t spanStart = timers[i].DueTick & ~63u;
+			AdvanceAndCheck(wheel, spanStart, timers, fired);
+
+			const int pending = wheel.GetPendingCount();
+			Check(wheel.Cancel(timers[i].Handle), "timer due at tick %u couldn't be cancelled at tick %u", timers[i].DueTick, spanStart);
+			Check(!wheel.Cancel(timers[i].Handle), "timer due at tick %u cancelled twice", timers[i].DueTick);
+			Check(wheel.GetPendingCount() == pending - 1, "cancelling left %i pending, expected %i", wheel.GetPendingCount(), pending - 1);
+			timers[i].Cancelled = true;
+		}
+		AdvanceAndCheck(wheel, timers.back().DueTick + 64, timers, fired);
+
+		for (size_t i = 0; i < timers.size(); i++)
+		{
+			Check(timers[i].FireCount == (timers[i].Cancelled ? 0 : 1), "timer due at tick %u fired %i times", timers[i].DueTick, timers[i].FireCount);
+		}
+		Check(wheel.GetPendingCount() == 0, "%i still pending", wheel.GetPendingCount());
+
+		// Handles whose timer was freed mustn't cancel the timer that reuses it
+		const uint32_t nextDue = timers.back().DueTick + 128;
+		ExpectedTimer reused = {};
+		reused.DueTick = nextDue;
+		reused.Handle = wheel.Schedule(TickToTime(nextDue), { 0, (int)timers.size() });
+		bool indexReused = false;
+		for (const ExpectedTimer& timer : timers)
+		{
+			indexReused = indexReused || timer.Handle.Index == reused.Handle.Index;
+			Check(!wheel.Cancel(timer.Handle), "a stale handle cancelled a timer");
+		}
+		Check(indexReused, "expected a freed timer to be reused");
+		timers.push_back(reused);
+		AdvanceAndCheck(wheel, nextDue, timers, fired);
+		Check(timers.back().FireCount == 1, "the reused timer fired %i times", timers.back().FireCount);
+
+		// Nor may one from before Clear
+		const TimerHandle beforeClear = wheel.Schedule(TickToTime(nextDue + 10), { 0, 0 });
+		wheel.Clear();
+		const TimerHandle afterClear = wheel.Schedule(TickToTime(10), { 0, 0 });
+		Check(!wheel.Cancel(beforeClear), "a handle from before Clear cancelled a timer");
+		Check(wheel.Cancel(afterClear), "couldn't cancel a timer scheduled after Clear");
+		Check(wheel.GetPendingCount() == 0, "%i pending after Clear and cancel", wheel.GetPendingCount());
+	}
+
+	void TestTimingWheelRandom()
+	{
+		// Random schedules, cancels and step sizes, checked after every Advance
+		std::mt19937 random(1234);
+		TimingWheel wheel;
+		std::vector<ExpectedTimer> timers;
+		std::vector<TimerEvent> fired;
+
+		uint32_t tick = 0;
+		for (int step = 0; step < 4000; step++)
+		{
+			const int schedules = (int)(random() % 4);
+			for (int i = 0; i < schedules; i++)
+			{
+				// Mostly near, sometimes on a higher level or beyond the top one
+				const int level = (int)(random() % 5);
+				const uint32_t range = level < 4 ? 1u << (6 * (level + 1)) : WheelSpan * 2;
+				ExpectedTimer timer = {};
+				timer.DueTick = TimeToTick(TickToTime(tick + random() % range));
+				timer.Handle = wheel.Schedule(TickToTime(timer.DueTick), { 0, (int)timers.size() });
+				timers.push_back(timer);
+			}
+
+			if (!timers.empty() && random() % 3 == 0)
+			{
+				ExpectedTimer& timer = timers[random() % timers.size()];
+				const bool pending = !timer.Cancelled && timer.FireCount == 0;
+				Check(wheel.Cancel(timer.Handle) == pending, "Cancel returned %s for a %s timer", pending ? "false" : "true", pending ? "pending" : "finished");
+				timer.Cancelled = timer.Cancelled || pending;
+			}
+
+			tick += 1 + random() % (step % 50 == 0 ? 20000 : 300);
+			AdvanceAndCheck(wheel, tick, timers, fired);
+		}
+
+		// Run out whatever is left
+		uint32_t lastDue = tick;
+		for (const ExpectedTimer& timer : timers) lastDue = std::max(lastDue, timer.DueTick);
+		while (tick < lastDue)
+		{
+			tick = std::min(lastDue, tick + WheelSpan / 16);
+			AdvanceAndCheck(wheel, tick, timers, fired);
+		}
+		Check(wheel.GetPendingCount() == 0, "%i still pending", wheel.GetPendingCount());
+	}
+	//-----------------------------------------------------------------
+	// DECORATORS
+	// One decorator of each type over a scripted action, ticked through
+	// the runtime, flat and static trees. Every tick's result, and
+	// whether the action ran, is checked against the rules spelled out
+	// again in DecoratorModel.
+	//-----------------------------------------------------------------
+	const float DecoratorDeltaTime = 0.01f;
+	const int DecoratorTicks = 200;
+	// Rates that don't land on a tick boundary, so float time can't tip a comparison either way
+	const int ThrottleHz = 8; // Every 12.5 ticks
+	const int CooldownMilliseconds = 45; // 4.5 ticks
+	const uint32_t EveryNthTick = 3;
+
+	const BehaviourState ScriptedStates[] = { Success, Success, Failure, Running, Success, Failure, Failure };
+	const int ScriptedStateCount = sizeof(ScriptedStates) / sizeof(ScriptedStates[0]);
+	int g_ScriptedTick = 0;
+	int g_ScriptedRuns = 0;
+
+	BehaviourState ScriptedAction(Blackboard*)
+	{
+		++g_ScriptedRuns;
+		return ScriptedStates[g_ScriptedTick % ScriptedStateCount];
+	}
+
+	// What the decorator should do, written out separately from BehaviourBudget
+	struct DecoratorModel
+	{
+		eBehaviourBudget Type;
+		bool HasRun = false;
+		BehaviourState LastState = Failure;
+		int LastTick = 0;
+
+		// Returns whether the child runs on tick, state is what the decorator returns
+		bool Tick(int tick, BehaviourState& state)
+		{
+			// Ticks of DecoratorDeltaTime, in whole hundredths of a second to keep floats out of it
+			const int ticksSinceRun = tick - LastTick;
+			bool run = !HasRun;
+			switch (Type)
+			{
+			case BUDGET_THROTTLE:
+				run = run || ticksSinceRun * ThrottleHz >= 100;
+				state = LastState;
+				break;
+			case BUDGET_COOLDOWN:
+				run = run || LastState != Success || ticksSinceRun * 10 >= CooldownMilliseconds;
+				state = Failure;
+				break;
+			case BUDGET_EVERY_NTH_TICK:
+				run = run || ticksSinceRun >= (int)EveryNthTick;
+				state = LastState;
+				break;
+			}
+
+			if (run)
+			{
+				state = ScriptedStates[tick % ScriptedStateCount];
+				HasRun = true;
+				LastState = state;
+				LastTick = tick;
+			}
+			return run;
+		}
+	};
+
+	enum eTreeEngine
+	{
+		ENGINE_RUNTIME,
+		ENGINE_FLAT,
+		ENGINE_STATIC
+	};
+	const char* const EngineNames[] = { "runtime", "flat", "static" };
+	const char* const BudgetNames[] = { "Throttle", "Cooldown", "RunEveryNthTick" };
+
+	// Ticks one engine's tree and checks it against the model. StaticRoot is the same tree as pRuntimeRoot
+	template<typename StaticRoot>
+	void CheckDecorator(eBehaviourBudget type, IBehaviour* pRuntimeRoot, eTreeEngine engine)
+	{
+		Blackboard blackboard;
+		FlatBehaviourTree flatTree(pRuntimeRoot);
+		StaticBehaviourTree<StaticRoot> staticTree;
+		if (engine == ENGINE_FLAT)
+		{
+			Check(flatTree.GetOpaqueNodeCount() == 0, "%s: the flat tree kept %i opaque nodes", BudgetNames[type], flatTree.GetOpaqueNodeCount());
+		}
+
+		DecoratorModel model = {};
+		model.Type = type;
+		int mismatches = 0;
+		for (int tick = 0; tick < DecoratorTicks; tick++)
+		{
+			g_ScriptedTick = tick;
+			const int runsBefore = g_ScriptedRuns;
+
+			BehaviourState state = Failure;
+			switch (engine)
+			{
+			case ENGINE_RUNTIME:
+				blackboard.BeginTick();
+				state = pRuntimeRoot->Execute(&blackboard);
+				break;
+			case ENGINE_FLAT:
+				state = flatTree.Update(&blackboard);
+				break;
+			case ENGINE_STATIC:
+				state = staticTree.Update(&blackboard);
+				break;
+			}
+			blackboard.AdvanceTime(DecoratorDeltaTime);
+
+			BehaviourState expectedState;
+			const bool expectedRun = model.Tick(tick, expectedState);
+			const bool ran = g_ScriptedRuns != runsBefore;
+			if (!Check(ran == expectedRun && state == expectedState, "%s, %s tree, tick %i: %s and returned %i, expected %s and %i",
+				BudgetNames[type], EngineNames[engine], tick, ran ? "ran" : "skipped", (int)state, expectedRun ? "ran" : "skipped", (int)expectedState))
+			{
+				if (++mismatches >= 3) break;
+			}
+		}
+	}
+
+	void TestDecorators()
+	{
+		// Each engine gets a fresh runtime tree, decorators keep their budget in the node
+		for (int engine = ENGINE_RUNTIME; engine <= ENGINE_STATIC; engine++)
+		{
+			BehaviourNodeArena arena;
+			IBehaviour* pThrottle = arena.Create<BehaviourThrottle>((float)ThrottleHz, arena.Create<BehaviourAction>(ScriptedAction));
+			IBehaviour* pCooldown = arena.Create<BehaviourCooldown>(CooldownMilliseconds / 1000.0f, arena.Create<BehaviourAction>(ScriptedAction));
+			IBehaviour* pEveryNth = arena.Create<BehaviourRunEveryNthTick>(EveryNthTick, arena.Create<BehaviourAction>(ScriptedAction));
+
+			CheckDecorator<StaticBT::Throttle<ThrottleHz, StaticBT::Action<&ScriptedAction>>>(BUDGET_THROTTLE, pThrottle, (eTreeEngine)engine);
+			CheckDecorator<StaticBT::Cooldown<CooldownMilliseconds, StaticBT::Action<&ScriptedAction>>>(BUDGET_COOLDOWN, pCooldown, (eTreeEngine)engine);
+			CheckDecorator<StaticBT::RunEveryNthTick<EveryNthTick, StaticBT::Action<&ScriptedAction>>>(BUDGET_EVERY_NTH_TICK, pEveryNth, (eTreeEngine)engine);
+		}
+	}
+
+	//-----------------------------------------------------------------
+	// FAILURE MEMO
+	// A selector over a subtree that writes and then fails, and one
+	// that only reads and fails. The host clears the written slot
+	// between ticks, the way TestBoxPlugin::Update clears TargetEnemy,
+	// so the write has to happen on every tick; the read-only subtree
+	// should only run again once its input changes.
+	//-----------------------------------------------------------------
+	const BlackboardKey<int> MemoInput = { 0, "MemoInput" };
+	const BlackboardKey<int> MemoOutput = { 1, "MemoOutput" };
+	const int MemoTicks = 6;
+	const int MemoInputChangeTick = 3;
+	int g_MemoTick = 0;
+	int g_ReadOnlyRuns = 0;
+
+	bool ReadMemoInput(Blackboard* pBlackboard)
+	{
+		int input = 0;
+		return pBlackboard->GetData(MemoInput, input) && input >= 0;
+	}
+
+	BehaviourState WriteThenFail(Blackboard* pBlackboard)
+	{
+		pBlackboard->ChangeData(MemoOutput, g_MemoTick + 1);
+		return Failure;
+	}
+
+	bool FailReadOnly(Blackboard*)
+	{
+		++g_ReadOnlyRuns;
+		return false;
+	}
+
+	typedef StaticBT::Selector<
+		StaticBT::Sequence<StaticBT::Condition<&ReadMemoInput>, StaticBT::Action<&WriteThenFail>>,
+		StaticBT::Sequence<StaticBT::Condition<&ReadMemoInput>, StaticBT::Condition<&FailReadOnly>>
+	> MemoStaticRoot;
+
+	void TestFailureMemo()
+	{
+		for (int engine = ENGINE_RUNTIME; engine <= ENGINE_STATIC; engine++)
+		{
+			BehaviourNodeArena arena;
+			IBehaviour* pRoot = arena.CreateComposite<BehaviourSelector>
+			({
+				arena.CreateComposite<BehaviourSequence>
+				({
+					arena.Create<BehaviourConditional>(ReadMemoInput),
+					arena.Create<BehaviourAction>(WriteThenFail)
+				}),
+				arena.CreateComposite<BehaviourSequence>
+				({
+					arena.Create<BehaviourConditional>(ReadMemoInput),
+					arena.Create<BehaviourConditional>(FailReadOnly)
+				})
+			});
+			FlatBehaviourTree flatTree(pRoot);
+			StaticBehaviourTree<MemoStaticRoot> staticTree;
+
+			Blackboard blackboard(2);
+			blackboard.AddData(MemoInput, 0);
+			blackboard.AddData(MemoOutput, 0);
+			g_ReadOnlyRuns = 0;
+			for (int tick = 0; tick < MemoTicks; tick++)
+			{
+				g_MemoTick = tick;
+				blackboard.ChangeDataIfDifferent(MemoInput, tick < MemoInputChangeTick ? 0 : 1);
+				blackboard.ChangeData(MemoOutput, 0);
+				const int readOnlyRunsBefore = g_ReadOnlyRuns;
+
+				BehaviourState state = Success;
+				switch (engine)
+				{
+				case ENGINE_RUNTIME:
+					blackboard.BeginTick();
+					state = pRoot->Execute(&blackboard);
+					break;
+				case ENGINE_FLAT:
+					state = flatTree.Update(&blackboard);
+					break;
+				case ENGINE_STATIC:
+					state = staticTree.Update(&blackboard);
+					break;
+				}
+
+				int output = 0;
+				blackboard.GetData(MemoOutput, output);
+				const bool expectReadOnlyRun = tick == 0 || tick == MemoInputChangeTick;
+				const bool readOnlyRan = g_ReadOnlyRuns != readOnlyRunsBefore;
+				Check(state == Failure, "%s tree, tick %i: returned %i", EngineNames[engine], tick, (int)state);
+				Check(output == tick + 1, "%s tree, tick %i: the write-then-fail subtree was skipped", EngineNames[engine], tick);
+				Check(readOnlyRan == expectReadOnlyRun, "%s tree, tick %i: the read-only subtree %s, expected it %s",
+					EngineNames[engine], tick, readOnlyRan ? "ran" : "was skipped", expectReadOnlyRun ? "to run" : "to be skipped");
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------
+	// SPATIAL GRID
+	// Random entries, some outside the world (clamped into the border
+	// cells), queried from random centers with and without a maximum
+	// distance and filter, compared against a brute force scan. Ties
+	// may pick either entry, so only the distances have to agree.
+	//-----------------------------------------------------------------
+	struct GridEntry
+	{
+		eSpatialCategory Category;
+		int Key;
+		b2Vec2 Position;
+		bool Present;
+	};
+
+	b2Vec2 RandomPoint(std::mt19937& random, const WorldInfo& world, float margin)
+	{
+		std::uniform_real_distribution<float> x(world.Center.x - world.Dimensions.x / 2.0f - margin, world.Center.x + world.Dimensions.x / 2.0f + margin);
+		std::uniform_real_distribution<float> y(world.Center.y - world.Dimensions.y / 2.0f - margin, world.Center.y + world.Dimensions.y / 2.0f + margin);
+		return b2Vec2(x(random), y(random));
+	}
+
+	// Nearest present entry strictly closer than maxDistance, FLT_MAX if there's none
+	template<typename Predicate>
+	float BruteForceNearestSqr(const std::vector<GridEntry>& entries, const b2Vec2& center, float maxDistance, eSpatialCategory category, Predicate accept)
+	{
+		float bestSqr = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+		bool found = false;
+		for (const GridEntry& entry : entries)
+		{
+			if (!entry.Present || entry.Category != category || !accept(entry.Key)) continue;
+			const float distanceSqr = b2DistanceSquared(entry.Position, center);
+			if (distanceSqr < bestSqr)
+			{
+				bestSqr = distanceSqr;
+				found = true;
+			}
+		}
+		return found ? bestSqr : FLT_MAX;
+	}
+
+	void CheckGridQueries(const SpatialGrid& grid, const std::vector<GridEntry>& entries, std::mt19937& random, const WorldInfo& world, int queries)
+	{
+		const float maxDistances[] = { FLT_MAX, 3.0f, 10.0f, 25.0f, 80.0f };
+		auto everyThird = [](int key) { return key % 3 != 0; };
+		for (int query = 0; query < queries; query++)
+		{
+			const b2Vec2 center = RandomPoint(random, world, 30.0f);
+			const float maxDistance = maxDistances[random() % (sizeof(maxDistances) / sizeof(maxDistances[0]))];
+
+			SpatialNearestResult nearestOfEach;
+			grid.FindNearestOfEach(center, maxDistance, SPATIAL_ALL_ITEMS | SpatialCategoryBit(SPATIAL_ENEMY), nearestOfEach);
+			float closestSqr = FLT_MAX;
+			for (int c = 0; c < _SPATIAL_CATEGORY_COUNT; c++)
+			{
+				const eSpatialCategory category = (eSpatialCategory)c;
+				const float expectedSqr = BruteForceNearestSqr(entries, center, maxDistance, category, [](int) { return true; });
+				const bool expectFound = expectedSqr < FLT_MAX;
+				closestSqr = std::min(closestSqr, expectedSqr);
+
+				int key = -1;
+				float distance = 0.0f;
+				const bool found = grid.FindNearest(center, maxDistance, category, key, distance);
+				Check(found == expectFound && (!found || distance == sqrtf(expectedSqr)),
+					"FindNearest (%.2f, %.2f) within %g, category %i: %s %g, brute force %s %g", center.x, center.y, maxDistance, c,
+					found ? "found" : "none", distance, expectFound ? "found" : "none", expectFound ? sqrtf(expectedSqr) : 0.0f);
+
+				const float filteredSqr = BruteForceNearestSqr(entries, center, maxDistance, category, everyThird);
+				const bool filteredFound = grid.FindNearest(center, maxDistance, category, key, distance, everyThird);
+				Check(filteredFound == (filteredSqr < FLT_MAX) && (!filteredFound || (distance == sqrtf(filteredSqr) && everyThird(key))),
+					"filtered FindNearest (%.2f, %.2f) within %g, category %i disagrees with brute force", center.x, center.y, maxDistance, c);
+
+				Check(nearestOfEach.Has(category) == expectFound && (!expectFound || nearestOfEach.Nearest[c].DistanceSqr == expectedSqr),
+					"FindNearestOfEach (%.2f, %.2f) within %g, category %i disagrees with brute force", center.x, center.y, maxDistance, c);
+			}
+			Check((nearestOfEach.NearestCategory == -1) == (closestSqr == FLT_MAX) &&
+				(nearestOfEach.NearestCategory == -1 || nearestOfEach.Nearest[nearestOfEach.NearestCategory].DistanceSqr == closestSqr),
+				"FindNearestOfEach (%.2f, %.2f) picked the wrong closest category", center.x, center.y);
+		}
+	}
+
+	void TestSpatialGrid()
+	{
+		std::mt19937 random(99);
+		WorldInfo world;
+		world.Center = b2Vec2(12.5f, -40.0f);
+		world.Dimensions = b2Vec2(230.0f, 170.0f);
+
+		SpatialGrid grid;
+		grid.Initialize(world);
+
+		std::vector<GridEntry> entries;
+		for (int i = 0; i < 600; i++)
+		{
+			GridEntry entry;
+			entry.Category = (eSpatialCategory)(random() % _SPATIAL_CATEGORY_COUNT);
+			entry.Key = i;
+			entry.Position = RandomPoint(random, world, 20.0f);
+			entry.Present = true;
+			Check(grid.Insert(entry.Category, entry.Key, entry.Position), "couldn't insert key %i", i);
+			entries.push_back(entry);
+		}
+		Check(!grid.Insert(entries[0].Category, entries[0].Key, entries[0].Position), "inserted key 0 twice");
+		CheckGridQueries(grid, entries, random, world, 300);
+
+		// Move and remove, then insert some back, and query again after each round
+		for (int round = 0; round < 5; round++)
+		{
+			for (GridEntry& entry : entries)
+			{
+				const int action = (int)(random() % 6);
+				if (action == 0 && entry.Present)
+				{
+					Check(grid.Remove(entry.Category, entry.Key), "couldn't remove key %i", entry.Key);
+					entry.Present = false;
+				}
+				else if (action == 1 && !entry.Present)
+				{
+					Check(grid.Insert(entry.Category, entry.Key, entry.Position), "couldn't insert key %i again", entry.Key);
+					entry.Present = true;
+				}
+				else if (action >= 2 && entry.Present)
+				{
+					// Mostly small steps within a cell, sometimes a jump across the world
+					entry.Position = action == 2 ? RandomPoint(random, world, 20.0f) : entry.Position + b2Vec2(0.5f, -0.25f);
+					Check(grid.Move(entry.Category, entry.Key, entry.Position), "couldn't move key %i", entry.Key);
+				}
+				Check(grid.Contains(entry.Category, entry.Key) == entry.Present, "Contains is wrong for key %i", entry.Key);
+			}
+			CheckGridQueries(grid, entries, random, world, 100);
+		}
+
+		size_t present = 0;
+		for (const GridEntry& entry : entries) present += entry.Present ? 1 : 0;
+		Check(grid.GetEntryCount() == present, "%i entries in the grid, expected %i", (int)grid.GetEntryCount(), (int)present);
+		Check(!grid.Move(SPATIAL_ENEMY, 100000, b2Vec2(0.0f, 0.0f)) && !grid.Remove(SPATIAL_ENEMY, 100000), "moved or removed a missing key");
+	}
+
+	//-----------------------------------------------------------------
+	// FOV DELTA
+	// Random FOVs drawn from a small pool of hashes, so entities keep
+	// leaving and coming back, with empty ticks and the odd Clear in
+	// between. An entity that was out of the FOV last tick is entered
+	// again, wherever it shows up.
+	//-----------------------------------------------------------------
+	const int FovHashCount = 16;
+
+	struct ExpectedFovEntity
+	{
+		bool Visible;
+		b2Vec2 Position;
+		bool Settled;
+	};
+
+	void UpdateAndCheck(FovDelta& fov, std::vector<EntityInfo>& entities, ExpectedFovEntity (&expected)[FovHashCount], int tick)
+	{
+		const std::vector<EntityInfo> given = entities;
+		fov.Update(std::move(entities));
+		Check(entities.empty(), "tick %i: the caller's buffer came back with %i entities", tick, (int)entities.size());
+		Check(fov.GetEntities().size() == given.size(), "tick %i: %i entities, expected %i", tick, (int)fov.GetEntities().size(), (int)given.size());
+		if (fov.GetEntities().size() != given.size())
+			return;
+
+		int enteredCount = 0;
+		int movedCount = 0;
+		bool visible[FovHashCount] = {};
+		bool settled[FovHashCount] = {};
+		for (size_t i = 0; i < given.size(); i++)
+		{
+			const int hash = given[i].EntityHash;
+			const ExpectedFovEntity& previous = expected[hash];
+			const eFovChange change = !previous.Visible ? FOV_ENTERED : (previous.Position == given[i].Position ? FOV_UNCHANGED : FOV_MOVED);
+			enteredCount += change == FOV_ENTERED ? 1 : 0;
+			movedCount += change == FOV_MOVED ? 1 : 0;
+			visible[hash] = true;
+			settled[hash] = change == FOV_UNCHANGED && previous.Settled;
+
+			Check(fov.GetEntities()[i].EntityHash == hash && fov.GetEntities()[i].Position == given[i].Position, "tick %i: entity %i isn't where the FOV put it", tick, (int)i);
+			Check(fov.GetChange(i) == change, "tick %i: hash %i is change %i, expected %i", tick, hash, (int)fov.GetChange(i), (int)change);
+			Check(fov.IsSettled(i) == settled[hash], "tick %i: hash %i settled is wrong", tick, hash);
+			Check(fov.IndexOf(hash) == (int)i, "tick %i: hash %i found at %i, expected %i", tick, hash, fov.IndexOf(hash), (int)i);
+		}
+		Check(fov.GetEnteredCount() == enteredCount && fov.GetMovedCount() == movedCount,
+			"tick %i: %i entered and %i moved, expected %i and %i", tick, fov.GetEnteredCount(), fov.GetMovedCount(), enteredCount, movedCount);
+
+		for (int hash = 0; hash < FovHashCount; hash++)
+		{
+			Check(fov.IsVisible(hash) == visible[hash], "tick %i: hash %i visible is wrong", tick, hash);
+			expected[hash].Visible = visible[hash];
+			expected[hash].Settled = settled[hash];
+		}
+		for (size_t i = 0; i < given.size(); i++)
+		{
+			expected[given[i].EntityHash].Position = given[i].Position;
+		}
+	}
+
+	void TestFovDelta()
+	{
+		FovDelta fov;
+		ExpectedFovEntity expected[FovHashCount] = {};
+		std::vector<EntityInfo> entities;
+
+		// Out of the FOV for one empty tick, back at the same spot: entered, and no longer settled
+		entities.push_back({ eEntityType::ITEM, 5, b2Vec2(1.0f, 1.0f) });
+		UpdateAndCheck(fov, entities, expected, -3);
+		fov.SetSettled(0, true);
+		UpdateAndCheck(fov, entities, expected, -2);
+		entities.push_back({ eEntityType::ITEM, 5, b2Vec2(1.0f, 1.0f) });
+		UpdateAndCheck(fov, entities, expected, -1);
+		Check(fov.GetChange(0) == FOV_ENTERED && !fov.IsSettled(0), "hash 5 wasn't entered again after an empty tick");
+
+		std::mt19937 random(4321);
+		for (int tick = 0; tick < 5000; tick++)
+		{
+			if (random() % 50 == 0)
+			{
+				fov.Clear();
+				for (ExpectedFovEntity& entity : expected) entity.Visible = false;
+			}
+
+			// Every 8th tick or so is empty
+			if (random() % 8 != 0)
+			{
+				int hashes[FovHashCount];
+				for (int hash = 0; hash < FovHashCount; hash++) hashes[hash] = hash;
+				std::shuffle(hashes, hashes + FovHashCount, random);
+				const int count = (int)(random() % (FovHashCount + 1));
+				for (int i = 0; i < count; i++)
+				{
+					const int hash = hashes[i];
+					// Few distinct positions, so entities come back to where they were before
+					const b2Vec2 position = random() % 2 == 0 ? expected[hash].Position : b2Vec2((float)(random() % 3), (float)(random() % 3));
+					entities.push_back({ eEntityType::ITEM, hash, position });
+				}
+			}
+			UpdateAndCheck(fov, entities, expected, tick);
+
+			for (size_t i = 0; i < fov.GetEntities().size(); i++)
+			{
+				if (random() % 2 == 0) continue;
+				const bool settled = random() % 2 == 0;
+				fov.SetSettled(i, settled);
+				expected[fov.GetEntities()[i].EntityHash].Settled = settled;
+			}
+		}
+	}
+
+}
+
+int SelfTest::RunAll()
+{
+	g_TotalFailures = 0;
+
+	BeginSuite("TimingWheel boundaries");
+	TestTimingWheelBoundaries();
+	EndSuite();
+
+	BeginSuite("TimingWheel cancel");
+	TestTimingWheelCancel();
+	EndSuite();
+
+	BeginSuite("TimingWheel random");
+	TestTimingWheelRandom();
+	EndSuite();
+
+	BeginSuite("SpatialGrid");
+	TestSpatialGrid();
+	EndSuite();
+
+	BeginSuite("FovDelta");
+	TestFovDelta();
+	EndSuite();
+
+	BeginSuite("Decorators");
+	TestDecorators();
+	EndSuite();
+
+	BeginSuite("Failure memo");
+	TestFailureMemo();
+	EndSuite();
+
+	printf(g_TotalFailures == 0 ? "All self tests passed\n" : "%i self test checks failed\n", g_TotalFailures);
+	return g_TotalFailures;
+}
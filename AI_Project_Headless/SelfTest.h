@@ -0,0 +1,13 @@
+#pragma once
+
+//-----------------------------------------------------------------
+// SELF TEST
+// Deterministic checks of the plugin's data structures against
+// brute force answers, run with --selftest (and by ctest). Every
+// failed check prints a line starting with FAILED.
+//-----------------------------------------------------------------
+namespace SelfTest
+{
+	// Returns the number of failed checks
+	int RunAll();
+}
@@ -0,0 +1,548 @@
+#include "stdafx.h"
+
+#include "AllocationCounter.h"
+#include "Behaviours.h"
+#include "EpisodeRunner.h"
+#include "FlatBehaviourTree.h"
+#include "HeadlessPlugin.h"
+#include "HeadlessWorld.h"
+#include "SelfTest.h"
+#include "TestBoxPlugin.h"
+#include "TickTrace.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define fileno _fileno
+#define close _close
+static const char* NullDevice = "NUL";
+#else
+#include <unistd.h>
+static const char* NullDevice = "/dev/null";
+#endif
+
+//-----------------------------------------------------------------
+// Headless host: runs TestBoxPlugin against a simulated world as
+// fast as the CPU allows (no SDL, no GL, no frame limiter), or
+// replays a recorded tick trace through it.
+//-----------------------------------------------------------------
+namespace
+{
+	struct HostOptions
+	{
+		std::string LevelPath = "_Data/LevelOne.gppl";
+		bool LevelGiven = false;
+		bool LocalNavigation = true;
+		int MaxTicks = 100000;
+		float DeltaTime = 0.016f;
+		unsigned int Seed = 0;
+		bool Verbose = false;
+
+		bool OverrideParams = false;
+		GameDebugParams Params = GameDebugParams(20, false, false, false, false, 3.0f); // Same as TestBoxPlugin
+
+		std::string RecordPath;
+		std::string ReplayPath;
+		int Repeat = 1;
+		std::string ProfilePath;
+		std::string TreeProfilePath;
+		int BenchmarkTrees = 0;
+		bool SelfTest = false;
+
+		// Batch evaluation, every episode samples its params from these ranges
+		int Episodes = 0;
+		int Threads = 0;
+		std::vector<std::string> Levels = { "_Data/LevelOne.gppl", "_Data/LevelTwo.gppl" };
+		float MinDifficulty = 0.5f, MaxDifficulty = 1.0f;
+		int MinEnemies = 10, MaxEnemies = 30;
+		float FleeWeightNearEnemies = -1.0f;
+	};
+
+	// Keeps the plugin's printf chatter out of the batch report
+	class ScopedStdoutSilencer final
+	{
+	public:
+		ScopedStdoutSilencer()
+		{
+			fflush(stdout);
+			m_SavedStdout = dup(fileno(stdout));
+			FILE* pNull = fopen(NullDevice, "w");
+			if (pNull != nullptr)
+			{
+				dup2(fileno(pNull), fileno(stdout));
+				fclose(pNull);
+			}
+		}
+		~ScopedStdoutSilencer()
+		{
+			fflush(stdout);
+			if (m_SavedStdout != -1)
+			{
+				dup2(m_SavedStdout, fileno(stdout));
+				close(m_SavedStdout);
+			}
+		}
+
+	private:
+		int m_SavedStdout = -1;
+	};
+
+	void PrintUsage()
+	{
+		printf("Usage: AI_Project_Headless [options]\n"
+			"  --level <path>        Level to load (default: _Data/LevelOne.gppl)\n"
+			"  --framework-nav       Plan with NAVMESH_GetClosestPathPoint instead of the plugin's own grid\n"
+			"  --ticks <n>           Maximum ticks to simulate (default: 100000)\n"
+			"  --dt <seconds>        Fixed timestep (default: 0.016)\n"
+			"  --seed <n>            Random seed (default: 0)\n"
+			"  --enemies <n>         Override EnemySpawnAmount\n"
+			"  --difficulty <f>      Override Difficulty\n"
+			"  --godmode             Enemies can't kill the agent\n"
+			"  --verbose             Print DEBUG_LogMessage output\n"
+			"  --record <path>       Record every tick to a binary trace\n"
+			"  --replay <path>       Replay a trace instead of simulating a world. Plans paths on the\n"
+			"                        level the trace was recorded with, unless --level or\n"
+			"                        --framework-nav says otherwise\n"
+			"  --repeat <n>          Replay the trace n times, report the fastest run\n"
+			"  --profile <path>      Print the per-phase frame profile and dump it to CSV\n"
+			"  --tree-profile <path> Profile every behaviour tree node, print the stats and\n"
+			"                        dump them to CSV\n"
+			"  --tree-bench <n>      Simulate --ticks, then tick n copies of the behaviour tree\n"
+			"                        with the resulting blackboard, virtual vs flattened vs static\n"
+			"  --episodes <n>        Run n independent episodes in parallel and report the\n"
+			"                        results with 95%% confidence intervals. Episode i uses\n"
+			"                        seed + i and the next level of --levels\n"
+			"  --threads <n>         Worker threads for --episodes (default: all cores)\n"
+			"  --levels <a,b,...>    Levels for --episodes (default: LevelOne and LevelTwo)\n"
+			"  --difficulty-range <min> <max>  Difficulty per episode (default: 0.5 1.0)\n"
+			"  --enemies-range <min> <max>     EnemySpawnAmount per episode (default: 10 30)\n"
+			"  --flee-weight <f>     Override TestBoxPlugin's m_FleeWeightNearEnemies\n"
+			"  --selftest            Check the plugin's data structures against brute force\n"
+			"                        answers, exits 1 if any check fails\n");
+	}
+
+	// The level the plugin builds its navigation grid from, empty for the framework's navmesh.
+	// Replays take it from the trace unless the command line overrides it
+	std::string PluginLevelPath(const HostOptions& options, const TickTraceReader* pReplay)
+	{
+		if (!options.LocalNavigation)
+			return std::string();
+		if (pReplay != nullptr && !options.LevelGiven)
+			return pReplay->GetLevelPath();
+		return options.LevelPath;
+	}
+
+	void ReportTreeProfile(const TestBoxPlugin& plugin, const HostOptions& options)
+	{
+		if (options.TreeProfilePath.empty()) return;
+
+		plugin.GetFlatBehaviourTree()->PrintProfile();
+		plugin.GetFlatBehaviourTree()->DumpProfileToCSV(options.TreeProfilePath);
+	}
+
+	void ReportFrameProfile(const TestBoxPlugin& plugin, const HostOptions& options)
+	{
+		if (options.ProfilePath.empty()) return;
+
+		plugin.GetFrameProfiler().PrintSummary();
+		plugin.GetFrameProfiler().DumpToCSV(options.ProfilePath);
+
+		const FrameArena& arena = plugin.GetFrameArena();
+		printf("Frame arena: %zu of %zu bytes peak, %u arena heap allocations, last in frame %u of %u\n",
+			arena.GetPeakUsed(), arena.GetCapacity(), arena.GetArenaHeapAllocationCount(),
+			arena.GetLastArenaHeapAllocationFrame(), arena.GetFrame());
+
+		if (AllocationCounter::IsEnabled())
+		{
+			const UpdateAllocationStats& allocations = HeadlessPlugin::GetUpdateAllocations();
+			const double steadyTicks = allocations.SteadyTicks > 0 ? (double)allocations.SteadyTicks : 1.0;
+			const uint64_t pluginAllocations = allocations.SteadyAllocations - allocations.SteadyFrameworkAllocations;
+			printf("Global allocations in Update: %llu over %i ticks, at most %llu in a tick\n",
+				(unsigned long long)allocations.Allocations, allocations.Ticks, (unsigned long long)allocations.MaxPerTick);
+			printf("  After the first %i ticks: %.3f per tick in the framework's FOV vectors, %.4f per tick in the plugin (%i of %i ticks)\n",
+				UpdateAllocationStats::WarmupTicks, allocations.SteadyFrameworkAllocations / steadyTicks, pluginAllocations / steadyTicks,
+				allocations.SteadyTicksAllocating, allocations.SteadyTicks);
+		}
+		else
+		{
+			printf("Global allocations in Update aren't counted, build with HEADLESS_COUNT_ALLOCATIONS (or Debug) for that\n");
+		}
+	}
+
+	int RunSimulation(const HostOptions& options)
+	{
+		HeadlessWorld world(options.Seed);
+		world.SetVerbose(options.Verbose);
+		if (!world.LoadLevel(options.LevelPath))
+			return 1;
+
+		if (options.OverrideParams)
+		{
+			world.Initialize(options.Params);
+		}
+
+		HeadlessWorld::SetActive(&world);
+		TestBoxPlugin* pPlugin = new TestBoxPlugin();
+		HeadlessWorld::SetActive(nullptr);
+
+		pPlugin->SetLevelPath(PluginLevelPath(options, nullptr));
+		if (!options.RecordPath.empty())
+		{
+			pPlugin->RecordTrace(options.RecordPath);
+		}
+		pPlugin->Start();
+		pPlugin->GetFlatBehaviourTree()->SetProfiling(!options.TreeProfilePath.empty());
+
+		const auto startTime = std::chrono::steady_clock::now();
+		int tick = 0;
+		for (; tick < options.MaxTicks && !world.IsAgentDead(); tick++)
+		{
+			pPlugin->UpdateInternal(options.DeltaTime);
+		}
+		const auto endTime = std::chrono::steady_clock::now();
+
+		pPlugin->End();
+		ReportFrameProfile(*pPlugin, options);
+		ReportTreeProfile(*pPlugin, options);
+		SafeDelete(pPlugin);
+
+		const double seconds = std::chrono::duration<double>(endTime - startTime).count();
+		const HeadlessStats& stats = world.GetStats();
+		printf("Simulated %i ticks (%.1f game seconds) in %.3f s: %.0f ticks/s\n",
+			tick, stats.SecondsSurvived, seconds, seconds > 0.0 ? tick / seconds : 0.0);
+		printf("Died: %s, items collected: %i, enemies killed: %i, shots fired: %i, bitten: %i\n",
+			stats.Died ? "yes" : "no", stats.ItemsCollected, stats.EnemiesKilled, stats.ShotsFired, stats.TimesBitten);
+
+		return 0;
+	}
+
+	int RunReplay(const HostOptions& options)
+	{
+		TickTraceReader trace;
+		if (!trace.Open(options.ReplayPath))
+			return 1;
+
+		double bestSeconds = 0.0;
+		double totalSeconds = 0.0;
+		for (int run = 0; run < options.Repeat; run++)
+		{
+			trace.Rewind();
+
+			// Start is replayed too, every run needs a fresh plugin
+			HeadlessPlugin::SetActiveReplay(&trace);
+			TestBoxPlugin* pPlugin = new TestBoxPlugin();
+			HeadlessPlugin::SetActiveReplay(nullptr);
+
+			pPlugin->SetLevelPath(PluginLevelPath(options, &trace));
+			pPlugin->Start();
+			pPlugin->GetFlatBehaviourTree()->SetProfiling(!options.TreeProfilePath.empty());
+
+			const auto startTime = std::chrono::steady_clock::now();
+			float dt;
+			while (trace.GetTicksReplayed() < options.MaxTicks && trace.BeginTick(dt))
+			{
+				pPlugin->UpdateInternal(dt);
+			}
+			const auto endTime = std::chrono::steady_clock::now();
+
+			pPlugin->End();
+			if (run == options.Repeat - 1 || trace.HasDiverged())
+			{
+				ReportFrameProfile(*pPlugin, options);
+				ReportTreeProfile(*pPlugin, options);
+			}
+			SafeDelete(pPlugin);
+
+			const double seconds = std::chrono::duration<double>(endTime - startTime).count();
+			totalSeconds += seconds;
+			if (run == 0 || seconds < bestSeconds) bestSeconds = seconds;
+
+			if (trace.HasDiverged())
+				break;
+		}
+
+		const int ticks = trace.GetTicksReplayed();
+		printf("Replayed %i ticks, best of %i: %.3f s (%.0f ticks/s), mean %.3f s\n",
+			ticks, options.Repeat, bestSeconds, bestSeconds > 0.0 ? ticks / bestSeconds : 0.0, totalSeconds / options.Repeat);
+		printf("Diverged: %s, output mismatches: %i\n",
+			trace.HasDiverged() ? "yes" : "no", trace.GetOutputMismatches());
+
+		return (trace.HasDiverged() || trace.GetOutputMismatches() > 0) ? 2 : 0;
+	}
+
+	int RunTreeBenchmark(const HostOptions& options)
+	{
+		// Simulate first so the trees read a realistic blackboard
+		HeadlessWorld world(options.Seed);
+		if (!world.LoadLevel(options.LevelPath))
+			return 1;
+
+		if (options.OverrideParams)
+		{
+			world.Initialize(options.Params);
+		}
+
+		HeadlessWorld::SetActive(&world);
+		TestBoxPlugin* pPlugin = new TestBoxPlugin();
+		HeadlessWorld::SetActive(nullptr);
+
+		pPlugin->SetLevelPath(PluginLevelPath(options, nullptr));
+		pPlugin->Start();
+		for (int tick = 0; tick < options.MaxTicks && !world.IsAgentDead(); tick++)
+		{
+			pPlugin->UpdateInternal(options.DeltaTime);
+		}
+		Blackboard* pBlackboard = pPlugin->GetBehaviourTree()->GetBlackboard();
+		// The plugin points AgentInfo at a local of Update, give the trees one that's still alive
+		AgentInfo agentInfo = world.GetAgentInfo();
+		pBlackboard->ChangeData(BBKeys::AgentInfo, &agentInfo);
+
+		std::vector<BehaviourNodeArena*> nodeArenas;
+		std::vector<IBehaviour*> trees;
+		std::vector<FlatBehaviourTree*> flatTrees;
+		std::vector<StaticBehaviourTree<TestBoxStaticTree::Root>> staticTrees(options.BenchmarkTrees);
+		const auto buildStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.BenchmarkTrees; i++)
+		{
+			nodeArenas.push_back(new BehaviourNodeArena());
+			trees.push_back(CreateTestBoxBehaviourTree(*nodeArenas.back()));
+		}
+		const auto buildEnd = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.BenchmarkTrees; i++)
+		{
+			flatTrees.push_back(new FlatBehaviourTree(trees[i]));
+		}
+
+		const int passes = 100;
+		int successes = 0; // Keeps the optimizer from dropping the ticks
+
+		const auto virtualStart = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (size_t i = 0; i < trees.size(); i++)
+			{
+				pBlackboard->BeginTick(); // What BehaviourTree::Update does, FlatBehaviourTree::Update does its own
+				successes += trees[i]->Execute(pBlackboard) == Success;
+			}
+		}
+		const auto virtualEnd = std::chrono::steady_clock::now();
+
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (size_t i = 0; i < flatTrees.size(); i++)
+			{
+				successes += flatTrees[i]->Update(pBlackboard) == Success;
+			}
+		}
+		const auto flatEnd = std::chrono::steady_clock::now();
+
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (size_t i = 0; i < staticTrees.size(); i++)
+			{
+				successes += staticTrees[i].Update(pBlackboard) == Success;
+			}
+		}
+		const auto staticEnd = std::chrono::steady_clock::now();
+
+		const double treeTicks = (double)passes * trees.size();
+		const double virtualNs = std::chrono::duration<double, std::nano>(virtualEnd - virtualStart).count() / treeTicks;
+		const double flatNs = std::chrono::duration<double, std::nano>(flatEnd - virtualEnd).count() / treeTicks;
+		const double staticNs = std::chrono::duration<double, std::nano>(staticEnd - flatEnd).count() / treeTicks;
+		printf("Ticked %i trees (%i nodes each) %i times\n",
+			options.BenchmarkTrees, flatTrees.empty() ? 0 : (int)flatTrees[0]->GetNodeCount(), passes);
+		printf("Virtual: %.1f ns/tree, flattened: %.1f ns/tree (%.2fx), static: %.1f ns/tree (%.2fx) (%i successes)\n",
+			virtualNs, flatNs, flatNs > 0.0 ? virtualNs / flatNs : 0.0,
+			staticNs, staticNs > 0.0 ? virtualNs / staticNs : 0.0, successes);
+
+		if (!nodeArenas.empty())
+		{
+			printf("Node arena per tree: %u nodes, %i bytes in %u blocks\n",
+				nodeArenas[0]->GetNodeCount(), (int)nodeArenas[0]->GetUsed(), nodeArenas[0]->GetBlockCount());
+		}
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			SafeDelete(flatTrees[i]);
+		}
+		const auto destroyStart = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < trees.size(); i++)
+		{
+			SafeDelete(nodeArenas[i]); // Destroys the tree
+		}
+		const auto destroyEnd = std::chrono::steady_clock::now();
+		if (!nodeArenas.empty())
+		{
+			const double buildUs = std::chrono::duration<double, std::micro>(buildEnd - buildStart).count() / trees.size();
+			const double destroyUs = std::chrono::duration<double, std::micro>(destroyEnd - destroyStart).count() / trees.size();
+			printf("Built trees in %.2f us each, destroyed them in %.2f us each\n", buildUs, destroyUs);
+		}
+		pPlugin->End();
+		SafeDelete(pPlugin);
+		return 0;
+	}
+
+	void PrintSummaryRow(const char* label, const std::vector<EpisodeResult>& results, const std::vector<EpisodeConfig>& configs, const std::string& level)
+	{
+		std::vector<double> survived, items, kills, deaths;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			if (!results[i].Completed || (!level.empty() && configs[i].LevelPath != level))
+				continue;
+
+			const HeadlessStats& stats = results[i].Stats;
+			survived.push_back(stats.SecondsSurvived);
+			items.push_back(stats.ItemsCollected);
+			kills.push_back(stats.EnemiesKilled);
+			deaths.push_back(stats.Died ? 1.0 : 0.0);
+		}
+
+		const SampleSummary survivedSummary = Summarize(survived);
+		const SampleSummary itemsSummary = Summarize(items);
+		const SampleSummary killsSummary = Summarize(kills);
+		const SampleSummary deathsSummary = Summarize(deaths);
+		printf("%-24s %5i  %8.1f +- %-6.1f %6.1f +- %-5.1f %5.2f +- %-5.2f %5.1f%% +- %.1f%%\n", label, survivedSummary.Samples,
+			survivedSummary.Mean, survivedSummary.HalfWidth95, itemsSummary.Mean, itemsSummary.HalfWidth95,
+			killsSummary.Mean, killsSummary.HalfWidth95, deathsSummary.Mean * 100.0, deathsSummary.HalfWidth95 * 100.0);
+	}
+
+	int RunEpisodeBatch(const HostOptions& options)
+	{
+		// Params are drawn up front from one generator, so a batch is reproducible from --seed
+		std::mt19937 random(options.Seed);
+		std::uniform_real_distribution<float> difficulty(options.MinDifficulty, options.MaxDifficulty);
+		std::uniform_int_distribution<int> enemies(options.MinEnemies, options.MaxEnemies);
+
+		std::vector<EpisodeConfig> configs(options.Episodes);
+		for (int i = 0; i < options.Episodes; i++)
+		{
+			EpisodeConfig& config = configs[i];
+			config.LevelPath = options.Levels[i % options.Levels.size()];
+			config.Seed = options.Seed + i;
+			config.Params = options.Params;
+			config.Params.Difficulty = difficulty(random);
+			config.Params.OverrideDifficulty = true;
+			config.Params.EnemySpawnAmount = enemies(random);
+			config.MaxTicks = options.MaxTicks;
+			config.DeltaTime = options.DeltaTime;
+			config.LocalNavigation = options.LocalNavigation;
+			config.FleeWeightNearEnemies = options.FleeWeightNearEnemies;
+		}
+
+		std::vector<EpisodeResult> results;
+		const auto startTime = std::chrono::steady_clock::now();
+		{
+			ScopedStdoutSilencer silencer;
+			RunEpisodes(configs, options.Threads, results);
+		}
+		const auto endTime = std::chrono::steady_clock::now();
+
+		long long ticks = 0;
+		int completed = 0;
+		for (const EpisodeResult& result : results)
+		{
+			ticks += result.Stats.TicksSimulated;
+			completed += result.Completed ? 1 : 0;
+		}
+
+		const double seconds = std::chrono::duration<double>(endTime - startTime).count();
+		printf("Ran %i episodes (%i completed) in %.2f s: %.2f episodes/s, %.0f ticks/s\n",
+			options.Episodes, completed, seconds, seconds > 0.0 ? options.Episodes / seconds : 0.0, seconds > 0.0 ? ticks / seconds : 0.0);
+		printf("Difficulty %.2f - %.2f, enemies %i - %i, 95%% confidence intervals\n",
+			options.MinDifficulty, options.MaxDifficulty, options.MinEnemies, options.MaxEnemies);
+		printf("%-24s %5s  %-17s %-15s %-14s %s\n", "Level", "Runs", "Survived (s)", "Items", "Kills", "Died");
+		for (const std::string& level : options.Levels)
+		{
+			const size_t slash = level.find_last_of("/\\");
+			PrintSummaryRow(level.substr(slash == std::string::npos ? 0 : slash + 1).c_str(), results, configs, level);
+		}
+		if (options.Levels.size() > 1)
+		{
+			PrintSummaryRow("All", results, configs, std::string());
+		}
+
+		return completed == options.Episodes ? 0 : 1;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	HostOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--level") == 0 && hasValue) { options.LevelPath = argv[++i]; options.LevelGiven = true; }
+		else if (strcmp(argv[i], "--framework-nav") == 0) options.LocalNavigation = false;
+		else if (strcmp(argv[i], "--ticks") == 0 && hasValue) options.MaxTicks = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--dt") == 0 && hasValue) options.DeltaTime = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue) options.Seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--enemies") == 0 && hasValue) { options.Params.EnemySpawnAmount = atoi(argv[++i]); options.MinEnemies = options.MaxEnemies = options.Params.EnemySpawnAmount; options.OverrideParams = true; }
+		else if (strcmp(argv[i], "--difficulty") == 0 && hasValue) { options.Params.Difficulty = (float)atof(argv[++i]); options.MinDifficulty = options.MaxDifficulty = options.Params.Difficulty; options.Params.OverrideDifficulty = true; options.OverrideParams = true; }
+		else if (strcmp(argv[i], "--godmode") == 0) { options.Params.GodMode = true; options.OverrideParams = true; }
+		else if (strcmp(argv[i], "--verbose") == 0) options.Verbose = true;
+		else if (strcmp(argv[i], "--record") == 0 && hasValue) options.RecordPath = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && hasValue) options.ReplayPath = argv[++i];
+		else if (strcmp(argv[i], "--repeat") == 0 && hasValue) options.Repeat = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--profile") == 0 && hasValue) options.ProfilePath = argv[++i];
+		else if (strcmp(argv[i], "--tree-profile") == 0 && hasValue) options.TreeProfilePath = argv[++i];
+		else if (strcmp(argv[i], "--tree-bench") == 0 && hasValue) options.BenchmarkTrees = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--episodes") == 0 && hasValue) options.Episodes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) options.Threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--selftest") == 0) options.SelfTest = true;
+		else if (strcmp(argv[i], "--flee-weight") == 0 && hasValue) options.FleeWeightNearEnemies = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--levels") == 0 && hasValue)
+		{
+			options.Levels.clear();
+			std::stringstream levels(argv[++i]);
+			std::string level;
+			while (std::getline(levels, level, ','))
+			{
+				if (!level.empty()) options.Levels.push_back(level);
+			}
+		}
+		else if (strcmp(argv[i], "--difficulty-range") == 0 && i + 2 < argc)
+		{
+			options.MinDifficulty = (float)atof(argv[++i]);
+			options.MaxDifficulty = std::max(options.MinDifficulty, (float)atof(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--enemies-range") == 0 && i + 2 < argc)
+		{
+			options.MinEnemies = atoi(argv[++i]);
+			options.MaxEnemies = std::max(options.MinEnemies, atoi(argv[++i]));
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (options.SelfTest)
+	{
+		return SelfTest::RunAll() == 0 ? 0 : 1;
+	}
+	if (!options.ReplayPath.empty())
+	{
+		return RunReplay(options);
+	}
+	if (options.Episodes > 0)
+	{
+		if (options.Levels.empty())
+		{
+			PrintUsage();
+			return 1;
+		}
+		return RunEpisodeBatch(options);
+	}
+	if (options.BenchmarkTrees > 0)
+	{
+		return RunTreeBenchmark(options);
+	}
+	return RunSimulation(options);
+}
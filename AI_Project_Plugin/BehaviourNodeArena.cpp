@@ -0,0 +1,56 @@
+#include "stdafx.h"
+
+#include "BehaviourNodeArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+BehaviourNodeArena::BehaviourNodeArena(size_t blockSize) :
+	m_BlockSize(blockSize)
+{
+}
+
+BehaviourNodeArena::~BehaviourNodeArena()
+{
+	// Parents are created after their children, so they go first
+	for (NodeRecord* pRecord = m_pLastNode; pRecord != nullptr; pRecord = pRecord->pPrevious)
+	{
+		pRecord->pNode->~IBehaviour();
+	}
+
+	while (m_pBlock != nullptr)
+	{
+		Block* pPrevious = m_pBlock->pPrevious;
+		free(m_pBlock);
+		m_pBlock = pPrevious;
+	}
+}
+
+void* BehaviourNodeArena::Allocate(size_t size, size_t alignment)
+{
+	const size_t headerSize = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+	if (m_pBlock != nullptr)
+	{
+		const uintptr_t base = reinterpret_cast<uintptr_t>(m_pBlock) + headerSize;
+		const size_t alignedOffset = (size_t)(((base + m_Offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+		if (alignedOffset + size <= m_pBlock->Capacity)
+		{
+			m_Offset = alignedOffset + size;
+			m_Used += size;
+			return reinterpret_cast<char*>(base) + alignedOffset;
+		}
+	}
+
+	// The rest of the current block is given up, nodes are small next to a block
+	const size_t capacity = std::max(m_BlockSize, size + alignment);
+	Block* pBlock = static_cast<Block*>(malloc(headerSize + capacity));
+	if (!pBlock) throw std::bad_alloc();
+
+	pBlock->pPrevious = m_pBlock;
+	pBlock->Capacity = capacity;
+	m_pBlock = pBlock;
+	m_Offset = 0;
+	++m_BlockCount;
+	return Allocate(size, alignment);
+}
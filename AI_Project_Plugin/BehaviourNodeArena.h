@@ -0,0 +1,95 @@
+#pragma once
+
+#include "BehaviourTree.h"
+
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <utility>
+
+//-----------------------------------------------------------------
+// BEHAVIOUR NODE ARENA
+// Holds every node of a behaviour tree, and its composites' child
+// arrays, in a few large blocks instead of one heap allocation per
+// node and per child vector. Nodes are laid out in the order they're
+// created, so a tree built bottom up has each subtree in one piece
+// with the composite right after its children:
+//
+//   BehaviourNodeArena arena;
+//   IBehaviour* pRoot = arena.CreateComposite<BehaviourSelector>({
+//       arena.Create<BehaviourConditional>(&IsHungry),
+//       arena.Create<BehaviourAction>(&Wander) });
+//
+// Nodes made here don't delete their children; the arena destroys
+// all of them, newest first, when it's deleted (see BehaviourTree).
+//-----------------------------------------------------------------
+class BehaviourNodeArena final
+{
+public:
+	explicit BehaviourNodeArena(size_t blockSize = 8 * 1024);
+	~BehaviourNodeArena();
+	BehaviourNodeArena(const BehaviourNodeArena&) = delete;
+	BehaviourNodeArena& operator=(const BehaviourNodeArena&) = delete;
+
+	template<typename T, typename... Args>
+	T* Create(Args&&... args)
+	{
+		return Construct<T>(std::forward<Args>(args)...);
+	}
+	// Pure conditionals, a braced dependency list can't go through Args
+	template<typename T>
+	T* Create(PureConditional::ConditionalFn fp, std::initializer_list<int> dependencies, const char* name = nullptr)
+	{
+		return Construct<T>(fp, dependencies, name);
+	}
+	// T takes a BehaviourChildren, the child array is copied into the arena
+	template<typename T>
+	T* CreateComposite(std::initializer_list<IBehaviour*> children, const char* name = nullptr)
+	{
+		IBehaviour** pChildren = static_cast<IBehaviour**>(Allocate(children.size() * sizeof(IBehaviour*), alignof(IBehaviour*)));
+		std::copy(children.begin(), children.end(), pChildren);
+		return Construct<T>(BehaviourChildren(pChildren, (uint32_t)children.size()), name);
+	}
+
+	size_t GetUsed() const { return m_Used; }
+	unsigned int GetBlockCount() const { return m_BlockCount; }
+	unsigned int GetNodeCount() const { return m_NodeCount; }
+
+private:
+	// Precedes every node so the destructor can find them all
+	struct NodeRecord
+	{
+		IBehaviour* pNode;
+		NodeRecord* pPrevious;
+	};
+	// Precedes every block's memory
+	struct Block
+	{
+		Block* pPrevious;
+		size_t Capacity;
+	};
+
+	template<typename T, typename... Args>
+	T* Construct(Args&&... args)
+	{
+		NodeRecord* pRecord = static_cast<NodeRecord*>(Allocate(sizeof(NodeRecord), alignof(NodeRecord)));
+		T* pNode = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		pNode->m_OwnsChildren = false;
+
+		pRecord->pNode = pNode;
+		pRecord->pPrevious = m_pLastNode;
+		m_pLastNode = pRecord;
+		++m_NodeCount;
+		return pNode;
+	}
+	void* Allocate(size_t size, size_t alignment);
+
+	size_t m_BlockSize;
+	Block* m_pBlock = nullptr;
+	size_t m_Offset = 0; // Into m_pBlock's memory
+	NodeRecord* m_pLastNode = nullptr;
+
+	size_t m_Used = 0;
+	unsigned int m_BlockCount = 0;
+	unsigned int m_NodeCount = 0;
+};
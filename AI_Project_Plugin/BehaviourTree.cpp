@@ -2,6 +2,10 @@
 #include "stdafx.h"
 
 #include "BehaviourTree.h"
+#include "BehaviourNodeArena.h"
+
+#include <mutex>
+#include <utility>
 
 //-----------------------------------------------------------------
 // Behaviour TREE COMPOSITES (IBehaviour)
@@ -9,6 +13,14 @@
 #pragma region COMPOSITES
 //SELECTOR
 BehaviourState BehaviourSelector::Execute(Blackboard* pBlackBoard)
+{
+	if (m_FailureMemo.CanSkip(pBlackBoard))
+		return m_CurrentState = Failure;
+
+	SubtreeReadScope reads(pBlackBoard);
+	return reads.End(ExecuteChildren(pBlackBoard), m_FailureMemo);
+}
+BehaviourState BehaviourSelector::ExecuteChildren(Blackboard* pBlackBoard)
 {
 	for (auto child : m_ChildrenBehaviours)
 	{
@@ -29,6 +41,14 @@ BehaviourState BehaviourSelector::Execute(Blackboard* pBlackBoard)
 }
 //SEQUENCE
 BehaviourState BehaviourSequence::Execute(Blackboard* pBlackBoard)
+{
+	if (m_FailureMemo.CanSkip(pBlackBoard))
+		return m_CurrentState = Failure;
+
+	SubtreeReadScope reads(pBlackBoard);
+	return reads.End(ExecuteChildren(pBlackBoard), m_FailureMemo);
+}
+BehaviourState BehaviourSequence::ExecuteChildren(Blackboard* pBlackBoard)
 {
 	for (auto child : m_ChildrenBehaviours)
 	{
@@ -51,6 +71,8 @@ BehaviourState BehaviourSequence::Execute(Blackboard* pBlackBoard)
 //PARTIAL SEQUENCE
 BehaviourState BehaviourPartialSequence::Execute(Blackboard* pBlackBoard)
 {
+	// The result depends on how far along we are, which isn't on the blackboard
+	pBlackBoard->AddReads(Blackboard::UntrackedBit);
 	while (m_CurrentBehaviourIndex < m_ChildrenBehaviours.size())
 	{
 		m_CurrentState = m_ChildrenBehaviours[m_CurrentBehaviourIndex]->Execute(pBlackBoard);
@@ -71,6 +93,117 @@ BehaviourState BehaviourPartialSequence::Execute(Blackboard* pBlackBoard)
 	return m_CurrentState = Success;
 }
 #pragma endregion
+//-----------------------------------------------------------------
+// Behaviour TREE BUDGET
+//-----------------------------------------------------------------
+bool BehaviourBudget::Skip(Blackboard* pBlackBoard, BehaviourState& state) const
+{
+	if (!HasRun)
+		return false;
+
+	switch (Type)
+	{
+	case BUDGET_THROTTLE:
+		if (pBlackBoard->GetSecondsElapsed() - LastSeconds >= Seconds)
+			return false;
+		state = LastState;
+		break;
+	case BUDGET_COOLDOWN:
+		if (LastState != Success || pBlackBoard->GetSecondsElapsed() - LastSeconds >= Seconds)
+			return false;
+		state = Failure;
+		break;
+	case BUDGET_EVERY_NTH_TICK:
+		if (pBlackBoard->GetTick() - LastTick >= Ticks)
+			return false;
+		state = LastState;
+		break;
+	default:
+		return false;
+	}
+
+	pBlackBoard->AddReads(Blackboard::UntrackedBit);
+	return true;
+}
+
+void BehaviourBudget::Record(Blackboard* pBlackBoard, BehaviourState state)
+{
+	HasRun = true;
+	LastState = state;
+	LastSeconds = pBlackBoard->GetSecondsElapsed();
+	LastTick = pBlackBoard->GetTick();
+}
+
+//-----------------------------------------------------------------
+// Behaviour TREE DECORATORS (IBehaviour)
+//-----------------------------------------------------------------
+BehaviourState BehaviourDecorator::Execute(Blackboard* pBlackBoard)
+{
+	if (m_pChild == nullptr)
+		return m_CurrentState = Failure;
+
+	BehaviourState state;
+	if (m_Budget.Skip(pBlackBoard, state))
+		return m_CurrentState = state;
+
+	m_CurrentState = m_pChild->Execute(pBlackBoard);
+	m_Budget.Record(pBlackBoard, m_CurrentState);
+	return m_CurrentState;
+}
+
+//-----------------------------------------------------------------
+// Behaviour TREE PURE CONDITIONAL
+//-----------------------------------------------------------------
+PureConditional::PureConditional(ConditionalFn fp, std::initializer_list<int> dependencies) :
+	fpConditional(fp)
+{
+	for (int index : dependencies)
+	{
+		DependencyMask |= Blackboard::SlotBit(index);
+	}
+	if (fp == nullptr)
+		return;
+
+	// Memo ids index every blackboard's memo array, so they're handed out process wide.
+	// A memo is only shared by nodes that agree on the dependencies, otherwise whichever
+	// registered first would decide when the others' result goes stale
+	static std::mutex s_Mutex;
+	static std::vector<std::pair<ConditionalFn, uint64_t>> s_MemoKeys;
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	for (size_t i = 0; i < s_MemoKeys.size(); i++)
+	{
+		if (s_MemoKeys[i].first == fp && s_MemoKeys[i].second == DependencyMask)
+		{
+			MemoId = (int)i;
+			return;
+		}
+	}
+	MemoId = (int)s_MemoKeys.size();
+	s_MemoKeys.push_back(std::make_pair(fp, DependencyMask));
+}
+
+bool PureConditional::Evaluate(Blackboard* pBlackBoard) const
+{
+	BlackboardMemo& memo = pBlackBoard->GetMemo(MemoId);
+	if (memo.Tick == pBlackBoard->GetTick() &&
+		pBlackBoard->SlotsUnchangedSince(DependencyMask, memo.Version))
+	{
+#ifdef _DEBUG
+		if (fpConditional(pBlackBoard) != memo.Result)
+		{
+			printf("ERROR: Pure conditional %i changed without any of its dependencies changing\n", MemoId);
+		}
+#endif
+		pBlackBoard->AddReads(DependencyMask);
+		return memo.Result;
+	}
+
+	memo.Result = fpConditional(pBlackBoard);
+	memo.Tick = pBlackBoard->GetTick();
+	memo.Version = pBlackBoard->GetVersion();
+	return memo.Result;
+}
+
 //-----------------------------------------------------------------
 // Behaviour TREE CONDITIONAL (IBehaviour)
 //-----------------------------------------------------------------
@@ -79,7 +212,7 @@ BehaviourState BehaviourConditional::Execute(Blackboard* pBlackBoard)
 	if (m_fpConditional == nullptr)
 		return Failure;
 
-	switch (m_fpConditional(pBlackBoard))
+	switch (IsPure() ? m_Pure.Evaluate(pBlackBoard) : m_fpConditional(pBlackBoard))
 	{
 	case true:
 		return m_CurrentState = Success;
@@ -96,7 +229,7 @@ BehaviourState BehaviourConditionalInverse::Execute(Blackboard * pBlackBoard)
 	if (m_fpConditional == nullptr)
 		return Failure;
 
-	switch (m_fpConditional(pBlackBoard))
+	switch (IsPure() ? m_Pure.Evaluate(pBlackBoard) : m_fpConditional(pBlackBoard))
 	{
 	case true:
 		return m_CurrentState = Failure;
@@ -116,3 +249,15 @@ BehaviourState BehaviourAction::Execute(Blackboard* pBlackBoard)
 
 	return m_CurrentState = m_fpAction(pBlackBoard);
 }
+
+//-----------------------------------------------------------------
+// Behaviour TREE (BASE)
+//-----------------------------------------------------------------
+BehaviourTree::~BehaviourTree()
+{
+	if (m_pNodeArena != nullptr)
+		SafeDelete(m_pNodeArena);
+	else
+		SafeDelete(m_pRootComposite);
+	SafeDelete(m_pBlackBoard);
+}
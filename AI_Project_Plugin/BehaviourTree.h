@@ -2,7 +2,12 @@
 
 #include "Blackboard.h"
 
+#include <algorithm>
 #include <functional>
+#include <initializer_list>
+#include <vector>
+
+class BehaviourNodeArena;
 
 //-----------------------------------------------------------------
 // Behaviour TREE HELPERS
@@ -20,66 +25,177 @@ enum BehaviourState
 class IBehaviour
 {
 public:
-	IBehaviour() {}
+	// The name is only for profiling and debug output (see FlatBehaviourTree::SetProfiling)
+	explicit IBehaviour(const char* name = nullptr) : m_Name(name) {}
 	virtual ~IBehaviour() {}
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) = 0;
+	const char* GetName() const { return m_Name; }
 
 protected:
+	friend class BehaviourNodeArena;
+
 	BehaviourState m_CurrentState = Failure;
+	const char* m_Name = nullptr;
+	bool m_OwnsChildren = true; // False when a BehaviourNodeArena destroys them
+};
+
+//-----------------------------------------------------------------
+// Behaviour TREE SUBTREE FAILURE MEMO
+// What a composite's subtree read from the blackboard (see the read
+// mask in Blackboard) the last time it failed. Until one of those
+// slots changes, running it again would fail the same way, so the
+// composite returns Failure without ticking its children. Anything
+// a subtree depends on that isn't a blackboard slot has to show up
+// as one: pointee changes through Touch, node state (like a partial
+// sequence's progress) through Blackboard::UntrackedBit. A subtree
+// that wrote to the blackboard is never skipped, its writes set that
+// bit too.
+//-----------------------------------------------------------------
+struct SubtreeFailureMemo
+{
+	uint64_t ReadMask = 0;
+	uint32_t Version = 0;
+	bool Valid = false;
+
+	bool CanSkip(Blackboard* pBlackBoard) const
+	{
+		if (!Valid || !pBlackBoard->SlotsUnchangedSince(ReadMask, Version))
+			return false;
+
+		pBlackBoard->AddReads(ReadMask);
+		return true;
+	}
+};
+
+// Wraps one run of a subtree: collects its reads and updates the memo with the result
+class SubtreeReadScope final
+{
+public:
+	SubtreeReadScope(Blackboard* pBlackBoard) :
+		m_pBlackBoard(pBlackBoard),
+		m_Version(pBlackBoard->GetVersion()),
+		m_OuterReads(pBlackBoard->ExchangeReadMask(0))
+	{}
+
+	BehaviourState End(BehaviourState state, SubtreeFailureMemo& memo)
+	{
+		const uint64_t reads = m_pBlackBoard->ExchangeReadMask(m_OuterReads);
+		m_pBlackBoard->AddReads(reads);
+
+		memo.Valid = state == Failure;
+		memo.ReadMask = reads;
+		memo.Version = m_Version;
+		return state;
+	}
+
+private:
+	Blackboard* m_pBlackBoard;
+	uint32_t m_Version; // Before the subtree ran, so its own writes invalidate the memo
+	uint64_t m_OuterReads;
 };
 
 //-----------------------------------------------------------------
 // Behaviour TREE COMPOSITES (IBehaviour)
 //-----------------------------------------------------------------
 #pragma region COMPOSITES
+// A composite's children, one pointer array
+struct BehaviourChildren
+{
+	BehaviourChildren() {}
+	BehaviourChildren(IBehaviour** pChildren, uint32_t count) :
+		pChildren(pChildren), Count(count)
+	{}
+
+	size_t size() const { return Count; }
+	bool empty() const { return Count == 0; }
+	IBehaviour* operator[](size_t index) const { return pChildren[index]; }
+	IBehaviour* const* begin() const { return pChildren; }
+	IBehaviour* const* end() const { return pChildren + Count; }
+
+	IBehaviour** pChildren = nullptr;
+	uint32_t Count = 0;
+};
+
 class BehaviourComposite : public IBehaviour
 {
 public:
-	explicit BehaviourComposite(std::vector<IBehaviour*> childrenBehaviours)
+	explicit BehaviourComposite(std::vector<IBehaviour*> childrenBehaviours, const char* name = nullptr) :
+		IBehaviour(name),
+		m_ChildrenBehaviours(new IBehaviour*[childrenBehaviours.size()], (uint32_t)childrenBehaviours.size())
+	{
+		std::copy(childrenBehaviours.begin(), childrenBehaviours.end(), m_ChildrenBehaviours.pChildren);
+	}
+	// The children and their array belong to whoever made them, see BehaviourNodeArena
+	BehaviourComposite(const BehaviourChildren& childrenBehaviours, const char* name = nullptr) :
+		IBehaviour(name),
+		m_ChildrenBehaviours(childrenBehaviours)
 	{
-		m_ChildrenBehaviours = childrenBehaviours;
+		m_OwnsChildren = false;
 	}
 	virtual ~BehaviourComposite()
 	{
+		if (!m_OwnsChildren)
+			return;
+
 		for (auto pb : m_ChildrenBehaviours)
 			SafeDelete(pb);
-		m_ChildrenBehaviours.clear();
+		delete[] m_ChildrenBehaviours.pChildren;
 	}
+	BehaviourComposite(const BehaviourComposite&) = delete;
+	BehaviourComposite& operator=(const BehaviourComposite&) = delete;
+
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override = 0;
+	const BehaviourChildren& GetChildren() const { return m_ChildrenBehaviours; }
 
 protected:
-	std::vector<IBehaviour*> m_ChildrenBehaviours = {};
+	BehaviourChildren m_ChildrenBehaviours;
+	SubtreeFailureMemo m_FailureMemo;
 };
 
 class BehaviourSelector : public BehaviourComposite
 {
 public:
-	explicit BehaviourSelector(std::vector<IBehaviour*> childrenBehaviours) :
-		BehaviourComposite(childrenBehaviours)
+	explicit BehaviourSelector(std::vector<IBehaviour*> childrenBehaviours, const char* name = nullptr) :
+		BehaviourComposite(childrenBehaviours, name)
+	{}
+	BehaviourSelector(const BehaviourChildren& childrenBehaviours, const char* name = nullptr) :
+		BehaviourComposite(childrenBehaviours, name)
 	{}
 	virtual ~BehaviourSelector()
 	{}
 
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
+
+private:
+	BehaviourState ExecuteChildren(Blackboard* pBlackBoard);
 };
 
 class BehaviourSequence : public BehaviourComposite
 {
 public:
-	explicit BehaviourSequence(std::vector<IBehaviour*> childrenBehaviours) :
-		BehaviourComposite(childrenBehaviours)
+	explicit BehaviourSequence(std::vector<IBehaviour*> childrenBehaviours, const char* name = nullptr) :
+		BehaviourComposite(childrenBehaviours, name)
+	{}
+	BehaviourSequence(const BehaviourChildren& childrenBehaviours, const char* name = nullptr) :
+		BehaviourComposite(childrenBehaviours, name)
 	{}
 	virtual ~BehaviourSequence()
 	{}
 
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
+
+private:
+	BehaviourState ExecuteChildren(Blackboard* pBlackBoard);
 };
 
 class BehaviourPartialSequence : public BehaviourSequence
 {
 public:
-	explicit BehaviourPartialSequence(std::vector<IBehaviour*> childrenBehaviours)
-		: BehaviourSequence(childrenBehaviours)
+	explicit BehaviourPartialSequence(std::vector<IBehaviour*> childrenBehaviours, const char* name = nullptr)
+		: BehaviourSequence(childrenBehaviours, name)
+	{}
+	BehaviourPartialSequence(const BehaviourChildren& childrenBehaviours, const char* name = nullptr)
+		: BehaviourSequence(childrenBehaviours, name)
 	{}
 	virtual ~BehaviourPartialSequence() {};
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
@@ -89,18 +205,139 @@ private:
 };
 #pragma endregion
 
+//-----------------------------------------------------------------
+// Behaviour TREE BUDGET
+// When a decorator ticks its child, and what it answers when it
+// doesn't. Time is the blackboard's (see Blackboard::AdvanceTime),
+// ticks are tree updates. Reused answers depend on time rather than
+// on the blackboard, so they're reported as untracked reads and the
+// composites above don't memoize them. A reused Running isn't
+// ticked either, so budget subtrees that finish in one tick.
+//-----------------------------------------------------------------
+enum eBehaviourBudget
+{
+	BUDGET_THROTTLE, // Tick the child at most once per Seconds, reuse its result in between
+	BUDGET_COOLDOWN, // After the child succeeds, fail without ticking it for Seconds
+	BUDGET_EVERY_NTH_TICK // Tick the child every Ticks updates, reuse its result in between
+};
+
+struct BehaviourBudget
+{
+	BehaviourBudget() {}
+	BehaviourBudget(eBehaviourBudget type, float seconds, uint32_t ticks) :
+		Type(type), Seconds(seconds), Ticks(ticks)
+	{}
+
+	// Returns true if the child shouldn't be ticked now, state is then the answer
+	bool Skip(Blackboard* pBlackBoard, BehaviourState& state) const;
+	// Call after ticking the child
+	void Record(Blackboard* pBlackBoard, BehaviourState state);
+
+	eBehaviourBudget Type = BUDGET_THROTTLE;
+	float Seconds = 0.0f;
+	uint32_t Ticks = 1;
+
+	bool HasRun = false;
+	BehaviourState LastState = Failure;
+	float LastSeconds = 0.0f; // Blackboard time when the child was last ticked
+	uint32_t LastTick = 0;
+};
+
+//-----------------------------------------------------------------
+// Behaviour TREE DECORATORS (IBehaviour)
+//-----------------------------------------------------------------
+#pragma region DECORATORS
+class BehaviourDecorator : public IBehaviour
+{
+public:
+	BehaviourDecorator(const BehaviourBudget& budget, IBehaviour* pChild, const char* name = nullptr) :
+		IBehaviour(name), m_Budget(budget), m_pChild(pChild)
+	{}
+	virtual ~BehaviourDecorator()
+	{
+		if (m_OwnsChildren)
+			SafeDelete(m_pChild);
+	}
+	BehaviourDecorator(const BehaviourDecorator&) = delete;
+	BehaviourDecorator& operator=(const BehaviourDecorator&) = delete;
+	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
+	IBehaviour* GetChild() const { return m_pChild; }
+	const BehaviourBudget& GetBudget() const { return m_Budget; }
+
+protected:
+	BehaviourBudget m_Budget;
+	IBehaviour* m_pChild = nullptr;
+};
+
+class BehaviourThrottle : public BehaviourDecorator
+{
+public:
+	BehaviourThrottle(float hz, IBehaviour* pChild, const char* name = nullptr) :
+		BehaviourDecorator(BehaviourBudget(BUDGET_THROTTLE, hz > 0.0f ? 1.0f / hz : 0.0f, 1), pChild, name)
+	{}
+};
+
+class BehaviourCooldown : public BehaviourDecorator
+{
+public:
+	BehaviourCooldown(float seconds, IBehaviour* pChild, const char* name = nullptr) :
+		BehaviourDecorator(BehaviourBudget(BUDGET_COOLDOWN, seconds, 1), pChild, name)
+	{}
+};
+
+class BehaviourRunEveryNthTick : public BehaviourDecorator
+{
+public:
+	BehaviourRunEveryNthTick(uint32_t n, IBehaviour* pChild, const char* name = nullptr) :
+		BehaviourDecorator(BehaviourBudget(BUDGET_EVERY_NTH_TICK, 0.0f, n > 0 ? n : 1), pChild, name)
+	{}
+};
+#pragma endregion
+
+//-----------------------------------------------------------------
+// Behaviour TREE PURE CONDITIONAL
+// A conditional whose result only depends on the listed blackboard
+// slots (and on what their pointers point at, as long as that only
+// changes between ticks). It's evaluated once per tick and the result
+// is shared by every node calling the same function with the same
+// dependencies, until one of those slots changes. Debug builds re-evaluate on every cache hit
+// and complain if the dependencies were incomplete.
+//-----------------------------------------------------------------
+struct PureConditional
+{
+	typedef bool(*ConditionalFn)(Blackboard*);
+
+	PureConditional() {}
+	PureConditional(ConditionalFn fp, std::initializer_list<int> dependencies);
+
+	bool Evaluate(Blackboard* pBlackBoard) const;
+
+	ConditionalFn fpConditional = nullptr;
+	int MemoId = -1; // Same for every PureConditional with the same function and DependencyMask
+	uint64_t DependencyMask = 0; // Blackboard::SlotBit of every dependency
+};
+
 //-----------------------------------------------------------------
 // Behaviour TREE CONDITIONAL (IBehaviour)
 //-----------------------------------------------------------------
 class BehaviourConditional : public IBehaviour
 {
 public:
-	explicit BehaviourConditional(std::function<bool(Blackboard*)> fp) : m_fpConditional(fp)
+	explicit BehaviourConditional(std::function<bool(Blackboard*)> fp, const char* name = nullptr) :
+		IBehaviour(name), m_fpConditional(fp)
+	{}
+	// Pure per tick, see PureConditional
+	BehaviourConditional(PureConditional::ConditionalFn fp, std::initializer_list<int> dependencies, const char* name = nullptr) :
+		IBehaviour(name), m_fpConditional(fp), m_Pure(fp, dependencies)
 	{}
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
+	const std::function<bool(Blackboard*)>& GetConditional() const { return m_fpConditional; }
+	bool IsPure() const { return m_Pure.MemoId != -1; }
+	const PureConditional& GetPure() const { return m_Pure; }
 
 private:
 	std::function<bool(Blackboard*)> m_fpConditional = nullptr;
+	PureConditional m_Pure;
 };
 
 //-----------------------------------------------------------------
@@ -109,12 +346,21 @@ private:
 class BehaviourConditionalInverse : public IBehaviour
 {
 public:
-	explicit BehaviourConditionalInverse(std::function<bool(Blackboard*)> fp) : m_fpConditional(fp)
+	explicit BehaviourConditionalInverse(std::function<bool(Blackboard*)> fp, const char* name = nullptr) :
+		IBehaviour(name), m_fpConditional(fp)
+	{}
+	// Pure per tick, see PureConditional
+	BehaviourConditionalInverse(PureConditional::ConditionalFn fp, std::initializer_list<int> dependencies, const char* name = nullptr) :
+		IBehaviour(name), m_fpConditional(fp), m_Pure(fp, dependencies)
 	{}
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
+	const std::function<bool(Blackboard*)>& GetConditional() const { return m_fpConditional; }
+	bool IsPure() const { return m_Pure.MemoId != -1; }
+	const PureConditional& GetPure() const { return m_Pure; }
 
 private:
 	std::function<bool(Blackboard*)> m_fpConditional = nullptr;
+	PureConditional m_Pure;
 };
 
 //-----------------------------------------------------------------
@@ -123,9 +369,11 @@ private:
 class BehaviourAction : public IBehaviour
 {
 public:
-	explicit BehaviourAction(std::function<BehaviourState(Blackboard*)> fp) : m_fpAction(fp)
+	explicit BehaviourAction(std::function<BehaviourState(Blackboard*)> fp, const char* name = nullptr) :
+		IBehaviour(name), m_fpAction(fp)
 	{}
 	virtual BehaviourState Execute(Blackboard* pBlackBoard) override;
+	const std::function<BehaviourState(Blackboard*)>& GetAction() const { return m_fpAction; }
 
 private:
 	std::function<BehaviourState(Blackboard*)> m_fpAction = nullptr;
@@ -133,6 +381,8 @@ private:
 
 //-----------------------------------------------------------------
 // Behaviour TREE (BASE)
+// Owns its blackboard and nodes. Nodes either come from new, then the
+// root deletes the rest, or all come from one BehaviourNodeArena.
 //-----------------------------------------------------------------
 class BehaviourTree final
 {
@@ -140,26 +390,34 @@ public:
 	explicit BehaviourTree(Blackboard* pBlackBoard, IBehaviour* pRootComposite)
 		: m_pBlackBoard(pBlackBoard), m_pRootComposite(pRootComposite)
 	{};
-	~BehaviourTree()
-	{
-		SafeDelete(m_pRootComposite);
-		SafeDelete(m_pBlackBoard);
-	};
+	// pRootComposite has to have been created by pNodeArena
+	BehaviourTree(Blackboard* pBlackBoard, BehaviourNodeArena* pNodeArena, IBehaviour* pRootComposite)
+		: m_pBlackBoard(pBlackBoard), m_pNodeArena(pNodeArena), m_pRootComposite(pRootComposite)
+	{};
+	~BehaviourTree();
+	BehaviourTree(const BehaviourTree&) = delete;
+	BehaviourTree& operator=(const BehaviourTree&) = delete;
 
 	BehaviourState Update()
 	{
 		if (m_pRootComposite == nullptr)
 			return m_CurrentState = Failure;
 
+		m_pBlackBoard->BeginTick();
 		return m_CurrentState = m_pRootComposite->Execute(m_pBlackBoard);
 	}
 	Blackboard* GetBlackboard() const
 	{
 		return m_pBlackBoard;
 	}
+	IBehaviour* GetRoot() const
+	{
+		return m_pRootComposite;
+	}
 
 private:
 	BehaviourState m_CurrentState = Failure;
 	Blackboard* m_pBlackBoard = nullptr;
+	BehaviourNodeArena* m_pNodeArena = nullptr;
 	IBehaviour* m_pRootComposite = nullptr;
 };
@@ -1,34 +1,27 @@
 #pragma once
 
 #include "Blackboard.h"
+#include "BlackboardKeys.h"
+#include "BehaviourNodeArena.h"
 #include "BehaviourTree.h"
 #include "HelperStructs.h"
+#include "SpatialGrid.h"
+#include "StaticBehaviourTree.h"
 #include "SteeringBehaviours.h"
 
-#include <Box2D\Box2D.h>
+#include <Box2D/Box2D.h>
 
 // Misc
-inline bool NearestEnemyInFOV(std::vector<Enemy>* enemies, AgentInfo* pAgentInfo, Enemy& nearestEnemy, float& dist)
+inline bool NearestEnemyInFOV(SpatialGrid* pGrid, EnemyTracker* enemies, AgentInfo* pAgentInfo, Enemy& nearestEnemy, float& dist)
 {
+	dist = FLT_MAX;
 	if (enemies->empty()) return false;
 
-	float smallestDistance = FLT_MAX;
-	auto closestIter = enemies->end();
-	for (auto iter = enemies->begin(); iter != enemies->end(); ++iter)
+	int nearestEnemyHash;
+	auto inFieldOfView = [enemies](int enemyHash) { return enemies->IsInFieldOfView(enemyHash); };
+	if (pGrid->FindNearest(pAgentInfo->Position, FLT_MAX, SPATIAL_ENEMY, nearestEnemyHash, dist, inFieldOfView))
 	{
-		float dist = b2Distance(iter->Position, pAgentInfo->Position);
-		if (iter->InFieldOfView && dist < smallestDistance)
-		{
-			smallestDistance = dist;
-			closestIter = iter;
-		}
-	}
-
-	dist = smallestDistance;
-
-	if (closestIter != enemies->end())
-	{
-		nearestEnemy = *closestIter;
+		nearestEnemy = enemies->GetEnemy(enemies->IndexOf(nearestEnemyHash));
 		return true;
 	}
 
@@ -40,8 +33,8 @@ inline bool MapSearchedEntirely(Blackboard* pBlackboard)
 	std::vector<b2Vec2>* searchPoints;
 	int searchPointIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("SearchPoints", searchPoints) &&
-		pBlackboard->GetData("SearchPointIndex", searchPointIndex);
+		pBlackboard->GetData(BBKeys::SearchPoints, searchPoints) &&
+		pBlackboard->GetData(BBKeys::SearchPointIndex, searchPointIndex);
 
 	if (!dataAvailable)
 		return false;
@@ -55,9 +48,9 @@ inline bool ArrivedAtNextSearchPoint(Blackboard* pBlackboard)
 	std::vector<b2Vec2>* searchPoints;
 	int searchPointIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("SearchPoints", searchPoints) &&
-		pBlackboard->GetData("SearchPointIndex", searchPointIndex);
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::SearchPoints, searchPoints) &&
+		pBlackboard->GetData(BBKeys::SearchPointIndex, searchPointIndex);
 
 	if (!dataAvailable || !pAgentInfo)
 		return false;
@@ -78,9 +71,9 @@ inline BehaviourState SetGoalToNextSearchPoint(Blackboard* pBlackboard)
 	std::vector<b2Vec2>* searchPoints;
 	int searchPointIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("Goal", previousGoal) &&
-		pBlackboard->GetData("SearchPoints", searchPoints) &&
-		pBlackboard->GetData("SearchPointIndex", searchPointIndex);
+		pBlackboard->GetData(BBKeys::Goal, previousGoal) &&
+		pBlackboard->GetData(BBKeys::SearchPoints, searchPoints) &&
+		pBlackboard->GetData(BBKeys::SearchPointIndex, searchPointIndex);
 
 	if (!dataAvailable || searchPointIndex == searchPoints->size())
 		return Failure;
@@ -90,8 +83,8 @@ inline BehaviourState SetGoalToNextSearchPoint(Blackboard* pBlackboard)
 	if (previousGoal.Position != goal.Position)
 	{
 		printf("Set goal back to search point index: %i/%i\n", searchPointIndex, searchPoints->size());
-		pBlackboard->ChangeData("Goal", goal);
-		pBlackboard->ChangeData("GoalSet", true);
+		pBlackboard->ChangeData(BBKeys::Goal, goal);
+		pBlackboard->ChangeData(BBKeys::GoalSet, true);
 		return Success;
 	}
 
@@ -103,22 +96,22 @@ inline BehaviourState IncrementSearchPoint(Blackboard* pBlackboard)
 	std::vector<b2Vec2>* searchPoints;
 	int searchPointIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("SearchPoints", searchPoints) &&
-		pBlackboard->GetData("SearchPointIndex", searchPointIndex);
+		pBlackboard->GetData(BBKeys::SearchPoints, searchPoints) &&
+		pBlackboard->GetData(BBKeys::SearchPointIndex, searchPointIndex);
 
 	if (!dataAvailable)
 		return Failure;
 
 	int newSearchPointIndex = (searchPointIndex + 1);
-	pBlackboard->ChangeData("SearchPointIndex", newSearchPointIndex);
+	pBlackboard->ChangeData(BBKeys::SearchPointIndex, newSearchPointIndex);
 
 	if (newSearchPointIndex < (int)searchPoints->size())
 	{
 		printf("Set new search point index: %i/%i\n", newSearchPointIndex, searchPoints->size());
 		SteeringParams goal;
 		goal.Position = searchPoints->at(newSearchPointIndex);
-		pBlackboard->ChangeData("Goal", goal);
-		pBlackboard->ChangeData("GoalSet", true);
+		pBlackboard->ChangeData(BBKeys::Goal, goal);
+		pBlackboard->ChangeData(BBKeys::GoalSet, true);
 		return Success;
 	}
 
@@ -128,7 +121,7 @@ inline BehaviourState IncrementSearchPoint(Blackboard* pBlackboard)
 inline bool IsGoalSet(Blackboard* pBlackboard)
 {
 	bool goalSet;
-	bool dataAvailable = pBlackboard->GetData("GoalSet", goalSet);
+	bool dataAvailable = pBlackboard->GetData(BBKeys::GoalSet, goalSet);
 
 	if (!dataAvailable)
 		return false;
@@ -141,8 +134,8 @@ inline bool HasReachedGoal(Blackboard* pBlackboard)
 	SteeringParams goal;
 	AgentInfo* pAgentInfo = nullptr;
 	bool dataAvailable =
-		pBlackboard->GetData("Goal", goal) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo);
+		pBlackboard->GetData(BBKeys::Goal, goal) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable || !pAgentInfo)
 		return false;
@@ -154,42 +147,30 @@ inline bool HasReachedGoal(Blackboard* pBlackboard)
 
 inline BehaviourState SetGoalSetFalse(Blackboard* pBlackboard)
 {
-	pBlackboard->ChangeData("GoalSet", false);
+	pBlackboard->ChangeData(BBKeys::GoalSet, false);
 	return Failure; // Continue doing other behaviours
 }
 
 inline bool HaveInventorySpace(Blackboard* pBlackboard)
 {
-	std::vector<Item>* inventory = nullptr;
-	float maxHealth = 0;
-	bool dataAvailable = pBlackboard->GetData("Inventory", inventory);
-
-	if (!dataAvailable)
-		return false;
-
-	for (size_t i = 0; i < inventory->size(); i++)
-	{
-		if (!inventory->at(i).Valid)
-		{
-			return true;
-		}
-	}
+	InventoryModel* inventory = nullptr;
+	bool dataAvailable = pBlackboard->GetData(BBKeys::Inventory, inventory);
 
-	return false;
+	return dataAvailable && inventory->HasSpace();
 }
 
 inline bool KnowOfItemsOnGround(Blackboard* pBlackboard)
 {
-	std::vector<EntityInfo>* knownItems = nullptr;
-	std::vector<HealthPack>* knownHealthPacks = nullptr;
-	std::vector<Food>* knownFoodItems = nullptr;
-	std::vector<Pistol>* knownPistols = nullptr;
+	WorldCache<EntityInfo>* knownItems = nullptr;
+	WorldCache<HealthPack>* knownHealthPacks = nullptr;
+	WorldCache<Food>* knownFoodItems = nullptr;
+	WorldCache<Pistol>* knownPistols = nullptr;
 	float maxHealth = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("KnownItems", knownItems) &&
-		pBlackboard->GetData("KnownHealthPacks", knownHealthPacks) &&
-		pBlackboard->GetData("KnownFoodItems", knownFoodItems) &&
-		pBlackboard->GetData("KnownPistols", knownPistols);
+		pBlackboard->GetData(BBKeys::KnownItems, knownItems) &&
+		pBlackboard->GetData(BBKeys::KnownHealthPacks, knownHealthPacks) &&
+		pBlackboard->GetData(BBKeys::KnownFoodItems, knownFoodItems) &&
+		pBlackboard->GetData(BBKeys::KnownPistols, knownPistols);
 
 	if (!dataAvailable)
 		return false;
@@ -200,302 +181,106 @@ inline bool KnowOfItemsOnGround(Blackboard* pBlackboard)
 			!knownPistols->empty());
 }
 
-inline BehaviourState SetNearestItemInRangeAsGoal(Blackboard* pBlackboard)
+// Goes for the nearest item of the most useful kind: food, health, then pistols,
+// then items we haven't identified yet. The nearest of every kind comes from a
+// single walk over the grid, inRangeOnly limits it to a few FOVs away
+inline BehaviourState SetGoalToPreferredNearbyItem(Blackboard* pBlackboard, bool inRangeOnly)
 {
 	SteeringParams previousGoal;
-	std::vector<Item>* inventory;
-	std::vector<EntityInfo>* knownItems = nullptr;
-	std::vector<HealthPack>* knownHealthPacks = nullptr;
-	std::vector<Food>* knownFoodItems = nullptr;
-	std::vector<Pistol>* knownPistols = nullptr;
+	WorldCache<EntityInfo>* knownItems = nullptr;
+	WorldCache<HealthPack>* knownHealthPacks = nullptr;
+	WorldCache<Food>* knownFoodItems = nullptr;
+	WorldCache<Pistol>* knownPistols = nullptr;
+	SpatialGrid* pGrid = nullptr;
 	AgentInfo* pAgentInfo = nullptr;
 	float maxHealth = 0;
 	float maxEnergy = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("Goal", previousGoal) &&
-		pBlackboard->GetData("Inventory", inventory) &&
-		pBlackboard->GetData("KnownItems", knownItems) &&
-		pBlackboard->GetData("KnownHealthPacks", knownHealthPacks) &&
-		pBlackboard->GetData("KnownFoodItems", knownFoodItems) &&
-		pBlackboard->GetData("KnownPistols", knownPistols) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("MaxHealth", maxHealth) &&
-		pBlackboard->GetData("MaxEnergy", maxEnergy);
-
+		pBlackboard->GetData(BBKeys::Goal, previousGoal) &&
+		pBlackboard->GetData(BBKeys::KnownItems, knownItems) &&
+		pBlackboard->GetData(BBKeys::KnownHealthPacks, knownHealthPacks) &&
+		pBlackboard->GetData(BBKeys::KnownFoodItems, knownFoodItems) &&
+		pBlackboard->GetData(BBKeys::KnownPistols, knownPistols) &&
+		pBlackboard->GetData(BBKeys::KnownEntityGrid, pGrid) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::MaxHealth, maxHealth) &&
+		pBlackboard->GetData(BBKeys::MaxEnergy, maxEnergy);
 
 	if (!dataAvailable || !pAgentInfo)
 		return Failure;
 
-	float maxRange = pAgentInfo->FOV_Range * 3.0f;
+	float maxRange = inRangeOnly ? pAgentInfo->FOV_Range * 3.0f : FLT_MAX;
 
 	float neededHealth = maxHealth - pAgentInfo->Health;
 	float neededEnergy = maxEnergy - pAgentInfo->Energy;
 
-	float nearestHealthPackDist = maxRange;
-	int nearestHealthPackIndex = -1;
-	for (size_t i = 0; i < knownHealthPacks->size(); i++)
-	{
-		const float dist = b2Distance(knownHealthPacks->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestHealthPackDist)
-		{
-			nearestHealthPackDist = dist;
-			nearestHealthPackIndex = i;
-		}
-	}
-
-	float nearestFoodItemDist = maxRange;
-	int nearestFoodItemIndex = -1;
-	for (size_t i = 0; i < knownFoodItems->size(); i++)
-	{
-		const float dist = b2Distance(knownFoodItems->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestFoodItemDist)
-		{
-			nearestFoodItemDist = dist;
-			nearestFoodItemIndex = i;
-		}
-	}
-
-	float nearestPistolDist = maxRange;
-	int nearestPistolIndex = -1;
-	for (size_t i = 0; i < knownPistols->size(); i++)
-	{
-		const float dist = b2Distance(knownPistols->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestPistolDist)
-		{
-			nearestPistolDist = dist;
-			nearestPistolIndex = i;
-		}
-	}
+	// SPATIAL_ITEM holds the items we haven't gotten close enough to to find out what they are
+	SpatialNearestResult nearest;
+	pGrid->FindNearestOfEach(pAgentInfo->Position, maxRange, SPATIAL_ALL_ITEMS, nearest);
+	if (nearest.FoundMask == 0)
+		return Failure;
 
-	// The items we haven't gotten close enough to to find out what they are
-	float nearestItemDist = maxRange;
-	int nearestItemIndex = -1;
-	for (size_t i = 0; i < knownItems->size(); i++)
-	{
-		const float dist = b2Distance(knownItems->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestItemDist)
-		{
-			nearestItemDist = dist;
-			nearestItemIndex = i;
-		}
-	}
+	const bool foundFoodItem = nearest.Has(SPATIAL_FOOD);
+	const bool foundHealthPack = nearest.Has(SPATIAL_HEALTH);
+	const bool foundPistol = nearest.Has(SPATIAL_PISTOL);
 
+	b2Vec2 goalPosition;
+	const char* goalName = nullptr;
 	// Prioritize FOOD
-	if (nearestFoodItemIndex != -1)
+	if (foundFoodItem)
 	{
-		Food nearestFoodItem = knownFoodItems->at(nearestFoodItemIndex);
-		if (nearestFoodItem.EnergyAmount >= neededEnergy ||
-			nearestPistolIndex == -1)
+		const Food& nearestFoodItem = *knownFoodItems->Find(nearest.GetKey(SPATIAL_FOOD));
+		if (nearestFoodItem.EnergyAmount >= neededEnergy || !foundPistol)
 		{
-			SteeringParams goal = {};
-			goal.Position = nearestFoodItem.Position;
-			if (previousGoal.Position != goal.Position)
-			{
-				printf("Set goal of food\n");
-				pBlackboard->ChangeData("Goal", goal);
-				pBlackboard->ChangeData("GoalSet", true);
-			}
-			return Success;
+			goalPosition = nearestFoodItem.Position;
+			goalName = "food";
 		}
 	}
 	// Then HEALTH
-	if (nearestHealthPackIndex != -1)
+	if (!goalName && foundHealthPack)
 	{
-		HealthPack nearestHealthPack = knownHealthPacks->at(nearestHealthPackIndex);
-		if (neededHealth >= nearestHealthPack.HealingAmount ||
-			(nearestFoodItemIndex == -1 && nearestPistolIndex == -1))
+		const HealthPack& nearestHealthPack = *knownHealthPacks->Find(nearest.GetKey(SPATIAL_HEALTH));
+		if (neededHealth >= nearestHealthPack.HealingAmount || (!foundFoodItem && !foundPistol))
 		{
-			SteeringParams goal = {};
-			goal.Position = nearestHealthPack.Position;
-			if (previousGoal.Position != goal.Position)
-			{
-				printf("Set goal of health\n");
-				pBlackboard->ChangeData("Goal", goal);
-				pBlackboard->ChangeData("GoalSet", true);
-			}
-			return Success;
+			goalPosition = nearestHealthPack.Position;
+			goalName = "health";
 		}
 	}
-
 	// Then PISTOLS
-	if (nearestPistolIndex != -1)
+	if (!goalName && foundPistol)
 	{
-		Pistol nearestPistol = knownPistols->at(nearestFoodItemIndex);
-		SteeringParams goal = {};
-		goal.Position = nearestPistol.Position;
-		if (previousGoal.Position != goal.Position)
-		{
-			printf("Set goal of pistol\n");
-			pBlackboard->ChangeData("Goal", goal);
-			pBlackboard->ChangeData("GoalSet", true);
-		}
-		return Success;
+		goalPosition = knownPistols->Find(nearest.GetKey(SPATIAL_PISTOL))->Position;
+		goalName = "pistol";
 	}
-
 	// Then ITEMS we haven't inspected yet (could be garbage)
-	if (nearestItemIndex != -1)
+	if (!goalName && nearest.Has(SPATIAL_ITEM))
 	{
-		EntityInfo nearestItem = knownItems->at(nearestItemIndex);
-		SteeringParams goal = {};
-		goal.Position = nearestItem.Position;
-		if (previousGoal.Position != goal.Position)
-		{
-			printf("Set goal of nearest item!\n");
-			pBlackboard->ChangeData("Goal", goal);
-			pBlackboard->ChangeData("GoalSet", true);
-		}
-		return Success;
+		goalPosition = knownItems->Find(nearest.GetKey(SPATIAL_ITEM))->Position;
+		goalName = "nearest item!";
 	}
 
-	return Failure;
-}
-
-inline BehaviourState SetNearestItemAsGoal(Blackboard* pBlackboard)
-{
-	SteeringParams previousGoal;
-	std::vector<Item>* inventory;
-	std::vector<EntityInfo>* knownItems = nullptr;
-	std::vector<HealthPack>* knownHealthPacks = nullptr;
-	std::vector<Food>* knownFoodItems = nullptr;
-	std::vector<Pistol>* knownPistols = nullptr;
-	AgentInfo* pAgentInfo = nullptr;
-	float maxHealth = 0;
-	float maxEnergy = 0;
-	bool dataAvailable =
-		pBlackboard->GetData("Goal", previousGoal) &&
-		pBlackboard->GetData("Inventory", inventory) &&
-		pBlackboard->GetData("KnownItems", knownItems) &&
-		pBlackboard->GetData("KnownHealthPacks", knownHealthPacks) &&
-		pBlackboard->GetData("KnownFoodItems", knownFoodItems) &&
-		pBlackboard->GetData("KnownPistols", knownPistols) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("MaxHealth", maxHealth) &&
-		pBlackboard->GetData("MaxEnergy", maxEnergy);
-
-
-	if (!dataAvailable || !pAgentInfo)
+	if (!goalName)
 		return Failure;
 
-	float neededHealth = maxHealth - pAgentInfo->Health;
-	float neededEnergy = maxEnergy - pAgentInfo->Energy;
-
-	float nearestHealthPackDist = FLT_MAX;
-	int nearestHealthPackIndex = -1;
-	for (size_t i = 0; i < knownHealthPacks->size(); i++)
-	{
-		const float dist = b2Distance(knownHealthPacks->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestHealthPackDist)
-		{
-			nearestHealthPackDist = dist;
-			nearestHealthPackIndex = i;
-		}
-	}
-
-	float nearestFoodItemDist = FLT_MAX;
-	int nearestFoodItemIndex = -1;
-	for (size_t i = 0; i < knownFoodItems->size(); i++)
-	{
-		const float dist = b2Distance(knownFoodItems->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestFoodItemDist)
-		{
-			nearestFoodItemDist = dist;
-			nearestFoodItemIndex = i;
-		}
-	}
-
-	float nearestPistolDist = FLT_MAX;
-	int nearestPistolIndex = -1;
-	for (size_t i = 0; i < knownPistols->size(); i++)
-	{
-		const float dist = b2Distance(knownPistols->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestPistolDist)
-		{
-			nearestPistolDist = dist;
-			nearestPistolIndex = i;
-		}
-	}
-
-	// The items we haven't gotten close enough to to find out what they are
-	float nearestItemDist = FLT_MAX;
-	int nearestItemIndex = -1;
-	for (size_t i = 0; i < knownItems->size(); i++)
-	{
-		const float dist = b2Distance(knownItems->at(i).Position, pAgentInfo->Position);
-		if (dist < nearestItemDist)
-		{
-			nearestItemDist = dist;
-			nearestItemIndex = i;
-		}
-	}
-
-	// Prioritize FOOD
-	if (nearestFoodItemIndex != -1)
-	{
-		Food nearestFoodItem = knownFoodItems->at(nearestFoodItemIndex);
-		if (nearestFoodItem.EnergyAmount >= neededEnergy ||
-			nearestPistolIndex == -1)
-		{
-			SteeringParams goal = {};
-			goal.Position = nearestFoodItem.Position;
-			if (previousGoal.Position != goal.Position)
-			{
-				printf("Set goal of food\n");
-				pBlackboard->ChangeData("Goal", goal);
-				pBlackboard->ChangeData("GoalSet", true);
-			}
-			return Success;
-		}
-	}
-	// Then HEALTH
-	if (nearestHealthPackIndex != -1)
-	{
-		HealthPack nearestHealthPack = knownHealthPacks->at(nearestHealthPackIndex);
-		if (neededHealth >= nearestHealthPack.HealingAmount || 
-			(nearestFoodItemIndex == -1 && nearestPistolIndex == -1))
-		{
-			SteeringParams goal = {};
-			goal.Position = nearestHealthPack.Position;
-			if (previousGoal.Position != goal.Position)
-			{
-				printf("Set goal of health\n");
-				pBlackboard->ChangeData("Goal", goal);
-				pBlackboard->ChangeData("GoalSet", true);
-			}
-			return Success;
-		}
-	}
-
-	// Then PISTOLS
-	if (nearestPistolIndex != -1)
+	SteeringParams goal = {};
+	goal.Position = goalPosition;
+	if (previousGoal.Position != goal.Position)
 	{
-		Pistol nearestPistol = knownPistols->at(nearestFoodItemIndex);
-		SteeringParams goal = {};
-		goal.Position = nearestPistol.Position;
-		if (previousGoal.Position != goal.Position)
-		{
-			printf("Set goal of pistol\n");
-			pBlackboard->ChangeData("Goal", goal);
-			pBlackboard->ChangeData("GoalSet", true);
-		}
-		return Success;
+		printf("Set goal of %s\n", goalName);
+		pBlackboard->ChangeData(BBKeys::Goal, goal);
+		pBlackboard->ChangeData(BBKeys::GoalSet, true);
 	}
+	return Success;
+}
 
-	// Then ITEMS we haven't inspected yet (could be garbage)
-	if (nearestItemIndex != -1)
-	{
-		EntityInfo nearestItem = knownItems->at(nearestItemIndex);
-		SteeringParams goal = {};
-		goal.Position = nearestItem.Position;
-		if (previousGoal.Position != goal.Position)
-		{
-			printf("Set goal of nearest item!\n");
-			pBlackboard->ChangeData("Goal", goal);
-			pBlackboard->ChangeData("GoalSet", true);
-		}
-		return Success;
-	}
+inline BehaviourState SetNearestItemInRangeAsGoal(Blackboard* pBlackboard)
+{
+	return SetGoalToPreferredNearbyItem(pBlackboard, true);
+}
 
-	return Failure;
+inline BehaviourState SetNearestItemAsGoal(Blackboard* pBlackboard)
+{
+	return SetGoalToPreferredNearbyItem(pBlackboard, false);
 }
 
 inline BehaviourState SetGoalToNearestUnexploredHouse(Blackboard* pBlackboard)
@@ -504,9 +289,9 @@ inline BehaviourState SetGoalToNearestUnexploredHouse(Blackboard* pBlackboard)
 	AgentInfo* pAgentInfo = nullptr;
 	std::vector<House>* pKnownHouses = nullptr;
 	bool dataAvailable =
-		pBlackboard->GetData("Goal", previousGoal) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("KnownHouses", pKnownHouses);
+		pBlackboard->GetData(BBKeys::Goal, previousGoal) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::KnownHouses, pKnownHouses);
 
 	if (!dataAvailable || !pAgentInfo || !pKnownHouses)
 		return Failure;
@@ -536,8 +321,8 @@ inline BehaviourState SetGoalToNearestUnexploredHouse(Blackboard* pBlackboard)
 		if (goal.Position != previousGoal.Position)
 		{
 			printf("Set goal of nearest unexplored house!\n");
-			pBlackboard->ChangeData("Goal", goal);
-			pBlackboard->ChangeData("GoalSet", true);
+			pBlackboard->ChangeData(BBKeys::Goal, goal);
+			pBlackboard->ChangeData(BBKeys::GoalSet, true);
 		}
 		return Success;
 	}
@@ -550,7 +335,7 @@ inline bool KnowOfUnexploredHouse(Blackboard* pBlackboard)
 	std::vector<House>* knownHouses = nullptr;
 	float maxHealth = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("KnownHouses", knownHouses);
+		pBlackboard->GetData(BBKeys::KnownHouses, knownHouses);
 
 	if (!dataAvailable || knownHouses->empty())
 		return false;
@@ -568,25 +353,10 @@ inline bool KnowOfUnexploredHouse(Blackboard* pBlackboard)
 
 inline bool KnownHouseNotRecentlyVisited(Blackboard* pBlackboard)
 {
-	float secondsBetweenRevisits;
-	std::vector<House>* knownHouses = nullptr;
-	float maxHealth = 0;
-	bool dataAvailable =
-		pBlackboard->GetData("SecondsBetweenHouseRevisits", secondsBetweenRevisits) &&
-		pBlackboard->GetData("KnownHouses", knownHouses);
-
-	if (!dataAvailable || knownHouses->empty())
-		return false;
+	int housesDueForRevisit = 0;
+	bool dataAvailable = pBlackboard->GetData(BBKeys::HousesDueForRevisit, housesDueForRevisit);
 
-	for (size_t i = 0; i < knownHouses->size(); i++)
-	{
-		if (knownHouses->at(i).SecondsSinceLastVisit >= secondsBetweenRevisits)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return dataAvailable && housesDueForRevisit > 0;
 }
 
 inline bool CurrentlyInsideNextHouse(Blackboard* pBlackboard)
@@ -594,8 +364,8 @@ inline bool CurrentlyInsideNextHouse(Blackboard* pBlackboard)
 	int houseIndex;
 	int nextHouseIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("InsideHouseIndex", houseIndex) &&
-		pBlackboard->GetData("NextHouseIndex", nextHouseIndex);
+		pBlackboard->GetData(BBKeys::InsideHouseIndex, houseIndex) &&
+		pBlackboard->GetData(BBKeys::NextHouseIndex, nextHouseIndex);
 
 	if (!dataAvailable)
 		return false;
@@ -611,9 +381,9 @@ inline BehaviourState IncrementNextHouseIndex(Blackboard* pBlackboard)
 	std::vector<House>* knownHouses;
 	int nextHouseIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("KnownHouses", knownHouses) &&
-		pBlackboard->GetData("NextHouseIndex", nextHouseIndex) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo);
+		pBlackboard->GetData(BBKeys::KnownHouses, knownHouses) &&
+		pBlackboard->GetData(BBKeys::NextHouseIndex, nextHouseIndex) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable || knownHouses->empty())
 		return Failure;
@@ -624,7 +394,7 @@ inline BehaviourState IncrementNextHouseIndex(Blackboard* pBlackboard)
 	}
 
 	int newNextHouseIndex = (nextHouseIndex + 1) % knownHouses->size();
-	pBlackboard->ChangeData("NextHouseIndex", newNextHouseIndex);
+	pBlackboard->ChangeData(BBKeys::NextHouseIndex, newNextHouseIndex);
 	printf("Incremented next house, index to: %i/%i\n", newNextHouseIndex, knownHouses->size());
 
 	return Success;
@@ -636,9 +406,9 @@ inline BehaviourState SetGoalToNextHouse(Blackboard* pBlackboard)
 	std::vector<House>* knownHouses;
 	int nextHouseIndex;
 	bool dataAvailable =
-		pBlackboard->GetData("KnownHouses", knownHouses) &&
-		pBlackboard->GetData("NextHouseIndex", nextHouseIndex) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo);
+		pBlackboard->GetData(BBKeys::KnownHouses, knownHouses) &&
+		pBlackboard->GetData(BBKeys::NextHouseIndex, nextHouseIndex) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable || knownHouses->empty())
 		return Failure;
@@ -651,8 +421,8 @@ inline BehaviourState SetGoalToNextHouse(Blackboard* pBlackboard)
 	printf("Set goal to next house, index %i/%i\n", nextHouseIndex, knownHouses->size());
 	SteeringParams goal;
 	goal.Position = knownHouses->at(nextHouseIndex).Info.Center;
-	pBlackboard->ChangeData("Goal", goal);
-	pBlackboard->ChangeData("GoalSet", true);
+	pBlackboard->ChangeData(BBKeys::Goal, goal);
+	pBlackboard->ChangeData(BBKeys::GoalSet, true);
 
 	return Success;
 }
@@ -663,8 +433,8 @@ inline bool NotMaxHealth(Blackboard* pBlackboard)
 	AgentInfo* pAgentInfo = nullptr;
 	float maxHealth = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("MaxHealth", maxHealth);
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::MaxHealth, maxHealth);
 
 	if (!dataAvailable || !pAgentInfo)
 		return false;
@@ -683,8 +453,8 @@ inline bool LowHealth(Blackboard* pBlackboard)
 	AgentInfo* pAgentInfo = nullptr;
 	float maxHealth = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("MaxHealth", maxHealth);
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::MaxHealth, maxHealth);
 
 	if (!dataAvailable || !pAgentInfo)
 		return false;
@@ -700,9 +470,9 @@ inline bool LowHealth(Blackboard* pBlackboard)
 
 inline bool KnowLocationOfHealthPacks(Blackboard* pBlackboard)
 {
-	std::vector<HealthPack>* knownHealthPacks = nullptr;
+	WorldCache<HealthPack>* knownHealthPacks = nullptr;
 	float maxHealth = 0;
-	bool dataAvailable = pBlackboard->GetData("KnownHealthPacks", knownHealthPacks);
+	bool dataAvailable = pBlackboard->GetData(BBKeys::KnownHealthPacks, knownHealthPacks);
 
 	if (!dataAvailable)
 		return false;
@@ -713,34 +483,26 @@ inline bool KnowLocationOfHealthPacks(Blackboard* pBlackboard)
 inline BehaviourState SetClosestKnownHealthPackAsGoal(Blackboard* pBlackboard)
 {
 	AgentInfo* pAgentInfo = nullptr;
-	std::vector<HealthPack>* knownHealthPacks = nullptr;
+	WorldCache<HealthPack>* knownHealthPacks = nullptr;
+	SpatialGrid* pGrid = nullptr;
 	float maxHealth = 0;
 	bool dataAvailable = 
-		pBlackboard->GetData("KnownHealthPacks", knownHealthPacks) && 
-		pBlackboard->GetData("AgentInfo", pAgentInfo);
+		pBlackboard->GetData(BBKeys::KnownHealthPacks, knownHealthPacks) && 
+		pBlackboard->GetData(BBKeys::KnownEntityGrid, pGrid) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable)
 		return Failure;
 
-	float closestPackDist = FLT_MAX;
-	int closestPackIndex = -1;
-	for (size_t i = 0; i < knownHealthPacks->size(); i++)
-	{
-		float dist = b2Distance(knownHealthPacks->at(i).Position, pAgentInfo->Position);
-		if (dist < closestPackDist)
-		{
-			closestPackDist = dist;
-			closestPackIndex = i;
-		}
-	}
-
-	if (closestPackIndex != -1)
+	float closestPackDist;
+	int closestPackHash;
+	if (pGrid->FindNearest(pAgentInfo->Position, FLT_MAX, SPATIAL_HEALTH, closestPackHash, closestPackDist))
 	{
 		printf("Set goal of closest health pack!\n");
 		SteeringParams goal = {};
-		goal.Position = knownHealthPacks->at(closestPackIndex).Position;
-		pBlackboard->ChangeData("Goal", goal);
-		pBlackboard->ChangeData("GoalSet", true);
+		goal.Position = knownHealthPacks->Find(closestPackHash)->Position;
+		pBlackboard->ChangeData(BBKeys::Goal, goal);
+		pBlackboard->ChangeData(BBKeys::GoalSet, true);
 		return Success;
 	}
 
@@ -749,32 +511,21 @@ inline BehaviourState SetClosestKnownHealthPackAsGoal(Blackboard* pBlackboard)
 
 inline bool HasHealthItem(Blackboard* pBlackboard)
 {
-	std::vector<Item>* inventory = nullptr;
-	bool dataAvailable = pBlackboard->GetData("Inventory", inventory);
-
-	if (!dataAvailable || inventory->empty())
-		return false;
-
-	for (size_t i = 0; i < inventory->size(); i++)
-	{
-		if (inventory->at(i).Valid && inventory->at(i).ItemInfo.Type == eItemType::HEALTH)
-		{
-			return true;
-		}
-	}
+	InventoryModel* inventory = nullptr;
+	bool dataAvailable = pBlackboard->GetData(BBKeys::Inventory, inventory);
 
-	return false;
+	return dataAvailable && inventory->Has(eItemType::HEALTH);
 }
 
 inline BehaviourState UseHealthItem(Blackboard* pBlackboard)
 {
 	AgentInfo* pAgentInfo = nullptr;
-	bool dataAvailable = pBlackboard->GetData("AgentInfo", pAgentInfo);
+	bool dataAvailable = pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable || !pAgentInfo)
 		return Failure;
 
-	pBlackboard->ChangeData("UseHealthItem", true);
+	pBlackboard->ChangeData(BBKeys::UseHealthItem, true);
 
 	return Failure; // Continue with other sequences (we might not be hurt enough to use health yet)
 }
@@ -785,8 +536,8 @@ inline bool NotMaxEnergy(Blackboard* pBlackboard)
 	AgentInfo* pAgentInfo = nullptr;
 	float maxEnergy = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("MaxEnergy", maxEnergy);
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::MaxEnergy, maxEnergy);
 
 	if (!dataAvailable || !pAgentInfo)
 		return false;
@@ -805,8 +556,8 @@ inline bool LowEnergy(Blackboard* pBlackboard)
 	AgentInfo* pAgentInfo = nullptr;
 	float maxEnergy = 0;
 	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("MaxEnergy", maxEnergy);
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo) &&
+		pBlackboard->GetData(BBKeys::MaxEnergy, maxEnergy);
 
 	if (!dataAvailable || !pAgentInfo)
 		return false;
@@ -822,28 +573,17 @@ inline bool LowEnergy(Blackboard* pBlackboard)
 
 inline bool HasFoodItem(Blackboard* pBlackboard)
 {
-	std::vector<Item>* inventory = nullptr;
-	bool dataAvailable = pBlackboard->GetData("Inventory", inventory);
-
-	if (!dataAvailable || inventory->empty())
-		return false;
+	InventoryModel* inventory = nullptr;
+	bool dataAvailable = pBlackboard->GetData(BBKeys::Inventory, inventory);
 
-	for (size_t i = 0; i < inventory->size(); i++)
-	{
-		if (inventory->at(i).Valid && inventory->at(i).ItemInfo.Type == eItemType::FOOD)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return dataAvailable && inventory->Has(eItemType::FOOD);
 }
 
 inline bool KnowLocationOfFoodItems(Blackboard* pBlackboard)
 {
-	std::vector<Food>* knownFoodItems = nullptr;
+	WorldCache<Food>* knownFoodItems = nullptr;
 	float maxHealth = 0;
-	bool dataAvailable = pBlackboard->GetData("KnownFoodItems", knownFoodItems);
+	bool dataAvailable = pBlackboard->GetData(BBKeys::KnownFoodItems, knownFoodItems);
 
 	if (!dataAvailable)
 		return false;
@@ -854,33 +594,25 @@ inline bool KnowLocationOfFoodItems(Blackboard* pBlackboard)
 inline BehaviourState SetClosestKnownFoodItemAsGoal(Blackboard* pBlackboard)
 {
 	AgentInfo* pAgentInfo = nullptr;
-	std::vector<Food>* knownFoodItems = nullptr;
+	WorldCache<Food>* knownFoodItems = nullptr;
+	SpatialGrid* pGrid = nullptr;
 	bool dataAvailable =
-		pBlackboard->GetData("KnownFoodItems", knownFoodItems) &&
-		pBlackboard->GetData("AgentInfo", pAgentInfo);
+		pBlackboard->GetData(BBKeys::KnownFoodItems, knownFoodItems) &&
+		pBlackboard->GetData(BBKeys::KnownEntityGrid, pGrid) &&
+		pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable)
 		return Failure;
 
-	float closestFoodItemDist = FLT_MAX;
-	int closestFoodItemIndex = -1;
-	for (size_t i = 0; i < knownFoodItems->size(); i++)
-	{
-		float dist = b2Distance(knownFoodItems->at(i).Position, pAgentInfo->Position);
-		if (dist < closestFoodItemDist)
-		{
-			closestFoodItemDist = dist;
-			closestFoodItemIndex = i;
-		}
-	}
-
-	if (closestFoodItemIndex != -1)
+	float closestFoodItemDist;
+	int closestFoodItemHash;
+	if (pGrid->FindNearest(pAgentInfo->Position, FLT_MAX, SPATIAL_FOOD, closestFoodItemHash, closestFoodItemDist))
 	{
 		printf("Set goal of closest food item!\n");
 		SteeringParams goal = {};
-		goal.Position = knownFoodItems->at(closestFoodItemIndex).Position;
-		pBlackboard->ChangeData("Goal", goal);
-		pBlackboard->ChangeData("GoalSet", true);
+		goal.Position = knownFoodItems->Find(closestFoodItemHash)->Position;
+		pBlackboard->ChangeData(BBKeys::Goal, goal);
+		pBlackboard->ChangeData(BBKeys::GoalSet, true);
 		return Success;
 	}
 
@@ -890,12 +622,12 @@ inline BehaviourState SetClosestKnownFoodItemAsGoal(Blackboard* pBlackboard)
 inline BehaviourState UseFoodItem(Blackboard* pBlackboard)
 {
 	AgentInfo* pAgentInfo = nullptr;
-	bool dataAvailable = pBlackboard->GetData("AgentInfo", pAgentInfo);
+	bool dataAvailable = pBlackboard->GetData(BBKeys::AgentInfo, pAgentInfo);
 
 	if (!dataAvailable || !pAgentInfo)
 		return Failure;
 
-	pBlackboard->ChangeData("UseFoodItem", true);
+	pBlackboard->ChangeData(BBKeys::UseFoodItem, true);
 
 	return Failure; // Continue with other sequences (we might not be hungry enough to eat yet)
 }
@@ -908,90 +640,165 @@ inline bool LowEnergyOrHealth(Blackboard* pBlackboard)
 // Shooting
 inline bool HasLoadedPistol(Blackboard* pBlackboard)
 {
-	std::vector<Item>* inventory = nullptr;
-	bool dataAvailable = pBlackboard->GetData("Inventory", inventory);
-
-	if (!dataAvailable)
-		return false;
-
-	for (size_t i = 0; i < inventory->size(); i++)
-	{
-		if (inventory->at(i).Valid && 
-			inventory->at(i).ItemInfo.Type == eItemType::PISTOL)
-		{
-			return true;
-		}
-	}
+	InventoryModel* inventory = nullptr;
+	bool dataAvailable = pBlackboard->GetData(BBKeys::Inventory, inventory);
 
-	return false;
+	return dataAvailable && inventory->Has(eItemType::PISTOL);
 }
 
 inline bool HasEnemyInFOV(Blackboard* pBlackboard)
 {
-	AgentInfo* pAgentInfo = nullptr;
-	std::vector<Enemy>* knownEnemies = nullptr;
-	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("KnownEnemies", knownEnemies);
-
-	if (!dataAvailable || !pAgentInfo)
+	NearestEnemyQuery nearestEnemy;
+	if (!pBlackboard->GetData(BBKeys::NearestEnemy, nearestEnemy))
 		return false;
 
-	float dist;
-	Enemy nearestEnemy;
-	if (NearestEnemyInFOV(knownEnemies, pAgentInfo, nearestEnemy, dist))
-	{
-		return true;
-	}
-
-	return false;
+	return nearestEnemy.Found;
 }
 
 // Returns true if any enemy is within range of the agent's longest range pistol
 inline bool HasEnemyInRange(Blackboard* pBlackboard)
 {
-	AgentInfo* pAgentInfo = nullptr;
-	std::vector<Enemy>* knownEnemies = nullptr;
+	NearestEnemyQuery nearestEnemy;
 	float longestPistolRange;
 	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("KnownEnemies", knownEnemies) &&
-		pBlackboard->GetData("LongestPistolRange", longestPistolRange);
+		pBlackboard->GetData(BBKeys::NearestEnemy, nearestEnemy) &&
+		pBlackboard->GetData(BBKeys::LongestPistolRange, longestPistolRange);
 
-	if (!dataAvailable || !pAgentInfo || longestPistolRange == 0.0f)
+	if (!dataAvailable || longestPistolRange == 0.0f)
 		return false;
 
-	float dist;
-	Enemy nearestEnemy;
-	if (NearestEnemyInFOV(knownEnemies, pAgentInfo, nearestEnemy, dist))
-	{
-		if (dist < longestPistolRange)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return nearestEnemy.Found && nearestEnemy.Distance < longestPistolRange;
 }
 
+// Succeeds once it has set TargetEnemy. Update clears the target before every tick and
+// only failed subtrees get skipped by the failure memo, so a tick that aims always runs this
 inline BehaviourState AimAtNearestEnemyInFOV(Blackboard* pBlackboard)
 {
-	std::vector<Enemy>* knownEnemies = nullptr;
-	AgentInfo* pAgentInfo = nullptr;
-	bool dataAvailable =
-		pBlackboard->GetData("AgentInfo", pAgentInfo) &&
-		pBlackboard->GetData("KnownEnemies", knownEnemies);
-
-	if (!dataAvailable || !pAgentInfo)
+	NearestEnemyQuery nearestEnemy;
+	if (!pBlackboard->GetData(BBKeys::NearestEnemy, nearestEnemy))
 		return Failure;
 
-	float dist;
-	Enemy nearestEnemy;
-	if (NearestEnemyInFOV(knownEnemies, pAgentInfo, nearestEnemy, dist))
+	if (nearestEnemy.Found)
 	{
-		pBlackboard->ChangeData("TargetEnemy", nearestEnemy);
-		return Failure;
+		pBlackboard->ChangeData(BBKeys::TargetEnemy, nearestEnemy.NearestEnemy);
+		return Success;
 	}
 
 	return Failure;
 }
+
+// The goal searches scan every known item or house but barely change from one
+// tick to the next, so they only run this often and reuse their result between
+const int ItemGoalHz = 10;
+const uint32_t HouseGoalTicks = 8;
+
+// The tree TestBoxPlugin runs, also used by the headless host's benchmarks.
+// Conditionals that show up more than once per tick are marked pure with the
+// slots they read (see PureConditional), so repeats are answered from the memo.
+// Leaves are named after their function and inverses get a '!', so the tree
+// profile can tell them apart.
+// Every node lives in the arena, so hand it to the BehaviourTree along with the root
+inline IBehaviour* CreateTestBoxBehaviourTree(BehaviourNodeArena& arena)
+{
+	const std::initializer_list<int> KnowOfItemsOnGroundReads =
+		{ BBKeys::KnownItems.Index, BBKeys::KnownHealthPacks.Index, BBKeys::KnownFoodItems.Index, BBKeys::KnownPistols.Index };
+
+	return arena.CreateComposite<BehaviourSelector>
+	({
+		arena.CreateComposite<BehaviourSequence> // Set GOAL to false upon arrival
+		({
+			arena.Create<BehaviourConditional>(IsGoalSet, { BBKeys::GoalSet.Index }, "IsGoalSet"),
+			arena.Create<BehaviourConditional>(HasReachedGoal, "HasReachedGoal"),
+			arena.Create<BehaviourAction>(SetGoalSetFalse, "SetGoalSetFalse")
+		}, "Set goal false on arrival"),
+		arena.CreateComposite<BehaviourSequence> // Update SEARCH POINT INDEX
+		({
+			arena.Create<BehaviourConditionalInverse>(MapSearchedEntirely, { BBKeys::SearchPoints.Index, BBKeys::SearchPointIndex.Index }, "!MapSearchedEntirely"),
+			arena.Create<BehaviourConditional>(ArrivedAtNextSearchPoint, "ArrivedAtNextSearchPoint"),
+			arena.Create<BehaviourAction>(IncrementSearchPoint, "IncrementSearchPoint")
+		}, "Update search point index"),
+		arena.CreateComposite<BehaviourSequence> // Use FOOD
+		({
+			arena.Create<BehaviourConditional>(NotMaxEnergy, "NotMaxEnergy"),
+			arena.Create<BehaviourConditional>(HasFoodItem, "HasFoodItem"),
+			arena.Create<BehaviourAction>(UseFoodItem, "UseFoodItem")
+		}, "Use food"),
+		arena.CreateComposite<BehaviourSequence> // Use HEALTH
+		({
+			arena.Create<BehaviourConditional>(NotMaxHealth, "NotMaxHealth"),
+			arena.Create<BehaviourConditional>(HasHealthItem, "HasHealthItem"),
+			arena.Create<BehaviourAction>(UseHealthItem, "UseHealthItem")
+		}, "Use health"),
+		arena.CreateComposite<BehaviourSequence> // Grab nearby ITEMS
+		({
+			arena.Create<BehaviourConditional>(HaveInventorySpace, "HaveInventorySpace"),
+			arena.Create<BehaviourConditional>(KnowOfItemsOnGround, KnowOfItemsOnGroundReads, "KnowOfItemsOnGround"),
+			arena.Create<BehaviourThrottle>(ItemGoalHz, arena.Create<BehaviourAction>(SetNearestItemInRangeAsGoal, "SetNearestItemInRangeAsGoal"), "Throttle ItemGoalHz")
+		}, "Grab nearby items"),
+		arena.CreateComposite<BehaviourSequence> // Find ITEMS (even with no inventory space, we can trade things out)
+		({
+			arena.Create<BehaviourConditional>(LowEnergyOrHealth, "LowEnergyOrHealth"),
+			arena.Create<BehaviourConditional>(KnowOfItemsOnGround, KnowOfItemsOnGroundReads, "KnowOfItemsOnGround"),
+			arena.Create<BehaviourThrottle>(ItemGoalHz, arena.Create<BehaviourAction>(SetNearestItemInRangeAsGoal, "SetNearestItemInRangeAsGoal"), "Throttle ItemGoalHz")
+		}, "Find items"),
+		arena.CreateComposite<BehaviourSequence> // Explore unexplored HOUSES
+		({
+			arena.Create<BehaviourConditional>(KnowOfUnexploredHouse, "KnowOfUnexploredHouse"),
+			arena.Create<BehaviourRunEveryNthTick>(HouseGoalTicks, arena.Create<BehaviourAction>(SetGoalToNearestUnexploredHouse, "SetGoalToNearestUnexploredHouse"), "RunEveryNthTick HouseGoalTicks")
+		}, "Explore unexplored houses"),
+		arena.CreateComposite<BehaviourSequence> // Shoot ENEMIES
+		({
+			arena.Create<BehaviourConditional>(HasLoadedPistol, "HasLoadedPistol"),
+			arena.Create<BehaviourConditional>(HasEnemyInRange, "HasEnemyInRange"),
+			arena.Create<BehaviourConditional>(HasEnemyInFOV, "HasEnemyInFOV"),
+			arena.Create<BehaviourAction>(AimAtNearestEnemyInFOV, "AimAtNearestEnemyInFOV")
+		}, "Shoot enemies"),
+		arena.CreateComposite<BehaviourSequence> // Search entire map
+		({
+			arena.Create<BehaviourConditionalInverse>(MapSearchedEntirely, { BBKeys::SearchPoints.Index, BBKeys::SearchPointIndex.Index }, "!MapSearchedEntirely"),
+			arena.Create<BehaviourAction>(SetGoalToNextSearchPoint, "SetGoalToNextSearchPoint")
+		}, "Search entire map"),
+		arena.Create<BehaviourConditionalInverse>(MapSearchedEntirely, { BBKeys::SearchPoints.Index, BBKeys::SearchPointIndex.Index }, "Stop while map unsearched"), // Don't go any further if map hasn't been fully searched
+		arena.Create<BehaviourConditional>(IsGoalSet, { BBKeys::GoalSet.Index }, "Stop while goal set"), // Don't go any further if a goal is set
+		arena.CreateComposite<BehaviourSequence> // Increment NEXT HOUSE index
+		({
+			arena.Create<BehaviourConditional>(CurrentlyInsideNextHouse, "CurrentlyInsideNextHouse"),
+			arena.Create<BehaviourAction>(IncrementNextHouseIndex, "IncrementNextHouseIndex"),
+			arena.Create<BehaviourAction>(SetGoalToNextHouse, "SetGoalToNextHouse")
+		}, "Increment next house index"),
+		arena.CreateComposite<BehaviourSequence> // If there's no goal set, move on to the next house (there should always be a goal set)
+		({
+			arena.Create<BehaviourConditionalInverse>(IsGoalSet, { BBKeys::GoalSet.Index }, "!IsGoalSet"),
+			arena.Create<BehaviourAction>(SetGoalToNextHouse, "SetGoalToNextHouse")
+		}, "Go to next house")
+	}, "Root");
+}
+
+// CreateTestBoxBehaviourTree composed at compile time (see StaticBehaviourTree.h).
+// Keep the two in sync, the headless host's --tree-bench ticks both
+namespace TestBoxStaticTree
+{
+	using namespace StaticBT;
+
+	typedef PureCondition<&IsGoalSet, BBKeys::GoalSet.Index> GoalSet;
+	typedef PureConditionInverse<&IsGoalSet, BBKeys::GoalSet.Index> GoalNotSet;
+	typedef PureConditionInverse<&MapSearchedEntirely, BBKeys::SearchPoints.Index, BBKeys::SearchPointIndex.Index> MapNotSearchedEntirely;
+	typedef PureCondition<&KnowOfItemsOnGround, BBKeys::KnownItems.Index, BBKeys::KnownHealthPacks.Index,
+		BBKeys::KnownFoodItems.Index, BBKeys::KnownPistols.Index> ItemsOnGround;
+
+	typedef Selector<
+		Sequence<GoalSet, Condition<&HasReachedGoal>, Action<&SetGoalSetFalse>>, // Set GOAL to false upon arrival
+		Sequence<MapNotSearchedEntirely, Condition<&ArrivedAtNextSearchPoint>, Action<&IncrementSearchPoint>>, // Update SEARCH POINT INDEX
+		Sequence<Condition<&NotMaxEnergy>, Condition<&HasFoodItem>, Action<&UseFoodItem>>, // Use FOOD
+		Sequence<Condition<&NotMaxHealth>, Condition<&HasHealthItem>, Action<&UseHealthItem>>, // Use HEALTH
+		Sequence<Condition<&HaveInventorySpace>, ItemsOnGround, Throttle<ItemGoalHz, Action<&SetNearestItemInRangeAsGoal>>>, // Grab nearby ITEMS
+		Sequence<Condition<&LowEnergyOrHealth>, ItemsOnGround, Throttle<ItemGoalHz, Action<&SetNearestItemInRangeAsGoal>>>, // Find ITEMS
+		Sequence<Condition<&KnowOfUnexploredHouse>, RunEveryNthTick<HouseGoalTicks, Action<&SetGoalToNearestUnexploredHouse>>>, // Explore unexplored HOUSES
+		Sequence<Condition<&HasLoadedPistol>, Condition<&HasEnemyInRange>, Condition<&HasEnemyInFOV>, Action<&AimAtNearestEnemyInFOV>>, // Shoot ENEMIES
+		Sequence<MapNotSearchedEntirely, Action<&SetGoalToNextSearchPoint>>, // Search entire map
+		MapNotSearchedEntirely, // Don't go any further if map hasn't been fully searched
+		GoalSet, // Don't go any further if a goal is set
+		Sequence<Condition<&CurrentlyInsideNextHouse>, Action<&IncrementNextHouseIndex>, Action<&SetGoalToNextHouse>>, // Increment NEXT HOUSE index
+		Sequence<GoalNotSet, Action<&SetGoalToNextHouse>> // If there's no goal set, move on to the next house
+	> Root;
+}
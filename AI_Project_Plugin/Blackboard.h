@@ -1,21 +1,38 @@
 #pragma once
 
 //Includes
+#include <cstdint>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 //-----------------------------------------------------------------
 // BLACKBOARD TYPES (BASE)
 //-----------------------------------------------------------------
+// One address per type, compared instead of using dynamic_cast
+template<typename T>
+inline const void* BlackboardTypeTag()
+{
+	static const char tag = 0;
+	return &tag;
+}
+
 class IBlackBoardField
 {
 public:
+	explicit IBlackBoardField(const void* typeTag) : m_TypeTag(typeTag)
+	{}
 	virtual ~IBlackBoardField() {}
+	const void* GetTypeTag() const { return m_TypeTag; }
+
+private:
+	const void* m_TypeTag;
 };
 template<typename T>
 class BlackboardField : public IBlackBoardField
 {
 public:
-	explicit BlackboardField(T data) : m_Data(data)
+	explicit BlackboardField(T data) : IBlackBoardField(BlackboardTypeTag<T>()), m_Data(data)
 	{}
 	T GetData() { return m_Data; };
 	void SetData(T data) { m_Data = data; }
@@ -23,42 +40,176 @@ public:
 private:
 	T m_Data;
 };
+
+// Typed handle to a fixed blackboard slot (see BlackboardKeys.h)
+template<typename T>
+struct BlackboardKey
+{
+	int Index;
+	const char* Name;
+};
+
+// Keeps T in ChangeData(key, data) from being deduced from the data
+template<typename T>
+struct BlackboardNonDeduced
+{
+	typedef T Type;
+};
+
 //-----------------------------------------------------------------
 // BLACKBOARD (BASE)
+// Data lives in a contiguous slot array. BlackboardKey access is a
+// single indexed load plus a type tag compare, string access does a
+// name lookup first and is kept for debugging and ad-hoc data.
+//
+// Every AddData/ChangeData stamps its slot with the next value of a
+// blackboard wide version counter, and the behaviour trees advance a
+// tick counter per update, so cached results (see PureConditional)
+// can tell whether anything they read has changed since. Pointer
+// slots don't change when their pointee does, so whoever owns the
+// pointee calls Touch instead.
+//
+// Reads are tracked too: every GetData sets the slot's bit in a read
+// mask, which composites use to find out what their subtree depends
+// on (see SubtreeFailureMemo). Slots from 63 up share the last bit,
+// which never counts as unchanged. Every write sets that bit as well:
+// skipping a subtree that writes would skip the write.
 //-----------------------------------------------------------------
+struct BlackboardMemo
+{
+	uint32_t Tick = 0;
+	uint32_t Version = 0;
+	bool Result = false;
+};
+
 class Blackboard final
 {
 public:
+	// Slots [0, keyedSlots) are reserved for BlackboardKey data, string-only data goes after them
+	explicit Blackboard(size_t keyedSlots = 0)
+	{
+		m_Slots.resize(keyedSlots, nullptr);
+		m_SlotVersions.resize(keyedSlots, 0);
+	}
 	~Blackboard()
 	{
-		for (auto el : m_BlackboardData)
-			SafeDelete(el.second);
-		m_BlackboardData.clear();
+		for (auto pField : m_Slots)
+			SafeDelete(pField);
+		m_Slots.clear();
+		m_SlotIndices.clear();
 	}
 
-	template<typename T> bool AddData(const std::string& name, T data)
+	template<typename T> bool AddData(BlackboardKey<T> key, typename BlackboardNonDeduced<T>::Type data)
 	{
-		auto it = m_BlackboardData.find(name);
-		if (it == m_BlackboardData.end())
+		if (key.Index < 0)
+		{
+			printf("WARNING: Data '%s' has an invalid key index\n", key.Name);
+			return false;
+		}
+		if (m_SlotIndices.find(key.Name) != m_SlotIndices.end() ||
+			(key.Index < (int)m_Slots.size() && m_Slots[key.Index] != nullptr))
 		{
-			m_BlackboardData[name] = new BlackboardField<T>(data);
+			printf("WARNING: Data '%s' of type '%s' already in Blackboard \n", key.Name, typeid(T).name());
+			return false;
+		}
+
+		if (key.Index >= (int)m_Slots.size())
+		{
+			m_Slots.resize(key.Index + 1, nullptr);
+			m_SlotVersions.resize(key.Index + 1, 0);
+		}
+		m_Slots[key.Index] = new BlackboardField<T>(data);
+		m_SlotVersions[key.Index] = ++m_Version;
+		m_SlotIndices[key.Name] = key.Index;
+		m_ReadMask |= UntrackedBit;
+		return true;
+	}
+
+	template<typename T> bool ChangeData(BlackboardKey<T> key, typename BlackboardNonDeduced<T>::Type data)
+	{
+		BlackboardField<T>* p = GetField<T>(key.Index);
+		if (p)
+		{
+			p->SetData(data);
+			m_SlotVersions[key.Index] = ++m_Version;
+			m_ReadMask |= UntrackedBit;
 			return true;
 		}
-		printf("WARNING: Data '%s' of type '%s' already in Blackboard \n", name.c_str(), typeid(T).name());
+		printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", key.Name, typeid(T).name());
 		return false;
 	}
 
-	template<typename T> bool ChangeData(const std::string& name, T data)
+	// Only stamps a new version if data differs from what's stored
+	template<typename T> bool ChangeDataIfDifferent(BlackboardKey<T> key, typename BlackboardNonDeduced<T>::Type data)
 	{
-		auto it = m_BlackboardData.find(name);
-		if (it != m_BlackboardData.end())
+		BlackboardField<T>* p = GetField<T>(key.Index);
+		if (p)
 		{
-			BlackboardField<T>* p = dynamic_cast<BlackboardField<T>*>(m_BlackboardData[name]);
-			if (p)
+			if (!(p->GetData() == data))
 			{
 				p->SetData(data);
-				return true;
+				m_SlotVersions[key.Index] = ++m_Version;
 			}
+			// Even an unchanged value counts, whatever was there may have been put there by this subtree
+			m_ReadMask |= UntrackedBit;
+			return true;
+		}
+		printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", key.Name, typeid(T).name());
+		return false;
+	}
+
+	// For pointer slots whose pointee changed
+	template<typename T> bool Touch(BlackboardKey<T> key)
+	{
+		if (GetField<T>(key.Index))
+		{
+			m_SlotVersions[key.Index] = ++m_Version;
+			m_ReadMask |= UntrackedBit;
+			return true;
+		}
+		printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", key.Name, typeid(T).name());
+		return false;
+	}
+
+	template<typename T> bool GetData(BlackboardKey<T> key, T& data)
+	{
+		BlackboardField<T>* p = GetField<T>(key.Index);
+		if (p)
+		{
+			m_ReadMask |= SlotBit(key.Index);
+			data = p->GetData();
+			return true;
+		}
+		printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", key.Name, typeid(T).name());
+		return false;
+	}
+
+	// String keyed access (slow path)
+	template<typename T> bool AddData(const std::string& name, T data)
+	{
+		auto it = m_SlotIndices.find(name);
+		if (it == m_SlotIndices.end())
+		{
+			m_SlotIndices[name] = (int)m_Slots.size();
+			m_Slots.push_back(new BlackboardField<T>(data));
+			m_SlotVersions.push_back(++m_Version);
+			m_ReadMask |= UntrackedBit;
+			return true;
+		}
+		printf("WARNING: Data '%s' of type '%s' already in Blackboard \n", name.c_str(), typeid(T).name());
+		return false;
+	}
+
+	template<typename T> bool ChangeData(const std::string& name, T data)
+	{
+		const int index = FindSlot(name);
+		BlackboardField<T>* p = GetField<T>(index);
+		if (p)
+		{
+			p->SetData(data);
+			m_SlotVersions[index] = ++m_Version;
+			m_ReadMask |= UntrackedBit;
+			return true;
 		}
 		printf("WARNING: Data '%s' of type '%s' not found in Blackboard \n", name.c_str(), typeid(T).name());
 		return false;
@@ -66,9 +217,11 @@ public:
 
 	template<typename T> bool GetData(const std::string& name, T& data)
 	{
-		BlackboardField<T>* p = dynamic_cast<BlackboardField<T>*>(m_BlackboardData[name]);
+		const int index = FindSlot(name);
+		BlackboardField<T>* p = GetField<T>(index);
 		if (p != nullptr)
 		{
+			m_ReadMask |= SlotBit(index);
 			data = p->GetData();
 			return true;
 		}
@@ -76,6 +229,78 @@ public:
 		return false;
 	}
 
+	// Versions, ticks and time
+	void BeginTick() { ++m_Tick; }
+	uint32_t GetTick() const { return m_Tick; }
+	// Whoever owns the blackboard advances this by its update's dt, decorators run on it (see BehaviourBudget)
+	void AdvanceTime(float dt) { m_SecondsElapsed += dt; }
+	float GetSecondsElapsed() const { return m_SecondsElapsed; }
+	uint32_t GetVersion() const { return m_Version; }
+	uint32_t GetSlotVersion(int index) const
+	{
+		return index >= 0 && index < (int)m_SlotVersions.size() ? m_SlotVersions[index] : 0;
+	}
+	// True if none of the slots in the mask (see SlotBit) changed after the blackboard was at version
+	bool SlotsUnchangedSince(uint64_t slotMask, uint32_t version) const
+	{
+		if (slotMask & UntrackedBit)
+			return false;
+
+		for (int index = 0; slotMask != 0; index++, slotMask >>= 1)
+		{
+			if ((slotMask & 1) && m_SlotVersions[index] > version)
+				return false;
+		}
+		return true;
+	}
+
+	// Read tracking
+	static const uint64_t UntrackedBit = 1ull << 63;
+	static uint64_t SlotBit(int index) { return index < 63 ? 1ull << index : UntrackedBit; }
+	uint64_t GetReadMask() const { return m_ReadMask; }
+	// Returns the mask so far, so nested scopes can restore it
+	uint64_t ExchangeReadMask(uint64_t mask)
+	{
+		const uint64_t previous = m_ReadMask;
+		m_ReadMask = mask;
+		return previous;
+	}
+	void AddReads(uint64_t mask) { m_ReadMask |= mask; }
+
+	// Cached results, indexed by an id the caller hands out (see PureConditional)
+	BlackboardMemo& GetMemo(int id)
+	{
+		if (id >= (int)m_Memos.size())
+			m_Memos.resize(id + 1);
+		return m_Memos[id];
+	}
+
 private:
-	std::unordered_map<std::string, IBlackBoardField*> m_BlackboardData;
+	template<typename T> BlackboardField<T>* GetField(int index) const
+	{
+		if (index < 0 || index >= (int)m_Slots.size())
+			return nullptr;
+
+		IBlackBoardField* pField = m_Slots[index];
+		if (pField == nullptr || pField->GetTypeTag() != BlackboardTypeTag<T>())
+			return nullptr;
+
+		return static_cast<BlackboardField<T>*>(pField);
+	}
+
+	int FindSlot(const std::string& name) const
+	{
+		auto it = m_SlotIndices.find(name);
+		return it != m_SlotIndices.end() ? it->second : -1;
+	}
+
+	std::vector<IBlackBoardField*> m_Slots;
+	std::unordered_map<std::string, int> m_SlotIndices; // Name lookup for the string path
+
+	std::vector<uint32_t> m_SlotVersions; // m_Version right after each slot last changed
+	uint32_t m_Version = 0;
+	uint32_t m_Tick = 1; // Starts past the default BlackboardMemo::Tick
+	float m_SecondsElapsed = 0.0f;
+	uint64_t m_ReadMask = 0;
+	std::vector<BlackboardMemo> m_Memos;
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Blackboard.h"
+#include "EnemyTracker.h"
+#include "HelperStructs.h"
+#include "InventoryModel.h"
+#include "SpatialGrid.h"
+#include "WorldCache.h"
+
+#include <vector>
+
+//-----------------------------------------------------------------
+// BLACKBOARD KEYS
+// Every value TestBoxPlugin shares with its behaviours, with a fixed
+// slot index and type. Registered once in TestBoxPlugin::Start.
+// constexpr so slot indices can be template arguments (see
+// StaticBehaviourTree.h).
+//-----------------------------------------------------------------
+namespace BBKeys
+{
+	constexpr BlackboardKey<::AgentInfo*> AgentInfo = { 0, "AgentInfo" };
+	constexpr BlackboardKey<SteeringParams> Goal = { 1, "Goal" };
+	constexpr BlackboardKey<bool> GoalSet = { 2, "GoalSet" };
+	constexpr BlackboardKey<SteeringParams> NextNavMeshGoal = { 3, "NextNavMeshGoal" };
+	constexpr BlackboardKey<std::vector<b2Vec2>*> SearchPoints = { 4, "SearchPoints" };
+	constexpr BlackboardKey<int> SearchPointIndex = { 5, "SearchPointIndex" };
+	constexpr BlackboardKey<Enemy> TargetEnemy = { 6, "TargetEnemy" };
+	constexpr BlackboardKey<InventoryModel*> Inventory = { 7, "Inventory" };
+	constexpr BlackboardKey<float> MaxHealth = { 8, "MaxHealth" };
+	constexpr BlackboardKey<float> MaxEnergy = { 9, "MaxEnergy" };
+	constexpr BlackboardKey<WorldCache<EntityInfo>*> KnownItems = { 10, "KnownItems" };
+	constexpr BlackboardKey<WorldCache<HealthPack>*> KnownHealthPacks = { 11, "KnownHealthPacks" };
+	constexpr BlackboardKey<WorldCache<Food>*> KnownFoodItems = { 12, "KnownFoodItems" };
+	constexpr BlackboardKey<WorldCache<Pistol>*> KnownPistols = { 13, "KnownPistols" };
+	constexpr BlackboardKey<EnemyTracker*> KnownEnemies = { 14, "KnownEnemies" };
+	constexpr BlackboardKey<std::vector<House>*> KnownHouses = { 15, "KnownHouses" };
+	constexpr BlackboardKey<int> NextHouseIndex = { 16, "NextHouseIndex" };
+	constexpr BlackboardKey<float> SecondsBetweenHouseRevisits = { 17, "SecondsBetweenHouseRevisits" };
+	constexpr BlackboardKey<int> InsideHouseIndex = { 18, "InsideHouseIndex" };
+	constexpr BlackboardKey<float> LongestPistolRange = { 19, "LongestPistolRange" };
+	constexpr BlackboardKey<SpatialGrid*> KnownEntityGrid = { 20, "KnownEntityGrid" };
+
+	// Queries TestBoxPlugin answers once per tick, before the tree runs
+	constexpr BlackboardKey<NearestEnemyQuery> NearestEnemy = { 21, "NearestEnemy" };
+	constexpr BlackboardKey<int> HousesDueForRevisit = { 22, "HousesDueForRevisit" };
+
+	// Flags that behaviours can set to send info back to TestBoxPlugin
+	constexpr BlackboardKey<bool> UseHealthItem = { 23, "UseHealthItem" };
+	constexpr BlackboardKey<bool> UseFoodItem = { 24, "UseFoodItem" };
+
+	const int Count = 25;
+}
@@ -0,0 +1,168 @@
+#include "stdafx.h"
+
+#include "EnemyTracker.h"
+
+bool EnemyTracker::Observe(const EntityInfo& entityInfo, const EnemyInfo& enemyInfo)
+{
+	const b2Vec2& position = entityInfo.Position;
+	++m_Revision;
+	const int index = IndexOf(enemyInfo.EnemyHash);
+	if (index == -1)
+	{
+		m_Indices.emplace(enemyInfo.EnemyHash, m_Infos.size());
+		m_PositionX.push_back(position.x);
+		m_PositionY.push_back(position.y);
+		m_VelocityX.push_back(0.0f);
+		m_VelocityY.push_back(0.0f);
+		m_LastSeenTimes.push_back(m_Now);
+		m_SeenTicks.push_back(m_Tick);
+		m_Infos.push_back(enemyInfo);
+		m_EntityInfos.push_back(entityInfo);
+		m_LastPositions.push_back(position);
+		m_ExpiryTimers.push_back(TimerHandle());
+		return true;
+	}
+
+	const b2Vec2 lastPosition = GetPosition(index);
+	m_Infos[index].Health = enemyInfo.Health;
+	m_EntityInfos[index] = entityInfo;
+	m_LastPositions[index] = lastPosition;
+	m_PositionX[index] = position.x;
+	m_PositionY[index] = position.y;
+	m_VelocityX[index] = position.x - lastPosition.x;
+	m_VelocityY[index] = position.y - lastPosition.y;
+	m_LastSeenTimes[index] = m_Now;
+	m_SeenTicks[index] = m_Tick;
+	return false;
+}
+
+bool EnemyTracker::Remove(int enemyHash)
+{
+	const int index = IndexOf(enemyHash);
+	if (index == -1)
+		return false;
+
+	RemoveAt(index);
+	return true;
+}
+
+void EnemyTracker::Clear()
+{
+	++m_Revision;
+	m_PositionX.clear();
+	m_PositionY.clear();
+	m_VelocityX.clear();
+	m_VelocityY.clear();
+	m_LastSeenTimes.clear();
+	m_SeenTicks.clear();
+	m_Infos.clear();
+	m_EntityInfos.clear();
+	m_LastPositions.clear();
+	m_ExpiryTimers.clear();
+	m_Indices.clear();
+}
+
+void EnemyTracker::Advance(float now)
+{
+	m_Now = now;
+	++m_Tick;
+	if (!empty()) ++m_Revision;
+}
+
+int EnemyTracker::SumPositionsWithin(const b2Vec2& center, float range, b2Vec2& sum) const
+{
+	const size_t count = size();
+	const float* pPositionX = m_PositionX.data();
+	const float* pPositionY = m_PositionY.data();
+	const float* pVelocityX = m_VelocityX.data();
+	const float* pVelocityY = m_VelocityY.data();
+	const float* pLastSeenTimes = m_LastSeenTimes.data();
+	const float rangeSqr = range * range;
+
+	// The distance tests are vectorized, the sum stays sequential so it's
+	// the same to the last bit as adding the positions up one by one
+	int nearbyCount = 0;
+	auto add = [&](size_t index)
+	{
+		++nearbyCount;
+		const b2Vec2 predicted = GetPredictedPosition(index);
+		sum.x += predicted.x;
+		sum.y += predicted.y;
+	};
+
+	size_t i = 0;
+#ifdef ENEMY_TRACKER_SSE
+	const __m128 nowx4 = _mm_set1_ps(m_Now);
+	const __m128 centerX = _mm_set1_ps(center.x);
+	const __m128 centerY = _mm_set1_ps(center.y);
+	const __m128 rangeSqrx4 = _mm_set1_ps(rangeSqr);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 secondsUnseen = _mm_sub_ps(nowx4, _mm_load_ps(pLastSeenTimes + i));
+		const __m128 predictedX = _mm_add_ps(_mm_load_ps(pPositionX + i), _mm_mul_ps(_mm_load_ps(pVelocityX + i), secondsUnseen));
+		const __m128 predictedY = _mm_add_ps(_mm_load_ps(pPositionY + i), _mm_mul_ps(_mm_load_ps(pVelocityY + i), secondsUnseen));
+		const __m128 dx = _mm_sub_ps(predictedX, centerX);
+		const __m128 dy = _mm_sub_ps(predictedY, centerY);
+		const __m128 distanceSqr = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		const int nearby = _mm_movemask_ps(_mm_cmplt_ps(distanceSqr, rangeSqrx4));
+		for (int lane = 0; nearby != 0 && lane < 4; lane++)
+		{
+			if (nearby & (1 << lane)) add(i + lane);
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const float secondsUnseen = m_Now - pLastSeenTimes[i];
+		const float dx = (pPositionX[i] + pVelocityX[i] * secondsUnseen) - center.x;
+		const float dy = (pPositionY[i] + pVelocityY[i] * secondsUnseen) - center.y;
+		if (dx * dx + dy * dy < rangeSqr) add(i);
+	}
+
+	return nearbyCount;
+}
+
+Enemy EnemyTracker::GetEnemy(size_t index) const
+{
+	Enemy enemy = {};
+	enemy.entityInfo = m_EntityInfos[index];
+	enemy.enemyInfo = m_Infos[index];
+	enemy.Position = GetPosition(index);
+	enemy.LastPosition = m_LastPositions[index];
+	enemy.Velocity = b2Vec2(m_VelocityX[index], m_VelocityY[index]);
+	enemy.InFieldOfView = IsInFieldOfViewAt(index);
+	enemy.PredictedPosition = GetPredictedPosition(index);
+	enemy.SecondsSinceInsideFOV = GetSecondsUnseen(index);
+	return enemy;
+}
+
+void EnemyTracker::RemoveAt(size_t index)
+{
+	++m_Revision;
+	const size_t last = size() - 1;
+	m_Indices.erase(m_Infos[index].EnemyHash);
+	if (index != last)
+	{
+		m_PositionX[index] = m_PositionX[last];
+		m_PositionY[index] = m_PositionY[last];
+		m_VelocityX[index] = m_VelocityX[last];
+		m_VelocityY[index] = m_VelocityY[last];
+		m_LastSeenTimes[index] = m_LastSeenTimes[last];
+		m_SeenTicks[index] = m_SeenTicks[last];
+		m_Infos[index] = m_Infos[last];
+		m_EntityInfos[index] = m_EntityInfos[last];
+		m_LastPositions[index] = m_LastPositions[last];
+		m_ExpiryTimers[index] = m_ExpiryTimers[last];
+		m_Indices[m_Infos[index].EnemyHash] = index;
+	}
+	m_PositionX.pop_back();
+	m_PositionY.pop_back();
+	m_VelocityX.pop_back();
+	m_VelocityY.pop_back();
+	m_LastSeenTimes.pop_back();
+	m_SeenTicks.pop_back();
+	m_Infos.pop_back();
+	m_EntityInfos.pop_back();
+	m_LastPositions.pop_back();
+	m_ExpiryTimers.pop_back();
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "HelperStructs.h"
+#include "TimingWheel.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENEMY_TRACKER_SSE 1
+#include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------
+// ENEMY TRACKER
+// Known enemies stored as a structure of arrays: positions, velocities
+// and the time each was last seen live in their own 16 byte aligned
+// float array, so the nearby enemy sum runs four enemies at a time with
+// SSE. Removal moves the last enemy into the hole, so indices aren't
+// stable; use IndexOf with the EnemyHash.
+// Nothing is aged per tick: the predicted position is dead reckoned
+// from the last sighting when it's read, and forgetting enemies that
+// haven't been seen for a while is up to the owner (TestBoxPlugin uses
+// a TimingWheel, see GetSecondsUnseen). While an enemy is in the FOV
+// its predicted position is its position, so anything that wants "best
+// guess of where it is" reads Predicted.
+// GetRevision changes whenever anything in the tracker does, which is
+// every Advance while any enemy is known.
+//-----------------------------------------------------------------
+template<typename T, size_t Alignment>
+struct AlignedAllocator
+{
+	typedef T value_type;
+	template<typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() {}
+	template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+#ifdef _WIN32
+		void* pMemory = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+		void* pMemory = nullptr;
+		if (posix_memalign(&pMemory, Alignment, count * sizeof(T)) != 0) pMemory = nullptr;
+#endif
+		if (!pMemory) throw std::bad_alloc();
+		return static_cast<T*>(pMemory);
+	}
+	void deallocate(T* pMemory, size_t)
+	{
+#ifdef _WIN32
+		_aligned_free(pMemory);
+#else
+		free(pMemory);
+#endif
+	}
+
+	template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+class EnemyTracker final
+{
+public:
+	typedef std::vector<float, AlignedAllocator<float, 16>> FloatArray;
+
+	EnemyTracker() {}
+	~EnemyTracker() {}
+
+	// Records a sighting this tick, at entityInfo.Position. Returns true if the
+	// enemy wasn't known yet
+	bool Observe(const EntityInfo& entityInfo, const EnemyInfo& enemyInfo);
+	bool Remove(int enemyHash);
+	void Clear();
+
+	// Starts a new tick at time now: every enemy counts as out of sight
+	// until it's observed again
+	void Advance(float now);
+
+	// Adds the predicted positions closer than range to center onto sum, in index
+	// order. Returns how many there were
+	int SumPositionsWithin(const b2Vec2& center, float range, b2Vec2& sum) const;
+
+	// Returns -1 if the enemy isn't known
+	int IndexOf(int enemyHash) const
+	{
+		auto it = m_Indices.find(enemyHash);
+		return it != m_Indices.end() ? (int)it->second : -1;
+	}
+	bool Contains(int enemyHash) const { return m_Indices.find(enemyHash) != m_Indices.end(); }
+	bool IsInFieldOfView(int enemyHash) const
+	{
+		const int index = IndexOf(enemyHash);
+		return index != -1 && IsInFieldOfViewAt(index);
+	}
+
+	size_t size() const { return m_Infos.size(); }
+	bool empty() const { return m_Infos.empty(); }
+	unsigned int GetRevision() const { return m_Revision; }
+
+	int GetHash(size_t index) const { return m_Infos[index].EnemyHash; }
+	bool IsInFieldOfViewAt(size_t index) const { return m_SeenTicks[index] == m_Tick; }
+	float GetLastSeenTime(size_t index) const { return m_LastSeenTimes[index]; }
+	float GetSecondsUnseen(size_t index) const { return m_Now - m_LastSeenTimes[index]; }
+	b2Vec2 GetPosition(size_t index) const { return b2Vec2(m_PositionX[index], m_PositionY[index]); }
+	b2Vec2 GetPredictedPosition(size_t index) const
+	{
+		const float secondsUnseen = GetSecondsUnseen(index);
+		return b2Vec2(m_PositionX[index] + m_VelocityX[index] * secondsUnseen, m_PositionY[index] + m_VelocityY[index] * secondsUnseen);
+	}
+	// Gathers the enemy back into the struct the blackboard passes around
+	Enemy GetEnemy(size_t index) const;
+
+	// The owner's timer for forgetting the enemy, kept here so it can be cancelled when the enemy goes
+	const TimerHandle& GetExpiryTimer(size_t index) const { return m_ExpiryTimers[index]; }
+	void SetExpiryTimer(size_t index, const TimerHandle& timer) { m_ExpiryTimers[index] = timer; }
+
+private:
+	void RemoveAt(size_t index);
+
+	FloatArray m_PositionX, m_PositionY;
+	FloatArray m_VelocityX, m_VelocityY; // Displacement between the last two sightings
+	FloatArray m_LastSeenTimes;
+	std::vector<unsigned int> m_SeenTicks; // The Advance count when each was last observed
+
+	// Cold data, only read when an enemy is gathered into an Enemy
+	std::vector<EnemyInfo> m_Infos;
+	std::vector<EntityInfo> m_EntityInfos; // As last seen
+	std::vector<b2Vec2> m_LastPositions;
+	std::vector<TimerHandle> m_ExpiryTimers;
+
+	std::unordered_map<int, size_t> m_Indices; // EnemyHash -> index
+	float m_Now = 0.0f;
+	unsigned int m_Tick = 0;
+	unsigned int m_Revision = 0;
+};
@@ -0,0 +1,337 @@
+//Precompiled Header [ALWAYS ON TOP IN CPP]
+#include "stdafx.h"
+
+#include "FlatBehaviourTree.h"
+
+#include <algorithm>
+#include <chrono>
+
+//-----------------------------------------------------------------
+// COMPILER
+//-----------------------------------------------------------------
+FlatBehaviourTree::FlatBehaviourTree(IBehaviour* pRoot)
+{
+	if (pRoot != nullptr)
+	{
+		Compile(pRoot, 0);
+	}
+	m_NodeStats.resize(m_Nodes.size());
+}
+
+void FlatBehaviourTree::Compile(IBehaviour* pBehaviour, uint16_t depth)
+{
+	const uint32_t index = (uint32_t)m_Nodes.size();
+	m_Nodes.push_back({});
+	FlatBehaviourNode node = {};
+	node.Type = FLAT_OPAQUE;
+	node.StateIndex = -1;
+	node.pOpaque = pBehaviour;
+
+	// BehaviourPartialSequence derives from BehaviourSequence, so check it first
+	const BehaviourComposite* pComposite = dynamic_cast<const BehaviourComposite*>(pBehaviour);
+	if (pComposite != nullptr)
+	{
+		if (dynamic_cast<const BehaviourPartialSequence*>(pComposite)) node.Type = FLAT_PARTIAL_SEQUENCE;
+		else if (dynamic_cast<const BehaviourSequence*>(pComposite)) node.Type = FLAT_SEQUENCE;
+		else if (dynamic_cast<const BehaviourSelector*>(pComposite)) node.Type = FLAT_SELECTOR;
+	}
+
+	if (node.Type != FLAT_OPAQUE)
+	{
+		if (node.Type != FLAT_PARTIAL_SEQUENCE)
+		{
+			node.StateIndex = (int32_t)m_FailureMemos.size();
+			m_FailureMemos.push_back(SubtreeFailureMemo());
+		}
+
+		const BehaviourChildren& children = pComposite->GetChildren();
+		node.ChildCount = (uint16_t)children.size();
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			Compile(children[i], depth + 1);
+		}
+	}
+	else if (const BehaviourDecorator* pDecorator = dynamic_cast<const BehaviourDecorator*>(pBehaviour))
+	{
+		if (pDecorator->GetChild() != nullptr)
+		{
+			node.Type = FLAT_DECORATOR;
+			node.ChildCount = 1;
+			Compile(pDecorator->GetChild(), depth + 1);
+			node.StateIndex = (int32_t)m_Budgets.size();
+			m_Budgets.push_back(pDecorator->GetBudget());
+		}
+	}
+	else if (const BehaviourConditional* pConditional = dynamic_cast<const BehaviourConditional*>(pBehaviour))
+	{
+		const FlatBehaviourNode::ConditionalFn* pfp = pConditional->GetConditional().target<FlatBehaviourNode::ConditionalFn>();
+		if (!pConditional->GetConditional() || pfp != nullptr)
+		{
+			node.Type = FLAT_CONDITIONAL;
+			node.fpConditional = pfp ? *pfp : nullptr;
+			if (pConditional->IsPure())
+			{
+				node.StateIndex = (int32_t)m_PureConditionals.size();
+				m_PureConditionals.push_back(pConditional->GetPure());
+			}
+		}
+	}
+	else if (const BehaviourConditionalInverse* pInverse = dynamic_cast<const BehaviourConditionalInverse*>(pBehaviour))
+	{
+		const FlatBehaviourNode::ConditionalFn* pfp = pInverse->GetConditional().target<FlatBehaviourNode::ConditionalFn>();
+		if (!pInverse->GetConditional() || pfp != nullptr)
+		{
+			node.Type = FLAT_CONDITIONAL_INVERSE;
+			node.fpConditional = pfp ? *pfp : nullptr;
+			if (pInverse->IsPure())
+			{
+				node.StateIndex = (int32_t)m_PureConditionals.size();
+				m_PureConditionals.push_back(pInverse->GetPure());
+			}
+		}
+	}
+	else if (const BehaviourAction* pAction = dynamic_cast<const BehaviourAction*>(pBehaviour))
+	{
+		const FlatBehaviourNode::ActionFn* pfp = pAction->GetAction().target<FlatBehaviourNode::ActionFn>();
+		if (!pAction->GetAction() || pfp != nullptr)
+		{
+			node.Type = FLAT_ACTION;
+			node.fpAction = pfp ? *pfp : nullptr;
+		}
+	}
+
+	if (node.Type == FLAT_OPAQUE)
+	{
+		++m_OpaqueNodeCount;
+	}
+
+	node.SubtreeSize = (uint32_t)m_Nodes.size() - index;
+	m_Nodes[index] = node;
+
+	static const char* s_TypeNames[] =
+	{
+		"Selector", "Sequence", "Partial sequence", "Decorator",
+		"Conditional", "Conditional inverse", "Action", "Opaque"
+	};
+	m_NodeNames.resize(m_Nodes.size());
+	m_NodeDepths.resize(m_Nodes.size());
+	m_NodeNames[index] = pBehaviour->GetName() ? pBehaviour->GetName() : s_TypeNames[node.Type];
+	m_NodeDepths[index] = depth;
+}
+
+//-----------------------------------------------------------------
+// INTERPRETER
+// Same results as the Execute functions in BehaviourTree.cpp
+//-----------------------------------------------------------------
+BehaviourState FlatBehaviourTree::ExecuteProfiled(uint32_t index, Blackboard* pBlackboard)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const BehaviourState state = ExecuteNode<true>(index, pBlackboard);
+	const auto end = std::chrono::steady_clock::now();
+
+	BehaviourNodeStats& stats = m_NodeStats[index];
+	++stats.Hits;
+	switch (state)
+	{
+	case Success: ++stats.Successes; break;
+	case Failure: ++stats.Failures; break;
+	case Running: ++stats.Runnings; break;
+	}
+	stats.Nanoseconds += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	return state;
+}
+
+template<bool Profiled>
+BehaviourState FlatBehaviourTree::ExecuteNode(uint32_t index, Blackboard* pBlackboard)
+{
+	FlatBehaviourNode& node = m_Nodes[index];
+	switch (node.Type)
+	{
+	case FLAT_SELECTOR:
+	case FLAT_SEQUENCE:
+	{
+		SubtreeFailureMemo& memo = m_FailureMemos[node.StateIndex];
+		if (memo.CanSkip(pBlackboard))
+			return Failure;
+
+		SubtreeReadScope reads(pBlackboard);
+		return reads.End(ExecuteComposite<Profiled>(index, pBlackboard), memo);
+	}
+	case FLAT_PARTIAL_SEQUENCE:
+	{
+		// The result depends on CurrentChild, which isn't on the blackboard
+		pBlackboard->AddReads(Blackboard::UntrackedBit);
+		if (node.CurrentChild < node.ChildCount)
+		{
+			uint32_t child = index + 1;
+			for (uint32_t i = 0; i < node.CurrentChild; i++)
+			{
+				child += m_Nodes[child].SubtreeSize;
+			}
+
+			const BehaviourState state = Execute<Profiled>(child, pBlackboard);
+			switch (state)
+			{
+			case Failure:
+				node.CurrentChild = 0;
+				return Failure;
+			case Success:
+				++node.CurrentChild;
+				return Running;
+			default:
+				return state;
+			}
+		}
+
+		node.CurrentChild = 0;
+		return Success;
+	}
+	case FLAT_DECORATOR:
+	{
+		BehaviourBudget& budget = m_Budgets[node.StateIndex];
+		BehaviourState state;
+		if (budget.Skip(pBlackboard, state))
+			return state;
+
+		state = Execute<Profiled>(index + 1, pBlackboard);
+		budget.Record(pBlackboard, state);
+		return state;
+	}
+	case FLAT_CONDITIONAL:
+		if (node.fpConditional == nullptr)
+			return Failure;
+		return EvaluateConditional(node, pBlackboard) ? Success : Failure;
+	case FLAT_CONDITIONAL_INVERSE:
+		if (node.fpConditional == nullptr)
+			return Failure;
+		return EvaluateConditional(node, pBlackboard) ? Failure : Success;
+	case FLAT_ACTION:
+		if (node.fpAction == nullptr)
+			return Failure;
+		return node.fpAction(pBlackboard);
+	case FLAT_OPAQUE:
+	default:
+		// Could depend on anything it captured
+		pBlackboard->AddReads(Blackboard::UntrackedBit);
+		return node.pOpaque->Execute(pBlackboard);
+	}
+}
+
+template<bool Profiled>
+BehaviourState FlatBehaviourTree::ExecuteComposite(uint32_t index, Blackboard* pBlackboard)
+{
+	const FlatBehaviourNode& node = m_Nodes[index];
+	if (node.Type == FLAT_SELECTOR)
+	{
+		uint32_t child = index + 1;
+		for (uint16_t i = 0; i < node.ChildCount; i++)
+		{
+			const BehaviourState state = Execute<Profiled>(child, pBlackboard);
+			if (state == Success || state == Running)
+				return state;
+			child += m_Nodes[child].SubtreeSize;
+		}
+		return Failure;
+	}
+
+	// Sequence
+	uint32_t child = index + 1;
+	for (uint16_t i = 0; i < node.ChildCount; i++)
+	{
+		const BehaviourState state = Execute<Profiled>(child, pBlackboard);
+		if (state == Failure || state == Running)
+			return state;
+		if (state != Success)
+			return Success;
+		child += m_Nodes[child].SubtreeSize;
+	}
+	return Success;
+}
+
+// Update calls these from the header
+template BehaviourState FlatBehaviourTree::ExecuteNode<false>(uint32_t index, Blackboard* pBlackboard);
+template BehaviourState FlatBehaviourTree::ExecuteNode<true>(uint32_t index, Blackboard* pBlackboard);
+
+//-----------------------------------------------------------------
+// PROFILING
+//-----------------------------------------------------------------
+void FlatBehaviourTree::SetProfiling(bool enabled)
+{
+	if (enabled && !m_Profiling)
+	{
+		m_NodeStats.assign(m_Nodes.size(), BehaviourNodeStats());
+	}
+	m_Profiling = enabled;
+}
+
+void FlatBehaviourTree::ExtendUI_ImGui() const
+{
+	if (m_Nodes.empty())
+		return;
+
+	// Heat is the node's share of the whole tree's time
+	const double rootNanoseconds = (double)std::max(m_NodeStats[0].Nanoseconds, (uint64_t)1);
+	ImGui::Text("Behaviour tree profile (%llu ticks):", (unsigned long long)m_NodeStats[0].Hits);
+	ImGui::Text("%-40s %8s %8s %8s %8s %10s %6s", "Node", "hits", "success", "failure", "running", "ns/hit", "time");
+	for (size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		const BehaviourNodeStats& stats = m_NodeStats[i];
+		const float heat = (float)(stats.Nanoseconds / rootNanoseconds);
+		const std::string label = std::string(m_NodeDepths[i] * 2, ' ') + m_NodeNames[i];
+		ImGui::TextColored(ImVec4(0.5f + 0.5f * heat, 1.0f - 0.8f * heat, 1.0f - 0.8f * heat, 1.0f),
+			"%-40s %8llu %8llu %8llu %8llu %10.0f %5.1f%%", label.c_str(),
+			(unsigned long long)stats.Hits, (unsigned long long)stats.Successes, (unsigned long long)stats.Failures,
+			(unsigned long long)stats.Runnings, stats.Hits ? (double)stats.Nanoseconds / stats.Hits : 0.0, heat * 100.0f);
+	}
+}
+
+void FlatBehaviourTree::PrintProfile() const
+{
+	if (m_Nodes.empty())
+		return;
+
+	const double rootNanoseconds = (double)std::max(m_NodeStats[0].Nanoseconds, (uint64_t)1);
+	printf("Behaviour tree profile (%llu ticks):\n", (unsigned long long)m_NodeStats[0].Hits);
+	printf("%-40s %10s %10s %10s %10s %10s %6s\n", "Node", "hits", "success", "failure", "running", "ns/hit", "time");
+	for (size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		const BehaviourNodeStats& stats = m_NodeStats[i];
+		const std::string label = std::string(m_NodeDepths[i] * 2, ' ') + m_NodeNames[i];
+		printf("%-40s %10llu %10llu %10llu %10llu %10.0f %5.1f%%\n", label.c_str(),
+			(unsigned long long)stats.Hits, (unsigned long long)stats.Successes, (unsigned long long)stats.Failures,
+			(unsigned long long)stats.Runnings, stats.Hits ? (double)stats.Nanoseconds / stats.Hits : 0.0,
+			100.0 * stats.Nanoseconds / rootNanoseconds);
+	}
+}
+
+bool FlatBehaviourTree::DumpProfileToCSV(const std::string& path) const
+{
+	FILE* pFile = fopen(path.c_str(), "w");
+	if (pFile == nullptr)
+	{
+		printf("WARNING: Couldn't open '%s' to write the behaviour tree profile\n", path.c_str());
+		return false;
+	}
+
+	// parent is the index of the parent node, -1 for the root
+	fprintf(pFile, "node,name,depth,parent,hits,successes,failures,runnings,total_ns,mean_ns\n");
+	std::vector<int> parents(m_Nodes.size(), -1);
+	for (size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		uint32_t child = (uint32_t)i + 1;
+		for (uint16_t c = 0; c < m_Nodes[i].ChildCount; c++)
+		{
+			parents[child] = (int)i;
+			child += m_Nodes[child].SubtreeSize;
+		}
+
+		const BehaviourNodeStats& stats = m_NodeStats[i];
+		fprintf(pFile, "%i,\"%s\",%i,%i,%llu,%llu,%llu,%llu,%llu,%f\n", (int)i, m_NodeNames[i].c_str(), (int)m_NodeDepths[i], parents[i],
+			(unsigned long long)stats.Hits, (unsigned long long)stats.Successes, (unsigned long long)stats.Failures,
+			(unsigned long long)stats.Runnings, (unsigned long long)stats.Nanoseconds,
+			stats.Hits ? (double)stats.Nanoseconds / stats.Hits : 0.0);
+	}
+
+	fclose(pFile);
+	return true;
+}
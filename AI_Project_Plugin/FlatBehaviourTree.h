@@ -0,0 +1,134 @@
+#pragma once
+
+#include "BehaviourTree.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------
+// FLAT BEHAVIOUR TREE
+// A behaviour tree lowered to one array of nodes in depth-first
+// order. A node's children directly follow it, and SubtreeSize
+// skips from a child to its next sibling. Leaves call plain
+// function pointers, so ticking the tree is a switch over a linear
+// array: no virtual calls, no std::function, no heap pointers.
+//
+// Selectors and sequences skip their subtree while nothing it read
+// changed since it last failed, see SubtreeFailureMemo.
+//
+// With profiling on, every node counts its ticks and results and the
+// time spent in it (children included), listed by the names given to
+// the source nodes. Off by default, it costs two clock reads per node;
+// the interpreter is compiled separately for each case, so the
+// unprofiled tick doesn't pay for the check.
+//
+// Leaves whose std::function doesn't hold a plain function pointer,
+// and node types this compiler doesn't know, are kept as opaque
+// nodes that call Execute on the source node. The source tree must
+// then outlive the flat tree.
+//-----------------------------------------------------------------
+enum eFlatBehaviourType : uint8_t
+{
+	FLAT_SELECTOR,
+	FLAT_SEQUENCE,
+	FLAT_PARTIAL_SEQUENCE,
+	FLAT_DECORATOR, // One child, see BehaviourBudget
+	FLAT_CONDITIONAL,
+	FLAT_CONDITIONAL_INVERSE,
+	FLAT_ACTION,
+	FLAT_OPAQUE
+};
+
+struct FlatBehaviourNode
+{
+	typedef bool(*ConditionalFn)(Blackboard*);
+	typedef BehaviourState(*ActionFn)(Blackboard*);
+
+	eFlatBehaviourType Type;
+	uint16_t ChildCount;
+	uint32_t SubtreeSize; // This node plus all of its descendants
+	uint32_t CurrentChild; // Partial sequence progress, same as BehaviourPartialSequence::m_CurrentBehaviourIndex
+	// Index into the tree's state for this node type, -1 if it has none: pure conditionals
+	// for conditionals, failure memos for selectors and sequences, budgets for decorators
+	int32_t StateIndex;
+	union
+	{
+		ConditionalFn fpConditional;
+		ActionFn fpAction;
+		IBehaviour* pOpaque;
+	};
+};
+
+struct BehaviourNodeStats
+{
+	uint64_t Hits = 0;
+	uint64_t Successes = 0;
+	uint64_t Failures = 0;
+	uint64_t Runnings = 0;
+	uint64_t Nanoseconds = 0; // Children included
+};
+
+class FlatBehaviourTree final
+{
+public:
+	// Compiles the tree below pRoot, the source nodes aren't modified
+	explicit FlatBehaviourTree(IBehaviour* pRoot);
+	~FlatBehaviourTree() {}
+
+	BehaviourState Update(Blackboard* pBlackboard)
+	{
+		if (m_Nodes.empty())
+			return m_CurrentState = Failure;
+
+		pBlackboard->BeginTick();
+		return m_CurrentState = m_Profiling ? Execute<true>(0, pBlackboard) : Execute<false>(0, pBlackboard);
+	}
+
+	size_t GetNodeCount() const { return m_Nodes.size(); }
+	int GetOpaqueNodeCount() const { return m_OpaqueNodeCount; }
+
+	// Turning profiling on clears the stats
+	void SetProfiling(bool enabled);
+	bool IsProfiling() const { return m_Profiling; }
+	const BehaviourNodeStats& GetNodeStats(size_t index) const { return m_NodeStats[index]; }
+	const std::string& GetNodeName(size_t index) const { return m_NodeNames[index]; }
+	int GetNodeDepth(size_t index) const { return m_NodeDepths[index]; }
+
+	void ExtendUI_ImGui() const;
+	void PrintProfile() const;
+	bool DumpProfileToCSV(const std::string& path) const;
+
+private:
+	void Compile(IBehaviour* pBehaviour, uint16_t depth);
+	// The whole recursion is instantiated twice, so ticking without profiling never checks for it
+	template<bool Profiled>
+	BehaviourState Execute(uint32_t index, Blackboard* pBlackboard)
+	{
+		return Profiled ? ExecuteProfiled(index, pBlackboard) : ExecuteNode<false>(index, pBlackboard);
+	}
+	BehaviourState ExecuteProfiled(uint32_t index, Blackboard* pBlackboard);
+	template<bool Profiled>
+	BehaviourState ExecuteNode(uint32_t index, Blackboard* pBlackboard);
+	// Selector and sequence children, around which ExecuteNode handles the failure memo
+	template<bool Profiled>
+	BehaviourState ExecuteComposite(uint32_t index, Blackboard* pBlackboard);
+
+	bool EvaluateConditional(const FlatBehaviourNode& node, Blackboard* pBlackboard) const
+	{
+		return node.StateIndex >= 0 ? m_PureConditionals[node.StateIndex].Evaluate(pBlackboard) : node.fpConditional(pBlackboard);
+	}
+
+	std::vector<FlatBehaviourNode> m_Nodes;
+	std::vector<PureConditional> m_PureConditionals;
+	std::vector<SubtreeFailureMemo> m_FailureMemos; // One per selector and sequence
+	std::vector<BehaviourBudget> m_Budgets; // One per decorator
+	int m_OpaqueNodeCount = 0;
+	BehaviourState m_CurrentState = Failure;
+
+	// Per node, for profiling
+	std::vector<std::string> m_NodeNames;
+	std::vector<uint16_t> m_NodeDepths;
+	std::vector<BehaviourNodeStats> m_NodeStats;
+	bool m_Profiling = false;
+};
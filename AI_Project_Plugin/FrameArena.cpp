@@ -0,0 +1,73 @@
+#include "stdafx.h"
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+FrameArena::FrameArena(size_t capacity) :
+	m_Capacity(capacity)
+{
+	m_pBlock = static_cast<char*>(AllocateFromHeap(m_Capacity));
+	m_OverflowBlocks.reserve(16);
+}
+
+FrameArena::~FrameArena()
+{
+	for (void* pBlock : m_OverflowBlocks)
+	{
+		free(pBlock);
+	}
+	free(m_pBlock);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	const uintptr_t base = reinterpret_cast<uintptr_t>(m_pBlock);
+	const size_t alignedOffset = (size_t)(((base + m_Offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+	if (alignedOffset + size <= m_Capacity)
+	{
+		m_Offset = alignedOffset + size;
+		m_PeakUsed = std::max(m_PeakUsed, GetUsed());
+		return m_pBlock + alignedOffset;
+	}
+
+	// malloc's alignment covers everything the plugin puts in here
+	void* pMemory = AllocateFromHeap(size);
+	m_OverflowBlocks.push_back(pMemory);
+	m_OverflowBytes += size;
+	m_PeakUsed = std::max(m_PeakUsed, GetUsed());
+	return pMemory;
+}
+
+void FrameArena::Reset()
+{
+	++m_Frame;
+	if (!m_OverflowBlocks.empty())
+	{
+		for (void* pBlock : m_OverflowBlocks)
+		{
+			free(pBlock);
+		}
+		m_OverflowBlocks.clear();
+
+		// Grow so a frame like the last one fits, with some headroom
+		free(m_pBlock);
+		m_Capacity = (m_Offset + m_OverflowBytes) * 2;
+		m_pBlock = static_cast<char*>(AllocateFromHeap(m_Capacity));
+		m_OverflowBytes = 0;
+	}
+	m_Offset = 0;
+}
+
+void* FrameArena::AllocateFromHeap(size_t size)
+{
+	void* pMemory = malloc(std::max(size, (size_t)1));
+	if (!pMemory) throw std::bad_alloc();
+
+	++m_ArenaHeapAllocationCount;
+	m_LastArenaHeapAllocationFrame = m_Frame;
+	return pMemory;
+}
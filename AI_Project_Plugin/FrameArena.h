@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//-----------------------------------------------------------------
+// FRAME ARENA
+// Linear allocator for memory that only lives for one Update: Allocate
+// bumps an offset, Reset (at the top of Update) rewinds it. When a
+// frame needs more than the block holds, the rest comes from the heap
+// and the next Reset replaces the block with one big enough for that
+// frame, so after the first few frames the arena never touches the
+// heap again. GetArenaHeapAllocationCount and
+// GetLastArenaHeapAllocationFrame show whether that's actually the
+// case. They only count the arena's own blocks, not what the rest of
+// Update allocates; the headless host counts that (AllocationCounter).
+//-----------------------------------------------------------------
+class FrameArena final
+{
+public:
+	explicit FrameArena(size_t capacity = 16 * 1024);
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment);
+	// Everything allocated since the last Reset becomes invalid
+	void Reset();
+
+	size_t GetCapacity() const { return m_Capacity; }
+	size_t GetUsed() const { return m_Offset + m_OverflowBytes; }
+	size_t GetPeakUsed() const { return m_PeakUsed; }
+	unsigned int GetArenaHeapAllocationCount() const { return m_ArenaHeapAllocationCount; }
+	unsigned int GetFrame() const { return m_Frame; }
+	unsigned int GetLastArenaHeapAllocationFrame() const { return m_LastArenaHeapAllocationFrame; }
+
+private:
+	void* AllocateFromHeap(size_t size);
+
+	char* m_pBlock = nullptr;
+	size_t m_Capacity = 0;
+	size_t m_Offset = 0;
+
+	std::vector<void*> m_OverflowBlocks; // Freed on Reset
+	size_t m_OverflowBytes = 0;
+
+	size_t m_PeakUsed = 0;
+	unsigned int m_ArenaHeapAllocationCount = 0;
+	unsigned int m_Frame = 0;
+	unsigned int m_LastArenaHeapAllocationFrame = 0;
+};
+
+// std::allocator replacement that takes its memory from a FrameArena.
+// Deallocate is a no-op, so reserve arena vectors up front: every
+// reallocation leaves the old buffer behind until the next Reset
+template<typename T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena& arena) : pArena(&arena) {}
+	template<typename U> ArenaAllocator(const ArenaAllocator<U>& other) : pArena(other.pArena) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(pArena->Allocate(count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U> bool operator==(const ArenaAllocator<U>& other) const { return pArena == other.pArena; }
+	template<typename U> bool operator!=(const ArenaAllocator<U>& other) const { return pArena != other.pArena; }
+
+	FrameArena* pArena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
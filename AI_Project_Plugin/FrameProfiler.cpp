@@ -0,0 +1,123 @@
+#include "stdafx.h"
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+
+FrameProfiler::FrameProfiler(const std::vector<std::string>& phaseNames, size_t windowSize) :
+	m_PhaseNames(phaseNames),
+	m_WindowSize(std::max(windowSize, (size_t)1))
+{
+	m_FrameMs.resize(m_PhaseNames.size(), 0.0f);
+	m_Window.resize(m_PhaseNames.size(), std::vector<float>(m_WindowSize, 0.0f));
+	m_SortScratch.reserve(m_WindowSize);
+}
+
+void FrameProfiler::BeginFrame()
+{
+	std::fill(m_FrameMs.begin(), m_FrameMs.end(), 0.0f);
+	m_RunningPhase = -1;
+}
+
+void FrameProfiler::EndFrame()
+{
+	EndPhase();
+
+	for (size_t i = 0; i < m_Window.size(); i++)
+	{
+		m_Window[i][m_NextSample] = m_FrameMs[i];
+	}
+	m_NextSample = (m_NextSample + 1) % m_WindowSize;
+	m_SampleCount = std::min(m_SampleCount + 1, m_WindowSize);
+}
+
+void FrameProfiler::BeginPhase(int phase)
+{
+	EndPhase();
+	m_RunningPhase = phase;
+	m_PhaseTimer.Reset();
+}
+
+void FrameProfiler::EndPhase()
+{
+	if (m_RunningPhase != -1)
+	{
+		AddSample(m_RunningPhase, m_PhaseTimer.GetMilliseconds());
+		m_RunningPhase = -1;
+	}
+}
+
+void FrameProfiler::AddSample(int phase, float ms)
+{
+	if (phase < 0 || phase >= (int)m_FrameMs.size()) return;
+
+	m_FrameMs[phase] += ms;
+}
+
+PhaseStats FrameProfiler::GetStats(int phase) const
+{
+	PhaseStats stats = {};
+	if (phase < 0 || phase >= (int)m_Window.size() || m_SampleCount == 0) return stats;
+
+	// The ring buffer is only partially filled until WindowSize frames have passed
+	m_SortScratch.assign(m_Window[phase].begin(), m_Window[phase].begin() + m_SampleCount);
+
+	float sum = 0.0f;
+	stats.MinMs = FLT_MAX;
+	for (size_t i = 0; i < m_SortScratch.size(); i++)
+	{
+		sum += m_SortScratch[i];
+		stats.MinMs = std::min(stats.MinMs, m_SortScratch[i]);
+		stats.MaxMs = std::max(stats.MaxMs, m_SortScratch[i]);
+	}
+	stats.MeanMs = sum / (float)m_SortScratch.size();
+	stats.Samples = (int)m_SortScratch.size();
+
+	const size_t p99Index = std::min((m_SortScratch.size() * 99) / 100, m_SortScratch.size() - 1);
+	std::nth_element(m_SortScratch.begin(), m_SortScratch.begin() + p99Index, m_SortScratch.end());
+	stats.P99Ms = m_SortScratch[p99Index];
+
+	return stats;
+}
+
+void FrameProfiler::ExtendUI_ImGui() const
+{
+	ImGui::Text("Frame profile (last %i frames, ms):", (int)m_SampleCount);
+	ImGui::Text("%-18s %7s %7s %7s", "Phase", "min", "mean", "p99");
+	for (int i = 0; i < GetPhaseCount(); i++)
+	{
+		const PhaseStats stats = GetStats(i);
+		ImGui::Text("%-18s %7.3f %7.3f %7.3f", m_PhaseNames[i].c_str(), stats.MinMs, stats.MeanMs, stats.P99Ms);
+	}
+}
+
+void FrameProfiler::PrintSummary() const
+{
+	printf("Frame profile (last %i frames, ms):\n", (int)m_SampleCount);
+	printf("%-18s %8s %8s %8s %8s\n", "Phase", "min", "mean", "p99", "max");
+	for (int i = 0; i < GetPhaseCount(); i++)
+	{
+		const PhaseStats stats = GetStats(i);
+		printf("%-18s %8.4f %8.4f %8.4f %8.4f\n", m_PhaseNames[i].c_str(), stats.MinMs, stats.MeanMs, stats.P99Ms, stats.MaxMs);
+	}
+}
+
+bool FrameProfiler::DumpToCSV(const std::string& path) const
+{
+	FILE* pFile = fopen(path.c_str(), "w");
+	if (pFile == nullptr)
+	{
+		printf("WARNING: Couldn't open '%s' to write the frame profile\n", path.c_str());
+		return false;
+	}
+
+	fprintf(pFile, "phase,min_ms,mean_ms,p99_ms,max_ms,samples\n");
+	for (int i = 0; i < GetPhaseCount(); i++)
+	{
+		const PhaseStats stats = GetStats(i);
+		fprintf(pFile, "%s,%f,%f,%f,%f,%i\n", m_PhaseNames[i].c_str(), stats.MinMs, stats.MeanMs, stats.P99Ms, stats.MaxMs, stats.Samples);
+	}
+
+	fclose(pFile);
+	return true;
+}
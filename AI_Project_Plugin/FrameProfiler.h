@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------
+// FRAME PROFILER
+// Times named phases of a frame with b2Timer and keeps the last
+// WindowSize frames per phase, so min/mean/p99 follow what the bot
+// is doing right now instead of averaging over the whole run.
+//-----------------------------------------------------------------
+struct PhaseStats
+{
+	float MinMs = 0.0f;
+	float MeanMs = 0.0f;
+	float P99Ms = 0.0f;
+	float MaxMs = 0.0f;
+	int Samples = 0;
+};
+
+class FrameProfiler final
+{
+public:
+	explicit FrameProfiler(const std::vector<std::string>& phaseNames, size_t windowSize = 600);
+	~FrameProfiler() {}
+
+	void BeginFrame();
+	void EndFrame();
+
+	// Phases run back to back: beginning one ends the phase that was running
+	void BeginPhase(int phase);
+	void EndPhase();
+	// For phases timed elsewhere (see ScopedFrameTimer)
+	void AddSample(int phase, float ms);
+
+	PhaseStats GetStats(int phase) const;
+	int GetPhaseCount() const { return (int)m_PhaseNames.size(); }
+	const std::string& GetPhaseName(int phase) const { return m_PhaseNames[phase]; }
+
+	void ExtendUI_ImGui() const;
+	void PrintSummary() const;
+	bool DumpToCSV(const std::string& path) const;
+
+private:
+	std::vector<std::string> m_PhaseNames;
+	size_t m_WindowSize;
+
+	std::vector<float> m_FrameMs; // This frame's accumulated time per phase
+	std::vector<std::vector<float>> m_Window; // Ring buffer of m_WindowSize frames per phase
+	size_t m_NextSample = 0;
+	size_t m_SampleCount = 0;
+
+	int m_RunningPhase = -1;
+	b2Timer m_PhaseTimer;
+	mutable std::vector<float> m_SortScratch;
+};
+
+// Frames one call of the profiled function: ends the frame (and adds
+// the time spent in its scope to totalPhase) when it goes out of scope
+class ScopedFrameTimer final
+{
+public:
+	ScopedFrameTimer(FrameProfiler& profiler, int totalPhase) :
+		m_Profiler(profiler),
+		m_TotalPhase(totalPhase)
+	{
+		m_Profiler.BeginFrame();
+	}
+	~ScopedFrameTimer()
+	{
+		m_Profiler.AddSample(m_TotalPhase, m_Timer.GetMilliseconds());
+		m_Profiler.EndFrame();
+	}
+
+private:
+	FrameProfiler& m_Profiler;
+	int m_TotalPhase;
+	b2Timer m_Timer;
+};
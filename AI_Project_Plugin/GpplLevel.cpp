@@ -0,0 +1,219 @@
+#include "stdafx.h"
+
+#include "GpplLevel.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#undef min
+#undef max
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cmath>
+
+// Vertices are read in place as b2Vec2s
+static_assert(sizeof(b2Vec2) == 2 * sizeof(float), "b2Vec2 must be two packed floats");
+
+GpplLevel::~GpplLevel()
+{
+	Close();
+}
+
+bool GpplLevel::Open(const std::string& path)
+{
+	Close();
+
+	if (!Map(path))
+		return false;
+
+	m_Path = path;
+	if (!Parse())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void GpplLevel::Close()
+{
+	Unmap();
+	m_Path.clear();
+	m_WorldInfo = {};
+	m_Houses.clear();
+	m_Polygons.clear();
+	m_VertexCount = 0;
+}
+
+bool GpplLevel::Map(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		printf("ERROR: Could not open level '%s'\n", path.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+	{
+		printf("ERROR: Level '%s' is empty\n", path.c_str());
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* pView = hMapping != nullptr ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (pView == nullptr)
+	{
+		printf("ERROR: Could not map level '%s'\n", path.c_str());
+		if (hMapping != nullptr) CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_pData = static_cast<const uint8_t*>(pView);
+	m_Size = (size_t)size.QuadPart;
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		printf("ERROR: Could not open level '%s'\n", path.c_str());
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		printf("ERROR: Level '%s' is empty\n", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	void* pView = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping keeps its own reference
+	if (pView == MAP_FAILED)
+	{
+		printf("ERROR: Could not map level '%s'\n", path.c_str());
+		return false;
+	}
+
+	m_pData = static_cast<const uint8_t*>(pView);
+	m_Size = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void GpplLevel::Unmap()
+{
+	if (m_pData == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_pData);
+	CloseHandle(m_hMapping);
+	CloseHandle(m_hFile);
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(m_pData), m_Size);
+#endif
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+bool GpplLevel::Parse()
+{
+	size_t cursor = 0;
+	b2Vec2 dimensions;
+	int32_t houseCount = 0;
+	if (!Read(cursor, dimensions.x) || !Read(cursor, dimensions.y) || !Read(cursor, houseCount) ||
+		!(dimensions.x > 0.0f) || !(dimensions.y > 0.0f) || !std::isfinite(dimensions.x) || !std::isfinite(dimensions.y) ||
+		houseCount < 0 || houseCount > MaxHouses)
+	{
+		printf("ERROR: Invalid level header in '%s'\n", m_Path.c_str());
+		return false;
+	}
+
+	m_WorldInfo.Center = b2Vec2(0.0f, 0.0f);
+	m_WorldInfo.Dimensions = dimensions;
+
+	// Spans can only point into m_Polygons once it stops growing
+	struct PolygonRange { size_t First, Count; };
+	std::vector<PolygonRange> ranges(houseCount * 2);
+
+	m_Houses.resize(houseCount);
+	for (int32_t i = 0; i < houseCount; i++)
+	{
+		HouseInfo& info = m_Houses[i].Info;
+		bool valid =
+			Read(cursor, info.Center.x) && Read(cursor, info.Center.y) &&
+			Read(cursor, info.Size.x) && Read(cursor, info.Size.y) &&
+			std::isfinite(info.Center.x) && std::isfinite(info.Center.y) &&
+			info.Size.x >= 0.0f && info.Size.y >= 0.0f &&
+			ParsePolygons(cursor, ranges[i * 2].First, ranges[i * 2].Count) &&
+			ParsePolygons(cursor, ranges[i * 2 + 1].First, ranges[i * 2 + 1].Count);
+
+		if (!valid)
+		{
+			printf("ERROR: Invalid house record %i in '%s'\n", i, m_Path.c_str());
+			return false;
+		}
+	}
+
+	if (cursor != m_Size)
+	{
+		printf("WARNING: Level '%s' has %u unread trailing bytes\n", m_Path.c_str(), (unsigned int)(m_Size - cursor));
+	}
+
+	for (int32_t i = 0; i < houseCount; i++)
+	{
+		m_Houses[i].WallBoxes = { m_Polygons.data() + ranges[i * 2].First, ranges[i * 2].Count };
+		m_Houses[i].WallOutlines = { m_Polygons.data() + ranges[i * 2 + 1].First, ranges[i * 2 + 1].Count };
+	}
+	return true;
+}
+
+bool GpplLevel::ParsePolygons(size_t& cursor, size_t& firstPolygon, size_t& polygonCount)
+{
+	int32_t count = 0;
+	if (!Read(cursor, count) || count < 0 || count > MaxPolygons)
+		return false;
+
+	firstPolygon = m_Polygons.size();
+	polygonCount = (size_t)count;
+	for (int32_t i = 0; i < count; i++)
+	{
+		int32_t vertexCount = 0;
+		if (!Read(cursor, vertexCount) || vertexCount < 0 || vertexCount > MaxVertices)
+			return false;
+
+		const size_t bytes = (size_t)vertexCount * sizeof(b2Vec2);
+		if (cursor + bytes > m_Size)
+			return false;
+
+		GpplPolygon polygon;
+		polygon.pData = reinterpret_cast<const b2Vec2*>(m_pData + cursor);
+		polygon.Count = (size_t)vertexCount;
+		for (const b2Vec2& vertex : polygon)
+		{
+			if (!std::isfinite(vertex.x) || !std::isfinite(vertex.y))
+				return false;
+		}
+
+		m_Polygons.push_back(polygon);
+		m_VertexCount += polygon.Count;
+		cursor += bytes;
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "HelperStructs.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------
+// GPPL LEVEL
+// Read-only view of a _Data/*.gppl level, for our own tooling (the
+// framework reads these itself). The file is memory mapped and the
+// wall polygons are spans straight over the mapped vertices, so
+// loading only allocates one house and one polygon table.
+//
+// File layout, little endian, 4 byte fields, no padding:
+//   float width, height; int32 houseCount
+//   per house: float centerX, centerY, sizeX, sizeY
+//              polygon list (wall boxes), polygon list (wall outlines)
+//   polygon list: int32 polygonCount, per polygon:
+//              int32 vertexCount, vertexCount * (float x, float y)
+//-----------------------------------------------------------------
+template<typename T>
+struct GpplSpan
+{
+	const T* pData = nullptr;
+	size_t Count = 0;
+
+	size_t size() const { return Count; }
+	bool empty() const { return Count == 0; }
+	const T& operator[](size_t index) const { return pData[index]; }
+	const T* begin() const { return pData; }
+	const T* end() const { return pData + Count; }
+};
+
+typedef GpplSpan<b2Vec2> GpplPolygon; // Points into the mapped file
+
+struct GpplHouse
+{
+	HouseInfo Info;
+	GpplSpan<GpplPolygon> WallBoxes; // Collision quads
+	GpplSpan<GpplPolygon> WallOutlines; // Merged wall polygons
+};
+
+class GpplLevel final
+{
+public:
+	GpplLevel() {}
+	~GpplLevel();
+	GpplLevel(const GpplLevel&) = delete;
+	GpplLevel& operator=(const GpplLevel&) = delete;
+
+	// Maps the file and validates every count and record against its size.
+	// Spans stay valid until Close, Open or destruction
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	const std::string& GetPath() const { return m_Path; }
+	// The framework centers levels on the origin
+	WorldInfo GetWorldInfo() const { return m_WorldInfo; }
+	GpplSpan<GpplHouse> GetHouses() const { return { m_Houses.data(), m_Houses.size() }; }
+	size_t GetPolygonCount() const { return m_Polygons.size(); }
+	size_t GetVertexCount() const { return m_VertexCount; }
+
+	static const int MaxHouses = 4096;
+	static const int MaxPolygons = 1024; // Per list
+	static const int MaxVertices = 1024; // Per polygon
+
+private:
+	bool Map(const std::string& path);
+	void Unmap();
+	bool Parse();
+	bool ParsePolygons(size_t& cursor, size_t& firstPolygon, size_t& polygonCount);
+
+	template<typename T> bool Read(size_t& cursor, T& val) const
+	{
+		if (cursor + sizeof(T) > m_Size) return false;
+		memcpy(&val, m_pData + cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	std::string m_Path;
+	const uint8_t* m_pData = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	void* m_hFile = nullptr;
+	void* m_hMapping = nullptr;
+#endif
+
+	WorldInfo m_WorldInfo = {};
+	std::vector<GpplHouse> m_Houses;
+	std::vector<GpplPolygon> m_Polygons; // Every house's polygons, back to back
+	size_t m_VertexCount = 0;
+};
@@ -12,6 +12,22 @@ bool operator==(const Enemy& lhs, const Enemy& rhs)
 	return lhs.enemyInfo.EnemyHash == rhs.enemyInfo.EnemyHash;
 }
 
+bool operator==(const NearestEnemyQuery& lhs, const NearestEnemyQuery& rhs)
+{
+	const Enemy& l = lhs.NearestEnemy;
+	const Enemy& r = rhs.NearestEnemy;
+	return	lhs.Found == rhs.Found &&
+			lhs.Distance == rhs.Distance &&
+			l.enemyInfo.EnemyHash == r.enemyInfo.EnemyHash &&
+			l.enemyInfo.Health == r.enemyInfo.Health &&
+			l.Position == r.Position &&
+			l.LastPosition == r.LastPosition &&
+			l.Velocity == r.Velocity &&
+			l.InFieldOfView == r.InFieldOfView &&
+			l.PredictedPosition == r.PredictedPosition &&
+			l.SecondsSinceInsideFOV == r.SecondsSinceInsideFOV;
+}
+
 bool operator==(const Item& lhs, const Item& rhs)
 {
 	return	lhs.ItemInfo.Type == rhs.ItemInfo.Type && 
@@ -20,19 +36,17 @@ bool operator==(const Item& lhs, const Item& rhs)
 
 bool operator==(const Pistol& lhs, const Pistol& rhs)
 {
-	return (lhs.Ammo == rhs.Ammo &&
-			lhs.DPS == rhs.DPS &&
-			lhs.Range == rhs.Range);
+	return lhs.entityInfo.EntityHash == rhs.entityInfo.EntityHash;
 }
 
 bool operator==(const HealthPack& lhs, const HealthPack& rhs)
 {
-	return (lhs.HealingAmount == rhs.HealingAmount);
+	return lhs.EntityInfo.EntityHash == rhs.EntityInfo.EntityHash;
 }
 
 bool operator==(const Food& lhs, const Food& rhs)
 {
-	return (lhs.EnergyAmount == rhs.EnergyAmount);
+	return lhs.EntityInfo.EntityHash == rhs.EntityInfo.EntityHash;
 }
 
 bool operator==(const House& lhs, const House& rhs)
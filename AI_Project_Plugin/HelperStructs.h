@@ -414,6 +414,17 @@ struct Enemy
 };
 bool operator==(const Enemy& lhs, const Enemy& rhs);
 
+// The nearest enemy in the FOV, looked up once per tick by TestBoxPlugin
+// so every behaviour asking about it shares the one query
+struct NearestEnemyQuery
+{
+	bool Found;
+	float Distance; // FLT_MAX if nothing was found
+	Enemy NearestEnemy;
+};
+// Unlike Enemy's, compares everything, so a moving enemy is a change
+bool operator==(const NearestEnemyQuery& lhs, const NearestEnemyQuery& rhs);
+
 struct ItemInfo
 {
 	eItemType Type;
@@ -422,8 +433,8 @@ struct ItemInfo
 
 struct Item
 {
-	EntityInfo EntityInfo;
-	ItemInfo ItemInfo;
+	::EntityInfo EntityInfo;
+	::ItemInfo ItemInfo;
 	bool Valid; // False for empty items (instead of nullptr)
 };
 bool operator==(const Item& lhs, const Item& rhs);
@@ -444,8 +455,8 @@ bool operator==(const Pistol& lhs, const Pistol& rhs);
 
 struct HealthPack
 {
-	EntityInfo EntityInfo;
-	ItemInfo ItemInfo;
+	::EntityInfo EntityInfo;
+	::ItemInfo ItemInfo;
 
 	b2Vec2 Position;
 	int HealingAmount;
@@ -455,8 +466,8 @@ bool operator==(const HealthPack& lhs, const HealthPack& rhs);
 
 struct Food
 {
-	EntityInfo EntityInfo;
-	ItemInfo ItemInfo;
+	::EntityInfo EntityInfo;
+	::ItemInfo ItemInfo;
 
 	b2Vec2 Position;
 	int EnergyAmount;
@@ -473,7 +484,8 @@ struct HouseInfo
 struct House
 {
 	HouseInfo Info;
-	float SecondsSinceLastVisit;
+	float LastVisitTime; // m_SecondsElapsed when we were last inside
+	bool DueForRevisit;
 	bool Unexplored;
 };
 bool operator==(const House& lhs, const House& rhs);
@@ -529,8 +541,8 @@ struct GameDebugParams //Debuggin Purposes only (Ignored during release build)
 	bool OverrideDifficulty = false;
 };
 
-template<class T>
-bool Contains(const std::vector<T>& vec, const T& t)
+template<class T, class Allocator>
+bool Contains(const std::vector<T, Allocator>& vec, const T& t)
 {
 	for (auto iter = vec.begin(); iter != vec.end(); ++iter)
 	{
@@ -544,7 +556,7 @@ bool Contains(const std::vector<T>& vec, const T& t)
 template<typename T>
 typename std::vector<T>::iterator IndexOf(std::vector<T>& vec, T& t)
 {
-	for (std::vector<T>::iterator iter = vec.begin(); iter != vec.end(); ++iter)
+	for (typename std::vector<T>::iterator iter = vec.begin(); iter != vec.end(); ++iter)
 	{
 		if (*iter == t) return iter;
 	}
@@ -0,0 +1,143 @@
+#include "stdafx.h"
+
+#include "InventoryModel.h"
+
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+void InventoryModel::Reset(int capacity)
+{
+	if (capacity > MaxCapacity)
+	{
+		printf("WARNING: Inventory capacity %i is more than the %i slots InventoryModel supports\n", capacity, MaxCapacity);
+		capacity = MaxCapacity;
+	}
+	capacity = std::max(capacity, 0);
+
+	Item emptyItem = {};
+	emptyItem.Valid = false;
+	m_Slots.assign(capacity, emptyItem);
+	m_Values.assign(capacity, 0.0f);
+	m_FreeMask = capacity == MaxCapacity ? ~0u : (1u << capacity) - 1;
+	std::fill(m_TypeMasks, m_TypeMasks + TypeCount, 0u);
+	for (int type = 0; type < TypeCount; type++)
+	{
+		m_RankedSlots[type].clear();
+	}
+	++m_Revision;
+}
+
+bool InventoryModel::Add(int slot, const EntityInfo& entityInfo, const ItemInfo& itemInfo, float value)
+{
+	if (!IsSlot(slot) || m_Slots[slot].Valid)
+		return false;
+
+	m_Slots[slot].EntityInfo = entityInfo;
+	m_Slots[slot].ItemInfo = itemInfo;
+	m_Slots[slot].Valid = true;
+	m_Values[slot] = value;
+	m_FreeMask &= ~(1u << slot);
+	Track(slot);
+	++m_Revision;
+	return true;
+}
+
+bool InventoryModel::Remove(int slot)
+{
+	if (!IsSlot(slot) || !m_Slots[slot].Valid)
+		return false;
+
+	Untrack(slot);
+	m_Slots[slot].ItemInfo = {};
+	m_Slots[slot].Valid = false;
+	m_Values[slot] = 0.0f;
+	m_FreeMask |= 1u << slot;
+	++m_Revision;
+	return true;
+}
+
+void InventoryModel::Refresh(int slot, const ItemInfo& itemInfo)
+{
+	if (!IsSlot(slot) || !m_Slots[slot].Valid)
+		return;
+
+	const ItemInfo& current = m_Slots[slot].ItemInfo;
+	if (itemInfo.Type == current.Type && itemInfo.ItemHash == current.ItemHash)
+		return;
+
+	Untrack(slot);
+	m_Slots[slot].ItemInfo = itemInfo;
+	Track(slot);
+	++m_Revision;
+}
+
+void InventoryModel::SetValue(int slot, float value)
+{
+	if (!IsSlot(slot) || !m_Slots[slot].Valid || m_Values[slot] == value)
+		return;
+
+	Untrack(slot);
+	m_Values[slot] = value;
+	Track(slot);
+}
+
+int InventoryModel::GetBestSlot(eItemType type, float maxValue) const
+{
+	if (!IsTracked(type))
+		return -1;
+
+	for (int slot : m_RankedSlots[type])
+	{
+		if (m_Values[slot] <= maxValue)
+			return slot;
+	}
+	return -1;
+}
+
+int InventoryModel::BitCount(uint32_t mask)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt(mask);
+#else
+	return __builtin_popcount(mask);
+#endif
+}
+
+int InventoryModel::LowestBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+void InventoryModel::Track(int slot)
+{
+	const eItemType type = m_Slots[slot].ItemInfo.Type;
+	if (!IsTracked(type))
+		return;
+
+	m_TypeMasks[type] |= 1u << slot;
+	std::vector<int>& ranked = m_RankedSlots[type];
+	auto before = std::find_if(ranked.begin(), ranked.end(), [this, slot](int other)
+	{
+		return m_Values[slot] > m_Values[other] || (m_Values[slot] == m_Values[other] && slot < other);
+	});
+	ranked.insert(before, slot);
+}
+
+void InventoryModel::Untrack(int slot)
+{
+	const eItemType type = m_Slots[slot].ItemInfo.Type;
+	if (!IsTracked(type))
+		return;
+
+	m_TypeMasks[type] &= ~(1u << slot);
+	std::vector<int>& ranked = m_RankedSlots[type];
+	ranked.erase(std::remove(ranked.begin(), ranked.end(), slot), ranked.end());
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "HelperStructs.h"
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+//-----------------------------------------------------------------
+// INVENTORY MODEL
+// Our copy of the agent's inventory slots, because the framework
+// complains when asked about an empty one. Besides the slots it keeps
+// a bitmask of free slots and one of occupied slots per item type, so
+// "is there room", "first free slot" and "do we have food" are a bit
+// count or a bit scan instead of a walk over the slots.
+// Every item also carries a value (healing, energy, pistol value) and
+// each type keeps its slots ordered by it, highest first, so picking
+// the consumable to use doesn't look at the others.
+// GetRevision changes whenever a slot does, not when a value does.
+//-----------------------------------------------------------------
+class InventoryModel final
+{
+public:
+	static const int MaxCapacity = 32; // Slots are bits in a uint32_t
+
+	InventoryModel() {}
+	~InventoryModel() {}
+
+	// Empties every slot
+	void Reset(int capacity);
+
+	// Returns false if the slot is out of range or already holds something
+	bool Add(int slot, const EntityInfo& entityInfo, const ItemInfo& itemInfo, float value);
+	// Returns false if the slot is out of range or empty
+	bool Remove(int slot);
+	// Takes what the framework says is in a full slot now
+	void Refresh(int slot, const ItemInfo& itemInfo);
+	void SetValue(int slot, float value);
+
+	int GetCapacity() const { return (int)m_Slots.size(); }
+	bool IsSlot(int slot) const { return slot >= 0 && slot < GetCapacity(); }
+	const Item& GetSlot(int slot) const { return m_Slots[slot]; }
+	float GetValue(int slot) const { return m_Values[slot]; }
+
+	bool HasSpace() const { return m_FreeMask != 0; }
+	// -1 if the inventory is full
+	int GetFirstEmptySlot() const { return m_FreeMask != 0 ? LowestBit(m_FreeMask) : -1; }
+	int GetEmptySlotCount() const { return BitCount(m_FreeMask); }
+
+	bool Has(eItemType type) const { return GetTypeMask(type) != 0; }
+	int GetCount(eItemType type) const { return BitCount(GetTypeMask(type)); }
+	// -1 if there's no item of that type
+	int GetFirstSlot(eItemType type) const
+	{
+		const uint32_t mask = GetTypeMask(type);
+		return mask != 0 ? LowestBit(mask) : -1;
+	}
+	// The slot of that type with the highest value that's at most maxValue, -1
+	// if there is none. Equal values go to the lowest slot
+	int GetBestSlot(eItemType type, float maxValue = FLT_MAX) const;
+
+	unsigned int GetRevision() const { return m_Revision; }
+
+private:
+	static const int TypeCount = _LASTITEM + 1;
+
+	static bool IsTracked(eItemType type) { return type >= 0 && type < TypeCount; }
+	uint32_t GetTypeMask(eItemType type) const { return IsTracked(type) ? m_TypeMasks[type] : 0; }
+	static int BitCount(uint32_t mask);
+	static int LowestBit(uint32_t mask); // mask can't be 0
+
+	void Track(int slot);
+	void Untrack(int slot);
+
+	std::vector<Item> m_Slots;
+	std::vector<float> m_Values;
+	uint32_t m_FreeMask = 0;
+	uint32_t m_TypeMasks[TypeCount] = {};
+	std::vector<int> m_RankedSlots[TypeCount]; // Highest value first, then lowest slot
+	unsigned int m_Revision = 0;
+};
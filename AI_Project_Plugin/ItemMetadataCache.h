@@ -0,0 +1,87 @@
+#pragma once
+
+#include "HelperStructs.h"
+
+#include <unordered_map>
+
+//-----------------------------------------------------------------
+// ITEM METADATA CACHE
+// Decoded ITEM_GetMetadata answers, keyed by ItemHash. Apart from a
+// pistol's ammo, an item's metadata never changes, so each value is
+// asked for once per item. Ammo is invalidated whenever the pistol is
+// fired and asked for again on the next lookup. Only answers the
+// framework found are stored, so a missing value is asked for (and
+// complained about) every time, like without the cache. Remove an
+// item once it's gone from the world.
+//-----------------------------------------------------------------
+enum eItemMetadata
+{
+	ITEM_METADATA_AMMO,
+	ITEM_METADATA_DPS,
+	ITEM_METADATA_RANGE,
+	ITEM_METADATA_HEALTH,
+	ITEM_METADATA_ENERGY,
+	_ITEM_METADATA_COUNT
+};
+
+// The category string ITEM_GetMetadata takes
+inline const char* ItemMetadataCategory(eItemMetadata field)
+{
+	static const char* s_Categories[_ITEM_METADATA_COUNT] = { "ammo", "dps", "range", "health", "energy" };
+	return s_Categories[field];
+}
+
+class ItemMetadataCache final
+{
+public:
+	ItemMetadataCache() {}
+	~ItemMetadataCache() {}
+
+	// Returns false if the value isn't cached
+	template<typename T>
+	bool Get(int itemHash, eItemMetadata field, T& val)
+	{
+		auto it = m_Entries.find(itemHash);
+		if (it == m_Entries.end() || (it->second.KnownMask & (1u << field)) == 0)
+		{
+			++m_MissCount;
+			return false;
+		}
+
+		++m_HitCount;
+		val = (T)it->second.Values[field];
+		return true;
+	}
+	template<typename T>
+	void Set(int itemHash, eItemMetadata field, T val)
+	{
+		Entry& entry = m_Entries[itemHash];
+		entry.Values[field] = CheapVariant(val);
+		entry.KnownMask |= 1u << field;
+	}
+
+	// The next Get for this value asks the framework again
+	void Invalidate(int itemHash, eItemMetadata field)
+	{
+		auto it = m_Entries.find(itemHash);
+		if (it != m_Entries.end())
+			it->second.KnownMask &= ~(1u << field);
+	}
+	void Remove(int itemHash) { m_Entries.erase(itemHash); }
+	void Clear() { m_Entries.clear(); }
+
+	size_t size() const { return m_Entries.size(); }
+	unsigned int GetHitCount() const { return m_HitCount; }
+	unsigned int GetMissCount() const { return m_MissCount; }
+
+private:
+	struct Entry
+	{
+		CheapVariant Values[_ITEM_METADATA_COUNT];
+		unsigned int KnownMask = 0; // Bit per eItemMetadata
+	};
+
+	std::unordered_map<int, Entry> m_Entries;
+	unsigned int m_HitCount = 0;
+	unsigned int m_MissCount = 0;
+};
@@ -0,0 +1,231 @@
+#include "stdafx.h"
+
+#include "NavigationGrid.h"
+
+#include <algorithm>
+#include <functional>
+
+void NavigationGrid::Build(const GpplLevel& level, float cellSize, float agentRadius)
+{
+	const WorldInfo worldInfo = level.GetWorldInfo();
+	m_CellSize = cellSize;
+	m_Origin = worldInfo.Center - worldInfo.Dimensions / 2.0f;
+	m_Columns = (int)ceil(worldInfo.Dimensions.x / m_CellSize);
+	m_Rows = (int)ceil(worldInfo.Dimensions.y / m_CellSize);
+	m_Blocked.assign(m_Columns * m_Rows, 0);
+
+	// Inflate every wall by the agent's radius so cell centers are safe to stand on
+	for (const GpplHouse& house : level.GetHouses())
+	{
+		for (const GpplPolygon& box : house.WallBoxes)
+		{
+			if (box.empty()) continue;
+
+			b2Vec2 min = box[0], max = box[0];
+			for (const b2Vec2& vertex : box)
+			{
+				min = b2Min(min, vertex);
+				max = b2Max(max, vertex);
+			}
+			min -= b2Vec2(agentRadius, agentRadius);
+			max += b2Vec2(agentRadius, agentRadius);
+
+			const int minCell = CellAt(min), maxCell = CellAt(max);
+			for (int y = minCell / m_Columns; y <= maxCell / m_Columns; y++)
+			{
+				for (int x = minCell % m_Columns; x <= maxCell % m_Columns; x++)
+				{
+					const int cell = y * m_Columns + x;
+					const b2Vec2 center = CellCenter(cell);
+					if (center.x >= min.x && center.x <= max.x && center.y >= min.y && center.y <= max.y)
+					{
+						m_Blocked[cell] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	const size_t cellCount = m_Blocked.size();
+	m_CostSoFar.assign(cellCount, FLT_MAX);
+	m_CameFrom.assign(cellCount, -1);
+	m_VisitStamps.assign(cellCount, 0);
+	m_SearchStamp = 0;
+}
+
+void NavigationGrid::Clear()
+{
+	m_Columns = 0;
+	m_Rows = 0;
+	m_Blocked.clear();
+	m_CostSoFar.clear();
+	m_CameFrom.clear();
+	m_VisitStamps.clear();
+}
+
+bool NavigationGrid::FindPath(const b2Vec2& start, const b2Vec2& goal, std::vector<b2Vec2>& path, float* pPathLength) const
+{
+	path.clear();
+	if (!IsBuilt() || IsLineClear(start, goal))
+	{
+		path.push_back(goal);
+		if (pPathLength) *pPathLength = b2Distance(start, goal);
+		return true;
+	}
+
+	const int startCell = CellAt(start);
+	const int goalCell = CellAt(goal);
+	if (!Search(startCell, goalCell, goal))
+		return false;
+
+	// Cell centers start -> goal, the start cell itself is where the agent already is
+	m_CellPath.clear();
+	for (int cell = m_CameFrom[goalCell]; cell != -1 && cell != startCell; cell = m_CameFrom[cell])
+	{
+		m_CellPath.push_back(cell);
+	}
+	std::reverse(m_CellPath.begin(), m_CellPath.end());
+
+	// String pulling: from each waypoint, skip to the furthest point still in sight
+	const int pointCount = (int)m_CellPath.size() + 1;
+	auto pointAt = [&](int i) { return i < (int)m_CellPath.size() ? CellCenter(m_CellPath[i]) : goal; };
+
+	b2Vec2 anchor = start;
+	float pathLength = 0.0f;
+	int next = 0;
+	while (next < pointCount)
+	{
+		int furthest = next;
+		for (int i = pointCount - 1; i > next; i--)
+		{
+			if (IsLineClear(anchor, pointAt(i)))
+			{
+				furthest = i;
+				break;
+			}
+		}
+
+		const b2Vec2 waypoint = pointAt(furthest);
+		pathLength += b2Distance(anchor, waypoint);
+		path.push_back(waypoint);
+		anchor = waypoint;
+		next = furthest + 1;
+	}
+
+	if (pPathLength) *pPathLength = pathLength;
+	return true;
+}
+
+b2Vec2 NavigationGrid::GetClosestPathPoint(const b2Vec2& start, const b2Vec2& goal) const
+{
+	if (!IsBuilt() || IsLineClear(start, goal))
+		return goal;
+
+	const int startCell = CellAt(start);
+	const int goalCell = CellAt(goal);
+	if (!Search(startCell, goalCell, goal))
+		return goal;
+
+	// Path cells run goal -> start, keep the first one the agent can see
+	b2Vec2 pathPoint = goal;
+	for (int cell = m_CameFrom[goalCell]; cell != -1 && cell != startCell; cell = m_CameFrom[cell])
+	{
+		pathPoint = CellCenter(cell);
+		if (IsLineClear(start, pathPoint))
+			break;
+	}
+	return pathPoint;
+}
+
+bool NavigationGrid::IsLineClear(const b2Vec2& from, const b2Vec2& to) const
+{
+	if (!IsBuilt()) return true;
+
+	const float length = b2Distance(from, to);
+	const int steps = (int)(length / (m_CellSize * 0.5f)) + 1;
+	for (int i = 1; i < steps; i++)
+	{
+		const b2Vec2 point = from + (to - from) * ((float)i / steps);
+		if (m_Blocked[CellAt(point)])
+			return false;
+	}
+	return true;
+}
+
+int NavigationGrid::CellAt(const b2Vec2& point) const
+{
+	if (m_Columns == 0 || m_Rows == 0)
+		return -1;
+
+	const b2Vec2 local = point - m_Origin;
+	const int x = Clamp((int)(local.x / m_CellSize), 0, m_Columns - 1);
+	const int y = Clamp((int)(local.y / m_CellSize), 0, m_Rows - 1);
+	return y * m_Columns + x;
+}
+
+b2Vec2 NavigationGrid::CellCenter(int cell) const
+{
+	return m_Origin + b2Vec2(((cell % m_Columns) + 0.5f) * m_CellSize, ((cell / m_Columns) + 0.5f) * m_CellSize);
+}
+
+bool NavigationGrid::Search(int startCell, int goalCell, const b2Vec2& goal) const
+{
+	if (++m_SearchStamp == 0)
+	{
+		// Wrapped around, old stamps could match again
+		std::fill(m_VisitStamps.begin(), m_VisitStamps.end(), 0);
+		m_SearchStamp = 1;
+	}
+
+	auto cost = [this](int cell) { return Visited(cell) ? m_CostSoFar[cell] : FLT_MAX; };
+	auto visit = [this](int cell, float newCost, int parent)
+	{
+		m_VisitStamps[cell] = m_SearchStamp;
+		m_CostSoFar[cell] = newCost;
+		m_CameFrom[cell] = parent;
+	};
+
+	std::greater<OpenEntry> lowestFirst;
+	m_OpenSet.clear();
+	visit(startCell, 0.0f, -1);
+	m_OpenSet.push_back(OpenEntry(0.0f, startCell));
+	while (!m_OpenSet.empty())
+	{
+		std::pop_heap(m_OpenSet.begin(), m_OpenSet.end(), lowestFirst);
+		const int cell = m_OpenSet.back().second;
+		m_OpenSet.pop_back();
+		if (cell == goalCell)
+			break;
+
+		const int column = cell % m_Columns;
+		const int row = cell / m_Columns;
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				const int x = column + dx, y = row + dy;
+				if ((dx == 0 && dy == 0) || x < 0 || y < 0 || x >= m_Columns || y >= m_Rows)
+					continue;
+
+				const int neighbour = y * m_Columns + x;
+				if (m_Blocked[neighbour] && neighbour != goalCell)
+					continue;
+				// No corner cutting
+				if (dx != 0 && dy != 0 &&
+					(m_Blocked[row * m_Columns + x] || m_Blocked[y * m_Columns + column]))
+					continue;
+
+				const float newCost = m_CostSoFar[cell] + ((dx != 0 && dy != 0) ? 1.4142f : 1.0f);
+				if (newCost < cost(neighbour))
+				{
+					visit(neighbour, newCost, cell);
+					const float heuristic = b2Distance(CellCenter(neighbour), goal) / m_CellSize;
+					m_OpenSet.push_back(OpenEntry(newCost + heuristic, neighbour));
+					std::push_heap(m_OpenSet.begin(), m_OpenSet.end(), lowestFirst);
+				}
+			}
+		}
+	}
+
+	return goalCell == startCell || (Visited(goalCell) && m_CameFrom[goalCell] != -1);
+}
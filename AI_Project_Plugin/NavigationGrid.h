@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GpplLevel.h"
+#include "HelperStructs.h"
+
+#include <cstdint>
+#include <vector>
+
+//-----------------------------------------------------------------
+// NAVIGATION GRID
+// Plugin-side stand-in for the framework's navmesh, built once from
+// a level's wall boxes: a walkability grid (walls inflated by the
+// agent's radius), 8-connected A* without corner cutting, and line
+// of sight string pulling to turn the cell path into a corridor of
+// straight segments.
+//-----------------------------------------------------------------
+class NavigationGrid final
+{
+public:
+	NavigationGrid() {}
+	~NavigationGrid() {}
+
+	void Build(const GpplLevel& level, float cellSize = 2.0f, float agentRadius = 0.75f);
+	void Clear();
+	bool IsBuilt() const { return !m_Blocked.empty(); }
+
+	// Fills path with the waypoints from start (excluded) to goal (included).
+	// Returns false, leaving path empty, when the goal can't be reached
+	bool FindPath(const b2Vec2& start, const b2Vec2& goal, std::vector<b2Vec2>& path, float* pPathLength = nullptr) const;
+	// Same answer NAVMESH_GetClosestPathPoint gives: the goal if it's in sight, otherwise
+	// the path cell closest to the goal that can be walked to in a straight line
+	b2Vec2 GetClosestPathPoint(const b2Vec2& start, const b2Vec2& goal) const;
+	bool IsLineClear(const b2Vec2& from, const b2Vec2& to) const;
+
+	int CellAt(const b2Vec2& point) const;
+	b2Vec2 CellCenter(int cell) const;
+	bool IsBlocked(int cell) const { return m_Blocked[cell] != 0; }
+	float GetCellSize() const { return m_CellSize; }
+
+private:
+	// Runs A* and leaves the result in m_CameFrom. False when goalCell wasn't reached
+	bool Search(int startCell, int goalCell, const b2Vec2& goal) const;
+	bool Visited(int cell) const { return m_VisitStamps[cell] == m_SearchStamp; }
+
+	b2Vec2 m_Origin = b2Vec2(0.0f, 0.0f); // Bottom left corner of the world
+	float m_CellSize = 2.0f;
+	int m_Columns = 0;
+	int m_Rows = 0;
+	std::vector<uint8_t> m_Blocked;
+
+	// Search scratch, reused so a query doesn't allocate. A cell's cost and
+	// parent are only valid when its stamp matches the current search
+	typedef std::pair<float, int> OpenEntry;
+	mutable std::vector<float> m_CostSoFar;
+	mutable std::vector<int> m_CameFrom;
+	mutable std::vector<uint32_t> m_VisitStamps;
+	mutable uint32_t m_SearchStamp = 0;
+	mutable std::vector<OpenEntry> m_OpenSet;
+	mutable std::vector<int> m_CellPath;
+};
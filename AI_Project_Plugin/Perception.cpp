@@ -0,0 +1,113 @@
+#include "stdafx.h"
+
+#include "Perception.h"
+
+#include <algorithm>
+#include <climits>
+
+void FovDelta::Update(std::vector<EntityInfo>&& entities)
+{
+	m_PreviousEntities.swap(m_Entities);
+	m_PreviousSettled.swap(m_Settled);
+	m_PreviousIndices.swap(m_Indices);
+	m_Entities.swap(entities);
+
+	const size_t count = m_Entities.size();
+	m_Indices.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_Indices[i] = HashIndex(m_Entities[i].EntityHash, (int)i);
+	}
+	std::sort(m_Indices.begin(), m_Indices.end());
+
+	m_Changes.resize(count);
+	m_Settled.resize(count);
+	m_EnteredCount = 0;
+	m_MovedCount = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const int previousIndex = Find(m_PreviousIndices, m_Entities[i].EntityHash);
+		if (previousIndex == -1)
+		{
+			m_Changes[i] = FOV_ENTERED;
+			m_Settled[i] = 0;
+			++m_EnteredCount;
+			continue;
+		}
+
+		if (m_Entities[i].Position == m_PreviousEntities[previousIndex].Position)
+		{
+			m_Changes[i] = FOV_UNCHANGED;
+			m_Settled[i] = m_PreviousSettled[previousIndex];
+		}
+		else
+		{
+			m_Changes[i] = FOV_MOVED;
+			m_Settled[i] = 0;
+			++m_MovedCount;
+		}
+	}
+
+	// Hand the caller's buffer back empty rather than holding last tick's FOV
+	entities.clear();
+}
+
+void FovDelta::Clear()
+{
+	m_Entities.clear();
+	m_Changes.clear();
+	m_Settled.clear();
+	m_Indices.clear();
+	m_EnteredCount = 0;
+	m_MovedCount = 0;
+}
+
+int FovDelta::Find(const std::vector<HashIndex>& indices, int entityHash)
+{
+	auto it = std::lower_bound(indices.begin(), indices.end(), HashIndex(entityHash, INT_MIN));
+	return (it != indices.end() && it->first == entityHash) ? it->second : -1;
+}
+
+void PerceptionSnapshot::Update(std::vector<EntityInfo>&& entities)
+{
+	m_Fov.Update(std::move(entities));
+
+	++m_Epoch;
+	const size_t count = m_Fov.GetEntities().size();
+	m_EnemyInfos.resize(count);
+	m_HasEnemyInfo.assign(count, (uint8_t)0);
+	m_Visible.assign(count, (uint8_t)1);
+	m_VerifiedEpochs.assign(count, m_Epoch);
+}
+
+void PerceptionSnapshot::Clear()
+{
+	m_Fov.Clear();
+	m_EnemyInfos.clear();
+	m_HasEnemyInfo.clear();
+	m_Visible.clear();
+	m_VerifiedEpochs.clear();
+}
+
+void PerceptionSnapshot::SetEnemyInfo(size_t index, const EnemyInfo& enemyInfo)
+{
+	m_EnemyInfos[index] = enemyInfo;
+	m_HasEnemyInfo[index] = 1;
+}
+
+void PerceptionSnapshot::SetVerified(size_t index, bool visible)
+{
+	m_Visible[index] = visible ? 1 : 0;
+	m_VerifiedEpochs[index] = m_Epoch;
+}
+
+void PerceptionSnapshot::VerifyAll(const std::vector<EntityInfo>& entities)
+{
+	std::fill(m_Visible.begin(), m_Visible.end(), (uint8_t)0);
+	for (const EntityInfo& entityInfo : entities)
+	{
+		const int index = m_Fov.IndexOf(entityInfo.EntityHash);
+		if (index != -1) m_Visible[index] = 1;
+	}
+	std::fill(m_VerifiedEpochs.begin(), m_VerifiedEpochs.end(), m_Epoch);
+}
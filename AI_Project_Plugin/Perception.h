@@ -0,0 +1,115 @@
+#pragma once
+
+#include "HelperStructs.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+enum eFovChange
+{
+	FOV_ENTERED,	// Wasn't in the FOV last tick
+	FOV_MOVED,		// Was, somewhere else
+	FOV_UNCHANGED	// Was, right here
+};
+
+//-----------------------------------------------------------------
+// FOV DELTA
+// Diffs each tick's FOV against the last one by EntityHash. The
+// entities stay in the order the framework gave them, each tagged
+// entered, moved or unchanged. Lookups go through a vector of (hash,
+// index) pairs sorted by hash, so once the vectors have grown Update
+// doesn't allocate.
+// Owners can mark an entity settled when there's nothing more to do
+// for it; the mark stays while the entity sits still in the FOV and
+// is dropped as soon as it moves or leaves.
+//-----------------------------------------------------------------
+class FovDelta final
+{
+public:
+	FovDelta() {}
+	~FovDelta() {}
+
+	// Takes this tick's FOV and diffs it against the previous one
+	void Update(std::vector<EntityInfo>&& entities);
+	// Forgets the previous FOV, the next Update sees everything as entered
+	void Clear();
+
+	const std::vector<EntityInfo>& GetEntities() const { return m_Entities; }
+	eFovChange GetChange(size_t index) const { return (eFovChange)m_Changes[index]; }
+	int GetEnteredCount() const { return m_EnteredCount; }
+	int GetMovedCount() const { return m_MovedCount; }
+
+	// Returns -1 if the entity isn't in the FOV
+	int IndexOf(int entityHash) const { return Find(m_Indices, entityHash); }
+	bool IsVisible(int entityHash) const { return IndexOf(entityHash) != -1; }
+
+	bool IsSettled(size_t index) const { return m_Settled[index] != 0; }
+	void SetSettled(size_t index, bool settled) { m_Settled[index] = settled ? 1 : 0; }
+
+private:
+	typedef std::pair<int, int> HashIndex; // EntityHash, index into m_Entities
+
+	static int Find(const std::vector<HashIndex>& indices, int entityHash);
+
+	std::vector<EntityInfo> m_Entities;
+	std::vector<uint8_t> m_Changes; // eFovChange
+	std::vector<uint8_t> m_Settled;
+	std::vector<HashIndex> m_Indices; // Sorted by hash
+
+	// The previous FOV, kept around so its buffers get reused
+	std::vector<EntityInfo> m_PreviousEntities;
+	std::vector<uint8_t> m_PreviousSettled;
+	std::vector<HashIndex> m_PreviousIndices;
+
+	int m_EnteredCount = 0;
+	int m_MovedCount = 0;
+};
+
+//-----------------------------------------------------------------
+// PERCEPTION SNAPSHOT
+// What the FOV showed this tick, taken once at the top of Update: the
+// entities, diffed by FovDelta, and the EnemyInfo of the enemies among
+// them, kept the first time someone fetches it so nobody asks the
+// framework twice.
+// Acting on the world (firing a pistol) can make the snapshot wrong, so
+// call Invalidate afterwards. Entities then count as unverified until
+// someone re-checks them, see TestBoxPlugin::IsEntityVisible, and the
+// answer holds until the next Invalidate.
+//-----------------------------------------------------------------
+class PerceptionSnapshot final
+{
+public:
+	PerceptionSnapshot() {}
+	~PerceptionSnapshot() {}
+
+	// Starts the tick with a new FOV
+	void Update(std::vector<EntityInfo>&& entities);
+	void Clear();
+	void Invalidate() { ++m_Epoch; }
+
+	FovDelta& GetFov() { return m_Fov; }
+	const FovDelta& GetFov() const { return m_Fov; }
+	const std::vector<EntityInfo>& GetEntities() const { return m_Fov.GetEntities(); }
+
+	// Indices are into GetEntities
+	bool HasEnemyInfo(size_t index) const { return m_HasEnemyInfo[index] != 0; }
+	const EnemyInfo& GetEnemyInfo(size_t index) const { return m_EnemyInfos[index]; }
+	void SetEnemyInfo(size_t index, const EnemyInfo& enemyInfo);
+
+	// False once something since the last Invalidate may have removed the entity
+	bool IsVerified(size_t index) const { return m_VerifiedEpochs[index] == m_Epoch; }
+	// Only meaningful while verified
+	bool IsVisible(size_t index) const { return m_Visible[index] != 0; }
+	void SetVerified(size_t index, bool visible);
+	// Verifies every entity against a FOV taken after the last Invalidate
+	void VerifyAll(const std::vector<EntityInfo>& entities);
+
+private:
+	FovDelta m_Fov;
+	std::vector<EnemyInfo> m_EnemyInfos;
+	std::vector<uint8_t> m_HasEnemyInfo;
+	std::vector<uint8_t> m_Visible;
+	std::vector<unsigned int> m_VerifiedEpochs;
+	unsigned int m_Epoch = 0;
+};
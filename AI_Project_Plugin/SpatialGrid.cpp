@@ -0,0 +1,165 @@
+#include "stdafx.h"
+
+#include "SpatialGrid.h"
+
+#include <algorithm>
+
+void SpatialGrid::Initialize(const WorldInfo& worldInfo, float cellSize)
+{
+	m_CellSize = std::max(cellSize, 0.1f);
+	m_InvCellSize = 1.0f / m_CellSize;
+	m_Min = worldInfo.Center - worldInfo.Dimensions / 2.0f;
+	m_Columns = std::max((int)ceilf(worldInfo.Dimensions.x * m_InvCellSize), 1);
+	m_Rows = std::max((int)ceilf(worldInfo.Dimensions.y * m_InvCellSize), 1);
+
+	m_Buckets.clear();
+	m_Buckets.resize((size_t)m_Columns * m_Rows * _SPATIAL_CATEGORY_COUNT);
+	m_CellOfEntry.clear();
+	++m_Revision;
+}
+
+void SpatialGrid::Clear()
+{
+	for (auto& bucket : m_Buckets)
+	{
+		bucket.clear();
+	}
+	m_CellOfEntry.clear();
+	++m_Revision;
+}
+
+bool SpatialGrid::Insert(eSpatialCategory category, int key, const b2Vec2& position)
+{
+	const int cell = CellOf(position);
+	if (!m_CellOfEntry.emplace(MakeId(category, key), cell).second)
+		return false;
+
+	Bucket(cell, category).push_back({ position, key });
+	++m_Revision;
+	return true;
+}
+
+bool SpatialGrid::Move(eSpatialCategory category, int key, const b2Vec2& position)
+{
+	auto it = m_CellOfEntry.find(MakeId(category, key));
+	if (it == m_CellOfEntry.end())
+		return false;
+
+	const int newCell = CellOf(position);
+	if (newCell == it->second)
+	{
+		std::vector<Entry>& bucket = Bucket(newCell, category);
+		for (size_t i = 0; i < bucket.size(); i++)
+		{
+			if (bucket[i].Key == key)
+			{
+				bucket[i].Position = position;
+				break;
+			}
+		}
+	}
+	else
+	{
+		RemoveFromBucket(Bucket(it->second, category), key);
+		Bucket(newCell, category).push_back({ position, key });
+		it->second = newCell;
+	}
+	++m_Revision;
+	return true;
+}
+
+bool SpatialGrid::Remove(eSpatialCategory category, int key)
+{
+	auto it = m_CellOfEntry.find(MakeId(category, key));
+	if (it == m_CellOfEntry.end())
+		return false;
+
+	RemoveFromBucket(Bucket(it->second, category), key);
+	m_CellOfEntry.erase(it);
+	++m_Revision;
+	return true;
+}
+
+bool SpatialGrid::Contains(eSpatialCategory category, int key) const
+{
+	return m_CellOfEntry.find(MakeId(category, key)) != m_CellOfEntry.end();
+}
+
+void SpatialGrid::FindNearestOfEach(const b2Vec2& center, float maxDistance, unsigned int categoryMask, SpatialNearestResult& result) const
+{
+	result = SpatialNearestResult();
+
+	const int column = ColumnOf(center.x);
+	const int row = RowOf(center.y);
+	const int maxRing = std::max(std::max(column, m_Columns - 1 - column), std::max(row, m_Rows - 1 - row));
+
+	float bestDistanceSqr[_SPATIAL_CATEGORY_COUNT];
+	std::fill(bestDistanceSqr, bestDistanceSqr + _SPATIAL_CATEGORY_COUNT, maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX);
+	unsigned int openMask = categoryMask & ((1u << _SPATIAL_CATEGORY_COUNT) - 1);
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		// A category is settled once nothing this far out can beat what it has
+		const float ringDistance = RingDistance(ring);
+		for (int category = 0; category < _SPATIAL_CATEGORY_COUNT; category++)
+		{
+			if (ringDistance * ringDistance >= bestDistanceSqr[category])
+				openMask &= ~(1u << category);
+		}
+		if (openMask == 0)
+			break;
+
+		VisitRing(column, row, ring, [&](int cell)
+		{
+			for (int category = 0; category < _SPATIAL_CATEGORY_COUNT; category++)
+			{
+				if ((openMask & (1u << category)) == 0) continue;
+
+				const std::vector<Entry>& bucket = Bucket(cell, (eSpatialCategory)category);
+				for (size_t i = 0; i < bucket.size(); i++)
+				{
+					const float distanceSqr = b2DistanceSquared(bucket[i].Position, center);
+					if (distanceSqr < bestDistanceSqr[category])
+					{
+						bestDistanceSqr[category] = distanceSqr;
+						result.Nearest[category] = { bucket[i].Key, (eSpatialCategory)category, distanceSqr };
+						result.FoundMask |= 1u << category;
+					}
+				}
+			}
+		});
+	}
+
+	for (int category = 0; category < _SPATIAL_CATEGORY_COUNT; category++)
+	{
+		if ((result.FoundMask & (1u << category)) &&
+			(result.NearestCategory == -1 || result.Nearest[category].DistanceSqr < result.Nearest[result.NearestCategory].DistanceSqr))
+		{
+			result.NearestCategory = category;
+		}
+	}
+}
+
+int SpatialGrid::ColumnOf(float x) const
+{
+	const int column = (int)floorf((x - m_Min.x) * m_InvCellSize);
+	return std::min(std::max(column, 0), m_Columns - 1);
+}
+
+int SpatialGrid::RowOf(float y) const
+{
+	const int row = (int)floorf((y - m_Min.y) * m_InvCellSize);
+	return std::min(std::max(row, 0), m_Rows - 1);
+}
+
+void SpatialGrid::RemoveFromBucket(std::vector<Entry>& bucket, int key)
+{
+	for (size_t i = 0; i < bucket.size(); i++)
+	{
+		if (bucket[i].Key == key)
+		{
+			bucket[i] = bucket.back();
+			bucket.pop_back();
+			return;
+		}
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "HelperStructs.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//-----------------------------------------------------------------
+// SPATIAL GRID
+// Uniform grid over the world bounds holding every cached entity,
+// bucketed per category so a "nearest food" query never touches
+// enemies. Entries outside the world are clamped into the border
+// cells, which keeps the ring search's distance bound valid.
+// Keys are the same hashes the WorldCaches use (EntityHash for
+// items, EnemyHash for enemies), unique per category.
+//-----------------------------------------------------------------
+enum eSpatialCategory
+{
+	SPATIAL_ITEM, // Not inspected yet, type unknown
+	SPATIAL_HEALTH,
+	SPATIAL_FOOD,
+	SPATIAL_PISTOL,
+	SPATIAL_ENEMY,
+	_SPATIAL_CATEGORY_COUNT
+};
+
+inline unsigned int SpatialCategoryBit(eSpatialCategory category) { return 1u << category; }
+const unsigned int SPATIAL_ALL_ITEMS =
+	(1u << SPATIAL_ITEM) | (1u << SPATIAL_HEALTH) | (1u << SPATIAL_FOOD) | (1u << SPATIAL_PISTOL);
+
+struct SpatialQueryResult
+{
+	int Key;
+	eSpatialCategory Category;
+	float DistanceSqr;
+};
+
+// The nearest entry of each category a FindNearestOfEach asked for
+struct SpatialNearestResult
+{
+	bool Has(eSpatialCategory category) const { return (FoundMask & SpatialCategoryBit(category)) != 0; }
+	int GetKey(eSpatialCategory category) const { return Nearest[category].Key; }
+
+	SpatialQueryResult Nearest[_SPATIAL_CATEGORY_COUNT]; // Only valid where Has is true
+	unsigned int FoundMask = 0;
+	int NearestCategory = -1; // The closest of them all, -1 if nothing was found
+};
+
+class SpatialGrid final
+{
+public:
+	SpatialGrid() {}
+	~SpatialGrid() {}
+
+	// Removes every entry and resizes the grid to cover the world
+	void Initialize(const WorldInfo& worldInfo, float cellSize = 10.0f);
+	void Clear();
+
+	// Insert returns false if the key is already in the grid, Move and Remove if it isn't
+	bool Insert(eSpatialCategory category, int key, const b2Vec2& position);
+	bool Move(eSpatialCategory category, int key, const b2Vec2& position);
+	bool Remove(eSpatialCategory category, int key);
+	bool Contains(eSpatialCategory category, int key) const;
+	size_t GetEntryCount() const { return m_CellOfEntry.size(); }
+	// Changes on every Insert, Move, Remove and Clear
+	unsigned int GetRevision() const { return m_Revision; }
+
+	// Nearest entry of one category strictly closer than maxDistance that accept(key) agrees to
+	template<typename Predicate>
+	bool FindNearest(const b2Vec2& center, float maxDistance, eSpatialCategory category,
+		int& key, float& distance, Predicate accept) const;
+	bool FindNearest(const b2Vec2& center, float maxDistance, eSpatialCategory category, int& key, float& distance) const
+	{
+		return FindNearest(center, maxDistance, category, key, distance, [](int) { return true; });
+	}
+	// FindNearest for every category in the mask at once, in one walk over the cells.
+	// Each category gets the same entry FindNearest would have given it
+	void FindNearestOfEach(const b2Vec2& center, float maxDistance, unsigned int categoryMask, SpatialNearestResult& result) const;
+
+private:
+	struct Entry
+	{
+		b2Vec2 Position;
+		int Key;
+	};
+
+	static uint64_t MakeId(eSpatialCategory category, int key) { return ((uint64_t)category << 32) | (uint32_t)key; }
+
+	int ColumnOf(float x) const;
+	int RowOf(float y) const;
+	int CellOf(const b2Vec2& position) const { return RowOf(position.y) * m_Columns + ColumnOf(position.x); }
+	std::vector<Entry>& Bucket(int cell, eSpatialCategory category) { return m_Buckets[cell * _SPATIAL_CATEGORY_COUNT + category]; }
+	const std::vector<Entry>& Bucket(int cell, eSpatialCategory category) const { return m_Buckets[cell * _SPATIAL_CATEGORY_COUNT + category]; }
+	static void RemoveFromBucket(std::vector<Entry>& bucket, int key);
+
+	// Calls visit(cell) for every cell at Chebyshev distance ring from (column, row)
+	template<typename Visitor>
+	void VisitRing(int column, int row, int ring, Visitor visit) const;
+	// No entry in a cell ring cells away is closer than this
+	float RingDistance(int ring) const { return ring > 0 ? (ring - 1) * m_CellSize : 0.0f; }
+
+	b2Vec2 m_Min = b2Vec2(0.0f, 0.0f);
+	float m_CellSize = 10.0f;
+	float m_InvCellSize = 0.1f;
+	int m_Columns = 1;
+	int m_Rows = 1;
+
+	std::vector<std::vector<Entry>> m_Buckets = std::vector<std::vector<Entry>>(_SPATIAL_CATEGORY_COUNT); // [cell][category]
+	std::unordered_map<uint64_t, int> m_CellOfEntry; // (category, key) -> cell
+	unsigned int m_Revision = 0;
+};
+
+template<typename Visitor>
+void SpatialGrid::VisitRing(int column, int row, int ring, Visitor visit) const
+{
+	const int minColumn = column - ring, maxColumn = column + ring;
+	const int minRow = row - ring, maxRow = row + ring;
+	for (int y = std::max(minRow, 0); y <= std::min(maxRow, m_Rows - 1); y++)
+	{
+		// Inner rows only have their two end cells on the ring
+		const bool edgeRow = (y == minRow || y == maxRow || ring == 0);
+		const int step = edgeRow ? 1 : maxColumn - minColumn;
+		for (int x = minColumn; x <= maxColumn; x += step)
+		{
+			if (x >= 0 && x < m_Columns)
+				visit(y * m_Columns + x);
+		}
+	}
+}
+
+template<typename Predicate>
+bool SpatialGrid::FindNearest(const b2Vec2& center, float maxDistance, eSpatialCategory category,
+	int& key, float& distance, Predicate accept) const
+{
+	const int column = ColumnOf(center.x);
+	const int row = RowOf(center.y);
+	const int maxRing = std::max(std::max(column, m_Columns - 1 - column), std::max(row, m_Rows - 1 - row));
+
+	float bestDistanceSqr = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+	bool found = false;
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		const float ringDistance = RingDistance(ring);
+		if (ringDistance * ringDistance >= bestDistanceSqr)
+			break;
+
+		VisitRing(column, row, ring, [&](int cell)
+		{
+			const std::vector<Entry>& bucket = Bucket(cell, category);
+			for (size_t i = 0; i < bucket.size(); i++)
+			{
+				const float distanceSqr = b2DistanceSquared(bucket[i].Position, center);
+				if (distanceSqr < bestDistanceSqr && accept(bucket[i].Key))
+				{
+					bestDistanceSqr = distanceSqr;
+					key = bucket[i].Key;
+					found = true;
+				}
+			}
+		});
+	}
+
+	if (found)
+	{
+		distance = sqrtf(bestDistanceSqr);
+	}
+	return found;
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "BehaviourTree.h"
+
+//-----------------------------------------------------------------
+// STATIC BEHAVIOUR TREE
+// A behaviour tree whose shape is a type, for trees that are fixed at
+// compile time:
+//
+//   typedef StaticBT::Selector<
+//       StaticBT::Sequence<StaticBT::Condition<&IsHungry>, StaticBT::Action<&Eat>>,
+//       StaticBT::Action<&Wander>> Tree;
+//   StaticBehaviourTree<Tree> tree;
+//   tree.Update(pBlackboard);
+//
+// Every node is a plain member of its parent and leaves call their
+// function through a template argument, so the compiler sees the
+// whole tree at once and can inline the leaves from Behaviours.h:
+// no vtable, no std::function, no pointer chasing.
+//
+// Nodes behave exactly like their runtime counterparts in
+// BehaviourTree.h, including PureConditional memos, the
+// selector/sequence SubtreeFailureMemo and decorator budgets, so a
+// static tree and a runtime tree of the same shape give the same
+// results.
+//-----------------------------------------------------------------
+namespace StaticBT
+{
+	typedef bool(*ConditionalFn)(Blackboard*);
+	typedef BehaviourState(*ActionFn)(Blackboard*);
+
+	namespace Detail
+	{
+		// Children of a composite, unrolled by recursion
+		template<typename... Children>
+		struct ChildList;
+
+		template<>
+		struct ChildList<>
+		{
+			BehaviourState ExecuteSelector(Blackboard*) { return Failure; }
+			BehaviourState ExecuteSequence(Blackboard*) { return Success; }
+		};
+
+		template<typename First, typename... Rest>
+		struct ChildList<First, Rest...>
+		{
+			BehaviourState ExecuteSelector(Blackboard* pBlackBoard)
+			{
+				const BehaviourState state = Head.Execute(pBlackBoard);
+				return state == Failure ? Tail.ExecuteSelector(pBlackBoard) : state;
+			}
+			BehaviourState ExecuteSequence(Blackboard* pBlackBoard)
+			{
+				const BehaviourState state = Head.Execute(pBlackBoard);
+				return state == Success ? Tail.ExecuteSequence(pBlackBoard) : state;
+			}
+
+			First Head;
+			ChildList<Rest...> Tail;
+		};
+
+		template<ConditionalFn fpConditional, int... Dependencies>
+		bool EvaluatePure(Blackboard* pBlackBoard)
+		{
+			// Shares its memo id with runtime nodes calling the same function
+			static const PureConditional s_Pure(fpConditional, { Dependencies... });
+			return s_Pure.Evaluate(pBlackBoard);
+		}
+
+		template<typename Child>
+		class Decorator
+		{
+		public:
+			explicit Decorator(const BehaviourBudget& budget) : m_Budget(budget) {}
+
+			BehaviourState Execute(Blackboard* pBlackBoard)
+			{
+				BehaviourState state;
+				if (m_Budget.Skip(pBlackBoard, state))
+					return state;
+
+				state = m_Child.Execute(pBlackBoard);
+				m_Budget.Record(pBlackBoard, state);
+				return state;
+			}
+
+		private:
+			BehaviourBudget m_Budget;
+			Child m_Child;
+		};
+	}
+
+	//-----------------------------------------------------------------
+	// COMPOSITES
+	//-----------------------------------------------------------------
+	template<typename... Children>
+	class Selector
+	{
+	public:
+		BehaviourState Execute(Blackboard* pBlackBoard)
+		{
+			if (m_FailureMemo.CanSkip(pBlackBoard))
+				return Failure;
+
+			SubtreeReadScope reads(pBlackBoard);
+			return reads.End(m_Children.ExecuteSelector(pBlackBoard), m_FailureMemo);
+		}
+
+	private:
+		Detail::ChildList<Children...> m_Children;
+		SubtreeFailureMemo m_FailureMemo;
+	};
+
+	template<typename... Children>
+	class Sequence
+	{
+	public:
+		BehaviourState Execute(Blackboard* pBlackBoard)
+		{
+			if (m_FailureMemo.CanSkip(pBlackBoard))
+				return Failure;
+
+			SubtreeReadScope reads(pBlackBoard);
+			return reads.End(m_Children.ExecuteSequence(pBlackBoard), m_FailureMemo);
+		}
+
+	private:
+		Detail::ChildList<Children...> m_Children;
+		SubtreeFailureMemo m_FailureMemo;
+	};
+
+	//-----------------------------------------------------------------
+	// DECORATORS
+	// Template arguments can't be floats, so rates and durations are whole numbers
+	//-----------------------------------------------------------------
+	template<int Hz, typename Child>
+	struct Throttle : Detail::Decorator<Child>
+	{
+		Throttle() : Detail::Decorator<Child>(BehaviourBudget(BUDGET_THROTTLE, Hz > 0 ? 1.0f / Hz : 0.0f, 1)) {}
+	};
+
+	template<int Milliseconds, typename Child>
+	struct Cooldown : Detail::Decorator<Child>
+	{
+		Cooldown() : Detail::Decorator<Child>(BehaviourBudget(BUDGET_COOLDOWN, Milliseconds / 1000.0f, 1)) {}
+	};
+
+	template<uint32_t N, typename Child>
+	struct RunEveryNthTick : Detail::Decorator<Child>
+	{
+		RunEveryNthTick() : Detail::Decorator<Child>(BehaviourBudget(BUDGET_EVERY_NTH_TICK, 0.0f, N > 0 ? N : 1)) {}
+	};
+
+	//-----------------------------------------------------------------
+	// LEAVES
+	//-----------------------------------------------------------------
+	template<ConditionalFn fpConditional>
+	struct Condition
+	{
+		BehaviourState Execute(Blackboard* pBlackBoard) { return fpConditional(pBlackBoard) ? Success : Failure; }
+	};
+
+	template<ConditionalFn fpConditional>
+	struct ConditionInverse
+	{
+		BehaviourState Execute(Blackboard* pBlackBoard) { return fpConditional(pBlackBoard) ? Failure : Success; }
+	};
+
+	// Dependencies are blackboard slot indices, see PureConditional
+	template<ConditionalFn fpConditional, int... Dependencies>
+	struct PureCondition
+	{
+		BehaviourState Execute(Blackboard* pBlackBoard)
+		{
+			return Detail::EvaluatePure<fpConditional, Dependencies...>(pBlackBoard) ? Success : Failure;
+		}
+	};
+
+	template<ConditionalFn fpConditional, int... Dependencies>
+	struct PureConditionInverse
+	{
+		BehaviourState Execute(Blackboard* pBlackBoard)
+		{
+			return Detail::EvaluatePure<fpConditional, Dependencies...>(pBlackBoard) ? Failure : Success;
+		}
+	};
+
+	template<ActionFn fpAction>
+	struct Action
+	{
+		BehaviourState Execute(Blackboard* pBlackBoard) { return fpAction(pBlackBoard); }
+	};
+}
+
+//-----------------------------------------------------------------
+// STATIC BEHAVIOUR TREE (BASE)
+// Holds the node state of one Root tree, ticks like FlatBehaviourTree
+//-----------------------------------------------------------------
+template<typename Root>
+class StaticBehaviourTree final
+{
+public:
+	BehaviourState Update(Blackboard* pBlackBoard)
+	{
+		pBlackBoard->BeginTick();
+		return m_CurrentState = m_Root.Execute(pBlackBoard);
+	}
+
+private:
+	Root m_Root;
+	BehaviourState m_CurrentState = Failure;
+};
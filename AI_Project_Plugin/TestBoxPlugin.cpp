@@ -3,13 +3,50 @@
 
 #include "TestBoxPlugin.h"
 #include "BehaviourTree.h"
+#include "BlackboardKeys.h"
+#include "FlatBehaviourTree.h"
 #include "SteeringBehaviours.h"
 #include "Behaviours.h"
 #include "CombinedSB.h"
 
+// Pointer slots keep pointing at the same container, so the blackboard only
+// sees a change when it's touched. Touching every tick would make every
+// subtree that reads one look dirty, so only touch when the container moved on
+template<typename T>
+static void TouchIfRevised(Blackboard* pBlackboard, BlackboardKey<T> key, unsigned int revision, std::vector<unsigned int>& syncedRevisions)
+{
+	if (syncedRevisions[key.Index] != revision)
+	{
+		syncedRevisions[key.Index] = revision;
+		pBlackboard->Touch(key);
+	}
+}
+
+// Level files and the framework agree to well under this
+static bool SamePoint(const b2Vec2& a, const b2Vec2& b)
+{
+	return b2DistanceSquared(a, b) < 0.01f * 0.01f;
+}
+
+static bool SameWorld(const WorldInfo& a, const WorldInfo& b)
+{
+	return SamePoint(a.Center, b.Center) && SamePoint(a.Dimensions, b.Dimensions);
+}
+
 TestBoxPlugin::TestBoxPlugin():
-	IBehaviourPlugin(GameDebugParams(20, false, false, false, false, 3.0f))
+	IBehaviourPlugin(GameDebugParams(20, false, false, false, false, 3.0f)),
+	m_FrameProfiler({
+		"Enemy decay", "FOV ingestion", "Flee weights", "House cache",
+		"Food pickup", "Health pickup", "Pistol pickup", "Blackboard sync",
+		"Behaviour tree", "Navigation", "Debug draw", "Shooting",
+		"Consumables", "Steering", "Total"
+	})
 {
+	const char* tracePath = getenv("TESTBOX_TRACE");
+	if (tracePath != nullptr)
+	{
+		m_TracePath = tracePath;
+	}
 }
 
 TestBoxPlugin::~TestBoxPlugin()
@@ -20,15 +57,25 @@ TestBoxPlugin::~TestBoxPlugin()
 	}
 	m_BehaviourVec.clear();
 
+	SafeDelete(m_pFlatBehaviourTree);
 	SafeDelete(m_pBehaviourTree);
 }
 
 void TestBoxPlugin::Start()
 {
+	if (!m_TracePath.empty())
+	{
+		m_TraceWriter.Open(m_TracePath, m_LevelPath);
+	}
+
 	AgentInfo agentInfo = AGENT_GetInfo(); //Contains all Agent Parameters, retrieved by copy!
 	WorldInfo worldInfo = WORLD_GetInfo(); //Contains the location of the center of the world and the dimensions
 
-	m_Inventory.resize(INVENTORY_GetCapacity());
+	m_Inventory.Reset(INVENTORY_GetCapacity());
+	m_ItemMetadata.Clear();
+	m_Perception.Clear();
+	m_Timers.Clear();
+	m_HousesDueForRevisit = 0;
 
 	m_StartingHealth = agentInfo.Health;
 	m_StartingEnergy = agentInfo.Energy;
@@ -37,6 +84,38 @@ void TestBoxPlugin::Start()
 	m_SecondsElapsed = 0.0f;
 	m_SecondsSinceNavMeshTargetUpdate = 0.0f;
 
+	m_KnownEntityGrid.Initialize(worldInfo);
+
+	// Plan paths ourselves when we can read the level, saves a framework query every update
+	// The path is only our guess at the level the framework runs; a file with other
+	// bounds is certainly another level, one with other houses is caught in Update
+	m_NavigationGrid.Clear();
+	m_LevelHouses.clear();
+	m_Path.clear();
+	if (!m_LevelPath.empty())
+	{
+		GpplLevel level;
+		if (!level.Open(m_LevelPath))
+		{
+			printf("WARNING: Using the framework's navmesh\n");
+		}
+		else if (!SameWorld(level.GetWorldInfo(), worldInfo))
+		{
+			const WorldInfo levelInfo = level.GetWorldInfo();
+			printf("WARNING: %s is %.1f x %.1f around (%.1f, %.1f), the framework's world is %.1f x %.1f around (%.1f, %.1f). Using the framework's navmesh\n",
+				m_LevelPath.c_str(), levelInfo.Dimensions.x, levelInfo.Dimensions.y, levelInfo.Center.x, levelInfo.Center.y,
+				worldInfo.Dimensions.x, worldInfo.Dimensions.y, worldInfo.Center.x, worldInfo.Center.y);
+		}
+		else
+		{
+			m_NavigationGrid.Build(level);
+			for (const GpplHouse& house : level.GetHouses())
+			{
+				m_LevelHouses.push_back(house.Info);
+			}
+		}
+	}
+
 	const b2Vec2 minWorldCoords = worldInfo.Center - worldInfo.Dimensions / 2.0f;
 	const b2Vec2 maxWorldCoords = worldInfo.Center + worldInfo.Dimensions / 2.0f;
 
@@ -62,7 +141,7 @@ void TestBoxPlugin::Start()
 	firstGoal.Position = m_SearchPoints[0];
 	m_Goal = firstGoal;
 	m_GoalSet = true;
-	m_NextNavMeshGoal = NAVMESH_GetClosestPathPoint(m_Goal.Position);
+	m_NextNavMeshGoal = NextPathPoint(agentInfo.Position, m_Goal.Position);
 
 	// Steering behaviours
 	auto pSeekBehaviour = new SteeringBehaviours::Seek();
@@ -83,140 +162,99 @@ void TestBoxPlugin::Start()
 	m_EmptyTargetEnemy = {};
 	m_EmptyTargetEnemy.enemyInfo.EnemyHash = -1; 
 	
-	Blackboard* pBlackboard = new Blackboard;
-	pBlackboard->AddData("AgentInfo", &agentInfo);
-	pBlackboard->AddData("Goal", m_Goal);
-	pBlackboard->AddData("GoalSet", m_GoalSet);
-	pBlackboard->AddData("NextNavMeshGoal", m_NextNavMeshGoal);
-	pBlackboard->AddData("SearchPoints", &m_SearchPoints);
-	pBlackboard->AddData("SearchPointIndex", m_SearchPointIndex);
-	pBlackboard->AddData("TargetEnemy", m_EmptyTargetEnemy);
-	pBlackboard->AddData("Inventory", &m_Inventory);
-	pBlackboard->AddData("MaxHealth", agentInfo.Health);
-	pBlackboard->AddData("MaxEnergy", agentInfo.Energy);
-	pBlackboard->AddData("KnownItems", &m_KnownItems);
-	pBlackboard->AddData("KnownHealthPacks", &m_KnownHealthPacks);
-	pBlackboard->AddData("KnownFoodItems", &m_KnownFoodItems);
-	pBlackboard->AddData("KnownPistols", &m_KnownPistols);
-	pBlackboard->AddData("KnownEnemies", &m_KnownEnemies);
-	pBlackboard->AddData("KnownHouses", &m_KnownHouses);
-	pBlackboard->AddData("NextHouseIndex", m_NextHouseIndex);
-	pBlackboard->AddData("SecondsBetweenHouseRevisits", m_SecondsBetweenHouseRevisits);
-	pBlackboard->AddData("InsideHouseIndex", m_InHouseIndex);
-	pBlackboard->AddData("LongestPistolRange", 0.0f);
+	Blackboard* pBlackboard = new Blackboard(BBKeys::Count);
+	pBlackboard->AddData(BBKeys::AgentInfo, &agentInfo);
+	pBlackboard->AddData(BBKeys::Goal, m_Goal);
+	pBlackboard->AddData(BBKeys::GoalSet, m_GoalSet);
+	pBlackboard->AddData(BBKeys::NextNavMeshGoal, m_NextNavMeshGoal);
+	pBlackboard->AddData(BBKeys::SearchPoints, &m_SearchPoints);
+	pBlackboard->AddData(BBKeys::SearchPointIndex, m_SearchPointIndex);
+	pBlackboard->AddData(BBKeys::TargetEnemy, m_EmptyTargetEnemy);
+	pBlackboard->AddData(BBKeys::Inventory, &m_Inventory);
+	pBlackboard->AddData(BBKeys::MaxHealth, agentInfo.Health);
+	pBlackboard->AddData(BBKeys::MaxEnergy, agentInfo.Energy);
+	pBlackboard->AddData(BBKeys::KnownItems, &m_KnownItems);
+	pBlackboard->AddData(BBKeys::KnownHealthPacks, &m_KnownHealthPacks);
+	pBlackboard->AddData(BBKeys::KnownFoodItems, &m_KnownFoodItems);
+	pBlackboard->AddData(BBKeys::KnownPistols, &m_KnownPistols);
+	pBlackboard->AddData(BBKeys::KnownEnemies, &m_KnownEnemies);
+	pBlackboard->AddData(BBKeys::KnownHouses, &m_KnownHouses);
+	pBlackboard->AddData(BBKeys::NextHouseIndex, m_NextHouseIndex);
+	pBlackboard->AddData(BBKeys::SecondsBetweenHouseRevisits, m_SecondsBetweenHouseRevisits);
+	pBlackboard->AddData(BBKeys::InsideHouseIndex, m_InHouseIndex);
+	pBlackboard->AddData(BBKeys::HousesDueForRevisit, m_HousesDueForRevisit);
+	pBlackboard->AddData(BBKeys::LongestPistolRange, 0.0f);
+	pBlackboard->AddData(BBKeys::KnownEntityGrid, &m_KnownEntityGrid);
+	pBlackboard->AddData(BBKeys::NearestEnemy, NearestEnemyQuery{ false, FLT_MAX, m_EmptyTargetEnemy });
 
 	// Flags that behaviours can set to send info back to this class
-	pBlackboard->AddData("UseHealthItem", false);
-	pBlackboard->AddData("UseFoodItem", false);
-
-	m_pBehaviourTree = new BehaviourTree(pBlackboard,
-	new BehaviourSelector
-	({
-		new BehaviourSequence // Set GOAL to false upon arrival
-		({
-			new BehaviourConditional(IsGoalSet),
-			new BehaviourConditional(HasReachedGoal),
-			new BehaviourAction(SetGoalSetFalse)
-		}),
-		new BehaviourSequence // Update SEARCH POINT INDEX
-		({
-			new BehaviourConditionalInverse(MapSearchedEntirely),
-			new BehaviourConditional(ArrivedAtNextSearchPoint),
-			new BehaviourAction(IncrementSearchPoint)
-		}),
-		new BehaviourSequence // Use FOOD
-		({
-			new BehaviourConditional(NotMaxEnergy),
-			new BehaviourConditional(HasFoodItem),
-			new BehaviourAction(UseFoodItem)
-		}),
-		new BehaviourSequence // Use HEALTH
-		({
-			new BehaviourConditional(NotMaxHealth),
-			new BehaviourConditional(HasHealthItem),
-			new BehaviourAction(UseHealthItem)
-		}),
-		new BehaviourSequence // Grab nearby ITEMS
-		({
-			new BehaviourConditional(HaveInventorySpace),
-			new BehaviourConditional(KnowOfItemsOnGround),
-			new BehaviourAction(SetNearestItemInRangeAsGoal)
-		}),
-		new BehaviourSequence // Find ITEMS (even with no inventory space, we can trade things out)
-		({
-			new BehaviourConditional(LowEnergyOrHealth),
-			new BehaviourConditional(KnowOfItemsOnGround),
-			new BehaviourAction(SetNearestItemInRangeAsGoal)
-		}),
-		new BehaviourSequence // Explore unexplored HOUSES
-		({
-			new BehaviourConditional(KnowOfUnexploredHouse),
-			new BehaviourAction(SetGoalToNearestUnexploredHouse)
-		}),
-		new BehaviourSequence // Shoot ENEMIES
-		({
-			new BehaviourConditional(HasLoadedPistol),
-			new BehaviourConditional(HasEnemyInRange),
-			new BehaviourConditional(HasEnemyInFOV),
-			new BehaviourAction(AimAtNearestEnemyInFOV)
-		}),
-		new BehaviourSequence // Search entire map
-		({
-			new BehaviourConditionalInverse(MapSearchedEntirely),
-			new BehaviourAction(SetGoalToNextSearchPoint)
-		}),
-		new BehaviourConditionalInverse(MapSearchedEntirely), // Don't go any further if map hasn't been fully searched
-		new BehaviourConditional(IsGoalSet), // Don't go any further if a goal is set
-		new BehaviourSequence // Increment NEXT HOUSE index
-		({
-			new BehaviourConditional(CurrentlyInsideNextHouse),
-			new BehaviourAction(IncrementNextHouseIndex),
-			new BehaviourAction(SetGoalToNextHouse)
-		}),
-		new BehaviourSequence // If there's no goal set, move on to the next house (there should always be a goal set)
-		({
-			new BehaviourConditionalInverse(IsGoalSet),
-			new BehaviourAction(SetGoalToNextHouse)
-		})
-	}));
+	pBlackboard->AddData(BBKeys::UseHealthItem, false);
+	pBlackboard->AddData(BBKeys::UseFoodItem, false);
+	m_SyncedRevisions.assign(BBKeys::Count, 0);
+
+	BehaviourNodeArena* pNodeArena = new BehaviourNodeArena();
+	m_pBehaviourTree = new BehaviourTree(pBlackboard, pNodeArena, CreateTestBoxBehaviourTree(*pNodeArena));
+	m_pFlatBehaviourTree = new FlatBehaviourTree(m_pBehaviourTree->GetRoot());
+	if (m_pFlatBehaviourTree->GetOpaqueNodeCount() > 0)
+	{
+		printf("WARNING: %i behaviour tree nodes couldn't be flattened\n", m_pFlatBehaviourTree->GetOpaqueNodeCount());
+	}
 }
 
 PluginOutput TestBoxPlugin::Update(float dt)
 {
+	m_TraceWriter.BeginTick(dt);
+	ScopedFrameTimer frameTimer(m_FrameProfiler, PHASE_TOTAL);
+	m_FrameArena.Reset();
+
 	m_SecondsElapsed += dt;
 
+	m_FrameProfiler.BeginPhase(PHASE_ENEMY_DECAY);
 	AgentInfo agentInfo = AGENT_GetInfo(); // Contains all Agent Parameters, retrieved by copy!
 
-	if (!m_KnownEnemies.empty())
+	// House revisits wait until we know which house we're in, see below
+	m_KnownEnemies.Advance(m_SecondsElapsed);
+	m_FiredTimers.clear();
+	m_Timers.Advance(m_SecondsElapsed, m_FiredTimers);
+	for (const TimerEvent& timer : m_FiredTimers)
 	{
-		auto iter = m_KnownEnemies.begin();
-		while (iter != m_KnownEnemies.end())
-		{
-			iter->InFieldOfView = false;
-			iter->SecondsSinceInsideFOV += dt;
-			iter->PredictedPosition += iter->Velocity * dt;
+		if (timer.Kind != TIMER_ENEMY_EXPIRY) continue;
 
-			if (iter->SecondsSinceInsideFOV > m_SecondsToEstimateEnemyPositionsFor)
-			{
-				iter = m_KnownEnemies.erase(iter);
-			}
-			else
-			{
-				++iter;
-			}
+		const int enemyIndex = m_KnownEnemies.IndexOf(timer.Id);
+		if (enemyIndex == -1) continue; // Killed
+
+		if (m_KnownEnemies.GetSecondsUnseen(enemyIndex) > m_SecondsToEstimateEnemyPositionsFor)
+		{
+			m_KnownEnemies.Remove(timer.Id);
+			m_KnownEntityGrid.Remove(SPATIAL_ENEMY, timer.Id);
+		}
+		else
+		{
+			// Seen again since the timer was set
+			m_KnownEnemies.SetExpiryTimer(enemyIndex,
+				m_Timers.Schedule(m_KnownEnemies.GetLastSeenTime(enemyIndex) + m_SecondsToEstimateEnemyPositionsFor, timer));
 		}
 	}
 
-	std::vector<Enemy> enemiesInFOV;
-	std::vector<Food> foodInFOV;
-	std::vector<HealthPack> healthPacksInFOV;
-	std::vector<Pistol> pistolsInFOV;
-
-	// Add new found entities to world cache
-	std::vector<EntityInfo> entitiesInFOV = FOV_GetEntities();
-	for (auto iter = entitiesInFOV.begin(); iter != entitiesInFOV.end(); ++iter)
+	m_FrameProfiler.BeginPhase(PHASE_FOV_INGESTION);
+	// Add new found entities to world cache. Only entities that entered or moved since
+	// last tick, or that are within reach, need looking at, see FovDelta
+	m_Perception.Update(FOV_GetEntities());
+	FovDelta& fovDelta = m_Perception.GetFov();
+	const std::vector<EntityInfo>& entitiesInFOV = fovDelta.GetEntities();
+
+	// Per tick scratch, nothing in here outlives this Update
+	ArenaVector<Enemy> enemiesInFOV(m_FrameArena);
+	ArenaVector<Food> foodInFOV(m_FrameArena);
+	ArenaVector<HealthPack> healthPacksInFOV(m_FrameArena);
+	ArenaVector<Pistol> pistolsInFOV(m_FrameArena);
+	enemiesInFOV.reserve(entitiesInFOV.size());
+	foodInFOV.reserve(entitiesInFOV.size());
+	healthPacksInFOV.reserve(entitiesInFOV.size());
+	pistolsInFOV.reserve(entitiesInFOV.size());
+	for (size_t i = 0; i < entitiesInFOV.size(); i++)
 	{
-		EntityInfo& entityInfo = *iter;
+		const EntityInfo& entityInfo = entitiesInFOV[i];
 
 		switch (entityInfo.Type)
 		{
@@ -226,7 +264,13 @@ PluginOutput TestBoxPlugin::Update(float dt)
 
 			// Use smaller grab range because sometimes it doesn't think you're in it
 			const float grabRangeSqr = (agentInfo.GrabRange * 0.75f) * (agentInfo.GrabRange * 0.75f);
-			if (b2DistanceSquared(entityInfo.Position, agentInfo.Position) < grabRangeSqr)
+			const bool inGrabRange = b2DistanceSquared(entityInfo.Position, agentInfo.Position) < grabRangeSqr;
+
+			// Out of reach and already in m_KnownItems since it last moved
+			if (!inGrabRange && fovDelta.IsSettled(i))
+				break;
+
+			if (inGrabRange)
 			{
 				ItemInfo itemInfo = {};
 				ITEM_Grab(entityInfo, itemInfo);
@@ -251,7 +295,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 						int firstFreeInventorySlot = FirstEmptyInventorySlotID();
 						if (firstFreeInventorySlot != -1)
 						{
-							AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo);
+							AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo, 0.0f);
 							RemoveItemFromInventory(firstFreeInventorySlot);
 							DEBUG_LogMessage("Disposing of useless pistol\n");
 						}
@@ -275,7 +319,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 						int firstFreeInventorySlot = FirstEmptyInventorySlotID();
 						if (firstFreeInventorySlot != -1)
 						{
-							AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo);
+							AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo, 0.0f);
 							RemoveItemFromInventory(firstFreeInventorySlot);
 							DEBUG_LogMessage("Disposing of useless health pack\n");
 						}
@@ -299,7 +343,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 						int firstFreeInventorySlot = FirstEmptyInventorySlotID();
 						if (firstFreeInventorySlot != -1)
 						{
-							AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo);
+							AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo, 0.0f);
 							RemoveItemFromInventory(firstFreeInventorySlot);
 							DEBUG_LogMessage("Disposing of useless food\n");
 						}
@@ -312,7 +356,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 					{
 						// If we have a space for it, pick up garbage then remvoe it
 						// To get rid of the distraction
-						AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo);
+						AddItemToInventory(firstFreeInventorySlot, entityInfo, itemInfo, 0.0f);
 						RemoveItemFromInventory(firstFreeInventorySlot);
 						DEBUG_LogMessage("Disposing of garbage\n");
 					}
@@ -333,11 +377,12 @@ PluginOutput TestBoxPlugin::Update(float dt)
 
 			if (!addedToList)
 			{
-				if (!Contains(m_KnownItems, entityInfo))
+				if (m_KnownItems.Add(entityInfo.EntityHash, entityInfo))
 				{
-					m_KnownItems.push_back(entityInfo);
+					m_KnownEntityGrid.Insert(SPATIAL_ITEM, entityInfo.EntityHash, entityInfo.Position);
 				}
 			}
+			fovDelta.SetSettled(i, !inGrabRange);
 		} break;
 		case eEntityType::ENEMY:
 		{
@@ -345,25 +390,15 @@ PluginOutput TestBoxPlugin::Update(float dt)
 			ConstructEnemy(entityInfo, entityInfo.Position, enemy);
 			enemiesInFOV.push_back(enemy);
 
-			std::vector<Enemy>::iterator iter = IndexOf(m_KnownEnemies, enemy);
-			if (iter == m_KnownEnemies.end())
+			if (m_KnownEnemies.Observe(entityInfo, enemy.enemyInfo))
 			{
-				m_KnownEnemies.push_back(enemy);
+				m_KnownEntityGrid.Insert(SPATIAL_ENEMY, enemy.enemyInfo.EnemyHash, enemy.Position);
+				m_KnownEnemies.SetExpiryTimer(m_KnownEnemies.size() - 1,
+					m_Timers.Schedule(m_SecondsElapsed + m_SecondsToEstimateEnemyPositionsFor, { TIMER_ENEMY_EXPIRY, enemy.enemyInfo.EnemyHash }));
 			}
-			else
+			else if (fovDelta.GetChange(i) != FOV_UNCHANGED)
 			{
-				// We already know about this enemy, update our info on it
-				Enemy& knownEnemy = *iter;
-				b2Vec2 lastPos = knownEnemy.Position;
-				knownEnemy.enemyInfo.Health = enemy.enemyInfo.Health;
-				knownEnemy.Position = entityInfo.Position;
-				knownEnemy.PredictedPosition = entityInfo.Position;
-				knownEnemy.LastPosition = lastPos;
-				knownEnemy.InFieldOfView = true;
-				knownEnemy.SecondsSinceInsideFOV = 0.0f;
-
-				b2Vec2 newVel = entityInfo.Position - lastPos;
-				knownEnemy.Velocity = newVel;
+				m_KnownEntityGrid.Move(SPATIAL_ENEMY, enemy.enemyInfo.EnemyHash, enemy.Position);
 			}
 		} break;
 		default:
@@ -373,24 +408,11 @@ PluginOutput TestBoxPlugin::Update(float dt)
 		}
 	}
 
+	m_FrameProfiler.BeginPhase(PHASE_FLEE_WEIGHTS);
 	if (!m_KnownEnemies.empty())
 	{
 		m_AverageNearbyEnemy.Position = b2Vec2_zero;
-		int nearbyEnemyCount = 0;
-		for (auto iter = m_KnownEnemies.begin(); iter != m_KnownEnemies.end(); ++iter)
-		{
-			Enemy& knownEnemy = *iter;
-
-			b2Vec2 enemyPos;
-			if (knownEnemy.InFieldOfView) enemyPos = knownEnemy.Position;
-			else enemyPos = knownEnemy.PredictedPosition;
-
-			if (b2DistanceSquared(enemyPos, agentInfo.Position) < agentInfo.FOV_Range * agentInfo.FOV_Range)
-			{
-				++nearbyEnemyCount;
-				m_AverageNearbyEnemy.Position += enemyPos;
-			}
-		}
+		const int nearbyEnemyCount = m_KnownEnemies.SumPositionsWithin(agentInfo.Position, agentInfo.FOV_Range, m_AverageNearbyEnemy.Position);
 
 		if (nearbyEnemyCount > 0)
 		{
@@ -408,6 +430,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 	}
 
 	// Add new newly found houses to cache
+	m_FrameProfiler.BeginPhase(PHASE_HOUSE_CACHE);
 	std::vector<HouseInfo> housesInFOV = FOV_GetHouses();
 	for (size_t i = 0; i < housesInFOV.size(); i++)
 	{
@@ -416,23 +439,46 @@ PluginOutput TestBoxPlugin::Update(float dt)
 
 		if (!Contains(m_KnownHouses, house))
 		{
+			CheckHouseAgainstLevel(housesInFOV[i]);
 			m_KnownHouses.push_back(house);
+			++m_KnownHousesRevision;
+			++m_HousesDueForRevisit;
 		}
 	}
 
 	DetermineInHouseIndex(agentInfo.Position);
+	// A house's revisit timer starts once it stops being due, being inside
+	// only moves LastVisitTime, the timer catches up when it fires
 	if (m_InHouseIndex != -1) 
 	{
-		m_KnownHouses[m_InHouseIndex].SecondsSinceLastVisit = 0.0f;
+		House& house = m_KnownHouses[m_InHouseIndex];
+		house.LastVisitTime = m_SecondsElapsed;
+		if (house.DueForRevisit)
+		{
+			house.DueForRevisit = false;
+			--m_HousesDueForRevisit;
+			++m_KnownHousesRevision;
+			m_Timers.Schedule(m_SecondsElapsed + m_SecondsBetweenHouseRevisits, { TIMER_HOUSE_REVISIT, m_InHouseIndex });
+		}
 	}
-	for (size_t i = 0; i < m_KnownHouses.size(); i++)
+	for (const TimerEvent& timer : m_FiredTimers)
 	{
-		if (m_InHouseIndex != i)
+		if (timer.Kind != TIMER_HOUSE_REVISIT) continue;
+
+		House& house = m_KnownHouses[timer.Id];
+		if (m_SecondsElapsed - house.LastVisitTime >= m_SecondsBetweenHouseRevisits)
+		{
+			house.DueForRevisit = true;
+			++m_HousesDueForRevisit;
+			++m_KnownHousesRevision;
+		}
+		else
 		{
-			m_KnownHouses[i].SecondsSinceLastVisit += dt;
+			m_Timers.Schedule(house.LastVisitTime + m_SecondsBetweenHouseRevisits, timer);
 		}
 	}
 
+	m_FrameProfiler.BeginPhase(PHASE_FOOD_PICKUP);
 	if (!foodInFOV.empty())
 	{
 		auto iter = foodInFOV.begin();
@@ -468,7 +514,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 
 				if (firstEmptyInventorySlot != -1)
 				{
-					AddItemToInventory(firstEmptyInventorySlot, food.EntityInfo, food.ItemInfo);
+					AddItemToInventory(firstEmptyInventorySlot, food.EntityInfo, food.ItemInfo, (float)food.EnergyAmount);
 					iter = foodInFOV.erase(iter);
 				}
 			}
@@ -482,17 +528,20 @@ PluginOutput TestBoxPlugin::Update(float dt)
 	// If still not empty, we aren't picking them all up. Cache for later
 	for (size_t i = 0; i < foodInFOV.size(); i++)
 	{
-		if (Contains(m_KnownFoodItems, foodInFOV[i]))
+		Food* pKnownFood = m_KnownFoodItems.Find(foodInFOV[i].EntityInfo.EntityHash);
+		if (pKnownFood != nullptr)
 		{
-			m_KnownFoodItems[i].Fresh = true;
+			pKnownFood->Fresh = true;
 		}
 		else
 		{
-			m_KnownFoodItems.push_back(foodInFOV[i]);
-			RemoveFromKnownItems(healthPacksInFOV[i].EntityInfo);
+			m_KnownFoodItems.Add(foodInFOV[i].EntityInfo.EntityHash, foodInFOV[i]);
+			m_KnownEntityGrid.Insert(SPATIAL_FOOD, foodInFOV[i].EntityInfo.EntityHash, foodInFOV[i].Position);
+			RemoveFromKnownItems(foodInFOV[i].EntityInfo);
 		}
 	}
 
+	m_FrameProfiler.BeginPhase(PHASE_HEALTH_PICKUP);
 	if (!healthPacksInFOV.empty())
 	{
 		auto iter = healthPacksInFOV.begin();
@@ -538,7 +587,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 
 				if (firstEmptyInventorySlot != -1)
 				{
-					AddItemToInventory(firstEmptyInventorySlot, healthPack.EntityInfo, healthPack.ItemInfo);
+					AddItemToInventory(firstEmptyInventorySlot, healthPack.EntityInfo, healthPack.ItemInfo, (float)healthPack.HealingAmount);
 					iter = healthPacksInFOV.erase(iter);
 				}
 			}
@@ -552,17 +601,20 @@ PluginOutput TestBoxPlugin::Update(float dt)
 	// If still not empty, we aren't picking them all up. Cache for later
 	for (size_t i = 0; i < healthPacksInFOV.size(); i++)
 	{
-		if (Contains(m_KnownHealthPacks, healthPacksInFOV[i]))
+		HealthPack* pKnownHealthPack = m_KnownHealthPacks.Find(healthPacksInFOV[i].EntityInfo.EntityHash);
+		if (pKnownHealthPack != nullptr)
 		{
-			m_KnownHealthPacks[i].Fresh = true;
+			pKnownHealthPack->Fresh = true;
 		}
 		else
 		{
-			m_KnownHealthPacks.push_back(healthPacksInFOV[i]);
+			m_KnownHealthPacks.Add(healthPacksInFOV[i].EntityInfo.EntityHash, healthPacksInFOV[i]);
+			m_KnownEntityGrid.Insert(SPATIAL_HEALTH, healthPacksInFOV[i].EntityInfo.EntityHash, healthPacksInFOV[i].Position);
 			RemoveFromKnownItems(healthPacksInFOV[i].EntityInfo);
 		}
 	}
 
+	m_FrameProfiler.BeginPhase(PHASE_PISTOL_PICKUP);
 	if (!pistolsInFOV.empty())
 	{
 		Pistol bestPistol = {};
@@ -597,7 +649,7 @@ PluginOutput TestBoxPlugin::Update(float dt)
 				RemoveItemFromInventory(m_BestPistolIndex);
 			}
 			m_BestPistolIndex = FirstEmptyInventorySlotID();
-			AddItemToInventory(m_BestPistolIndex, bestPistol.entityInfo, bestPistol.itemInfo);
+			AddItemToInventory(m_BestPistolIndex, bestPistol.entityInfo, bestPistol.itemInfo, bestPistol.GetValue());
 			pistolsInFOV.erase(bestPistolIter);
 
 			if (bestPistol.Range > m_LongestPistolRange)
@@ -611,17 +663,21 @@ PluginOutput TestBoxPlugin::Update(float dt)
 	// If still not empty, we aren't picking them all up. Cache for later
 	for (size_t i = 0; i < pistolsInFOV.size(); i++)
 	{
-		if (Contains(m_KnownPistols, pistolsInFOV[i]))
+		Pistol* pKnownPistol = m_KnownPistols.Find(pistolsInFOV[i].entityInfo.EntityHash);
+		if (pKnownPistol != nullptr)
 		{
-			m_KnownPistols[i].Fresh = true;
+			pKnownPistol->Fresh = true;
 		}
 		else
 		{
-			m_KnownPistols.push_back(pistolsInFOV[i]);
+			m_KnownPistols.Add(pistolsInFOV[i].entityInfo.EntityHash, pistolsInFOV[i]);
+			m_KnownEntityGrid.Insert(SPATIAL_PISTOL, pistolsInFOV[i].entityInfo.EntityHash, pistolsInFOV[i].Position);
+			RemoveFromKnownItems(pistolsInFOV[i].entityInfo);
 		}
 	}
 
 	// Run as soon as we regain all stamina or we are bitten
+	m_FrameProfiler.BeginPhase(PHASE_BLACKBOARD_SYNC);
 	if (agentInfo.Stamina >= (m_StartingStamina - 0.1f) || 
 		(agentInfo.Bitten && agentInfo.Stamina > 1.0f))
 	{
@@ -632,41 +688,49 @@ PluginOutput TestBoxPlugin::Update(float dt)
 		agentInfo.RunMode = false;
 	}
 
-	// Update blackboard values
+	// Update blackboard values. Only what actually changed gets a new version, see SubtreeFailureMemo
 	Blackboard* pBlackboard = m_pBehaviourTree->GetBlackboard();
-	pBlackboard->ChangeData("AgentInfo", &agentInfo);
-	pBlackboard->ChangeData("Inventory", &m_Inventory);
-	pBlackboard->ChangeData("LongestPistolRange", m_LongestPistolRange);
-	pBlackboard->ChangeData("KnownItems", &m_KnownItems);
-	pBlackboard->ChangeData("KnownHealthPacks", &m_KnownHealthPacks);
-	pBlackboard->ChangeData("KnownFoodItems", &m_KnownFoodItems);
-	pBlackboard->ChangeData("KnownPistols", &m_KnownPistols);
-	pBlackboard->ChangeData("KnownEnemies", &m_KnownEnemies);
-	pBlackboard->ChangeData("KnownHouses", &m_KnownHouses);
-	pBlackboard->ChangeData("InsideHouseIndex", m_InHouseIndex);
-	pBlackboard->ChangeData("TargetEnemy", m_EmptyTargetEnemy);
-
-
-	m_pBehaviourTree->Update();
-
+	pBlackboard->AdvanceTime(dt);
+	pBlackboard->ChangeData(BBKeys::AgentInfo, &agentInfo);
+	TouchIfRevised(pBlackboard, BBKeys::Inventory, m_Inventory.GetRevision(), m_SyncedRevisions);
+	pBlackboard->ChangeDataIfDifferent(BBKeys::LongestPistolRange, m_LongestPistolRange);
+	TouchIfRevised(pBlackboard, BBKeys::KnownItems, m_KnownItems.GetRevision(), m_SyncedRevisions);
+	TouchIfRevised(pBlackboard, BBKeys::KnownHealthPacks, m_KnownHealthPacks.GetRevision(), m_SyncedRevisions);
+	TouchIfRevised(pBlackboard, BBKeys::KnownFoodItems, m_KnownFoodItems.GetRevision(), m_SyncedRevisions);
+	TouchIfRevised(pBlackboard, BBKeys::KnownPistols, m_KnownPistols.GetRevision(), m_SyncedRevisions);
+	TouchIfRevised(pBlackboard, BBKeys::KnownEnemies, m_KnownEnemies.GetRevision(), m_SyncedRevisions);
+	TouchIfRevised(pBlackboard, BBKeys::KnownHouses, m_KnownHousesRevision, m_SyncedRevisions);
+	TouchIfRevised(pBlackboard, BBKeys::KnownEntityGrid, m_KnownEntityGrid.GetRevision(), m_SyncedRevisions);
+	pBlackboard->ChangeDataIfDifferent(BBKeys::InsideHouseIndex, m_InHouseIndex);
+	pBlackboard->ChangeDataIfDifferent(BBKeys::HousesDueForRevisit, m_HousesDueForRevisit);
+	pBlackboard->ChangeDataIfDifferent(BBKeys::TargetEnemy, m_EmptyTargetEnemy);
+
+	// Several behaviours want the nearest enemy, they all read this one answer
+	NearestEnemyQuery nearestEnemy = { false, FLT_MAX, m_EmptyTargetEnemy };
+	nearestEnemy.Found = NearestEnemyInFOV(&m_KnownEntityGrid, &m_KnownEnemies, &agentInfo, nearestEnemy.NearestEnemy, nearestEnemy.Distance);
+	pBlackboard->ChangeDataIfDifferent(BBKeys::NearestEnemy, nearestEnemy);
+
+	m_FrameProfiler.BeginPhase(PHASE_BEHAVIOUR_TREE);
+	m_pFlatBehaviourTree->Update(pBlackboard);
 
 	// Retrieve values from blackboard
+	m_FrameProfiler.BeginPhase(PHASE_NAVIGATION);
 	bool goalWasSet = m_GoalSet;
-	pBlackboard->GetData("GoalSet", m_GoalSet);
+	pBlackboard->GetData(BBKeys::GoalSet, m_GoalSet);
 
 	m_SecondsSinceNavMeshTargetUpdate += dt;
 
 	if (m_GoalSet)
 	{
-		pBlackboard->GetData("Goal", m_Goal);
+		pBlackboard->GetData(BBKeys::Goal, m_Goal);
 		float distSqr = b2DistanceSquared(agentInfo.Position, m_Goal.Position);
 		if (distSqr < 1.0f || 
 			m_GoalSet != goalWasSet || 
 			m_SecondsSinceNavMeshTargetUpdate > m_SecondsBetweenNavMeshTargetUpdates)
 		{
 			m_SecondsSinceNavMeshTargetUpdate = 0.0f;
-			m_NextNavMeshGoal = NAVMESH_GetClosestPathPoint(m_Goal.Position);
-			pBlackboard->ChangeData("NextNavMeshGoal", m_NextNavMeshGoal);
+			m_NextNavMeshGoal = NextPathPoint(agentInfo.Position, m_Goal.Position);
+			pBlackboard->ChangeData(BBKeys::NextNavMeshGoal, m_NextNavMeshGoal);
 		}
 
 		DEBUG_DrawCircle(agentInfo.Position, agentInfo.GrabRange, { 0.0f, 0.0f, 1.0f });
@@ -675,19 +739,24 @@ PluginOutput TestBoxPlugin::Update(float dt)
 		{
 			DEBUG_DrawSolidCircle(m_NextNavMeshGoal.Position, 0.4f, { 0.0f, 0.0f }, { 0.0f, 0.5f, 0.5f });
 		}
+		for (size_t i = m_PathIndex; i + 1 < m_Path.size(); i++)
+		{
+			DEBUG_DrawSegment(m_Path[i], m_Path[i + 1], { 0.0f, 0.5f, 0.5f });
+		}
 	}
 
 	// Draw debuging helpers
+	m_FrameProfiler.BeginPhase(PHASE_DEBUG_DRAW);
 	for (size_t i = 0; i < m_KnownEnemies.size(); i++)
 	{
-		if (!m_KnownEnemies[i].InFieldOfView)
+		if (!m_KnownEnemies.IsInFieldOfViewAt(i))
 		{
-			DEBUG_DrawCircle(m_KnownEnemies[i].PredictedPosition, 1.5f, { 1.0f, 0.1f, 0.1f , 0.1f });
+			DEBUG_DrawCircle(m_KnownEnemies.GetPredictedPosition(i), 1.5f, { 1.0f, 0.1f, 0.1f , 0.1f });
 		}
 	}
 
-	pBlackboard->GetData("NextHouseIndex", m_NextHouseIndex);
-	pBlackboard->GetData("SearchPointIndex", m_SearchPointIndex);
+	pBlackboard->GetData(BBKeys::NextHouseIndex, m_NextHouseIndex);
+	pBlackboard->GetData(BBKeys::SearchPointIndex, m_SearchPointIndex);
 
 	for (size_t i = 0; i < m_KnownHouses.size(); i++)
 	{
@@ -740,11 +809,12 @@ PluginOutput TestBoxPlugin::Update(float dt)
 		DEBUG_DrawCircle(m_KnownItems[i].Position, 1.0f, { 1.0f, 1.0f, 0.92f });
 	}
 
+	m_FrameProfiler.BeginPhase(PHASE_SHOOTING);
 	float angularSteering = 0.0f;
 	bool overrideAutoOrient = true;
 
 	Enemy targetEnemy;
-	pBlackboard->GetData("TargetEnemy", targetEnemy);
+	pBlackboard->GetData(BBKeys::TargetEnemy, targetEnemy);
 	if (targetEnemy.enemyInfo.EnemyHash != m_EmptyTargetEnemy.enemyInfo.EnemyHash)
 	{
 		overrideAutoOrient = false;
@@ -768,40 +838,19 @@ PluginOutput TestBoxPlugin::Update(float dt)
 		{
 			DEBUG_LogMessage("----Shooting pistol\n");
 			UseItemInInventory(m_BestPistolIndex);
+			m_Perception.Invalidate();
 
 			// Check if you killed em (true unless they are still in front of us)
-			bool enemyKilled = true;
-			auto entitiesInFOVUpdated = FOV_GetEntities();
-			for (size_t i = 0; i < entitiesInFOVUpdated.size(); i++)
-			{
-				if (entitiesInFOVUpdated[i].Type == eEntityType::ENEMY)
-				{
-					Enemy enemyInFOV;
-					ConstructEnemy(entitiesInFOVUpdated[i], {}, enemyInFOV);
-					if (enemyInFOV.enemyInfo.EnemyHash == targetEnemy.enemyInfo.EnemyHash)
-					{
-						enemyKilled = false;
-						break;
-					}
-				}
-			}
+			const bool enemyKilled = !IsEntityVisible(targetEnemy.entityInfo.EntityHash);
 
 			if (enemyKilled)
 			{
 				DEBUG_LogMessage("----Killed enemy!\n");
-				auto iter = m_KnownEnemies.begin();
-				while (iter != m_KnownEnemies.end())
-				{
-					if (iter->enemyInfo.EnemyHash == targetEnemy.enemyInfo.EnemyHash)
-					{
-						m_KnownEnemies.erase(iter);
-						break;
-					}
-					else
-					{
-						++iter;
-					}
-				}
+				// Its hash could come back on a new enemy, which gets its own timer
+				const int enemyIndex = m_KnownEnemies.IndexOf(targetEnemy.enemyInfo.EnemyHash);
+				if (enemyIndex != -1) m_Timers.Cancel(m_KnownEnemies.GetExpiryTimer(enemyIndex));
+				m_KnownEnemies.Remove(targetEnemy.enemyInfo.EnemyHash);
+				m_KnownEntityGrid.Remove(SPATIAL_ENEMY, targetEnemy.enemyInfo.EnemyHash);
 			}
 
 			Item item = GetItemFromInventory(m_BestPistolIndex);
@@ -811,70 +860,41 @@ PluginOutput TestBoxPlugin::Update(float dt)
 			{
 				RemoveItemFromInventory(m_BestPistolIndex);
 
-				m_BestPistolIndex = -1;
-				float bestValue = 0.0f;
-				int bestPistolIndex = -1;
-				// Check for other pistols to put in this slot
-				for (size_t i = 1; i < m_Inventory.size(); i++)
+				// Switch to the best other pistol, or -1 if no (useful) pistols remain
+				m_BestPistolIndex = m_Inventory.GetBestSlot(eItemType::PISTOL);
+				if (m_BestPistolIndex != -1 && m_Inventory.GetValue(m_BestPistolIndex) <= 0.0f)
 				{
-					if (m_Inventory[i].ItemInfo.Type == eItemType::PISTOL)
-					{
-						Pistol pistol = {};
-						ConstructPistol(m_Inventory[i].EntityInfo, m_Inventory[i].ItemInfo, {}, pistol);
-						const float value = pistol.GetValue();
-						if (value > bestValue)
-						{
-							bestValue = value;
-							bestPistolIndex = i;
-						}
-					}
+					m_BestPistolIndex = -1;
 				}
 
-				// Set to best pistol index, or -1 if no pistols remain
-				m_BestPistolIndex = bestPistolIndex;
-
 				if (m_BestPistolIndex == -1)
 				{
 					m_LongestPistolRangeInventoryIndex = -1;
 					m_LongestPistolRange = 0.0f;
-					pBlackboard->ChangeData("LongestPistolRange", 0.0f);
+					pBlackboard->ChangeData(BBKeys::LongestPistolRange, 0.0f);
 				}
 			}
+			else
+			{
+				m_Inventory.SetValue(m_BestPistolIndex, pistol.GetValue());
+			}
 		}
 	}
 
-
+	m_FrameProfiler.BeginPhase(PHASE_CONSUMABLES);
 	bool useHealthItem = false;
-	pBlackboard->GetData("UseHealthItem", useHealthItem);
+	pBlackboard->GetData(BBKeys::UseHealthItem, useHealthItem);
 	if (useHealthItem)
 	{
-		pBlackboard->ChangeData("UseHealthItem", false);
+		pBlackboard->ChangeData(BBKeys::UseHealthItem, false);
 		int healingNeeded = (int)(m_StartingHealth - agentInfo.Health);
 		if (healingNeeded > 0)
 		{
-			HealthPack bestHealthPack = {};
-			int bestHealthPackIndex = -1;
-
-			for (size_t i = 0; i < m_Inventory.size(); i++)
+			// Don't use packs that have more healing than we need
+			const int bestHealthPackIndex = m_Inventory.GetBestSlot(eItemType::HEALTH, (float)healingNeeded);
+			if (bestHealthPackIndex != -1 && m_Inventory.GetValue(bestHealthPackIndex) > 0.0f)
 			{
-				if (m_Inventory[i].Valid && m_Inventory[i].ItemInfo.Type == eItemType::HEALTH)
-				{
-					HealthPack pack;
-					ConstructHealthPack(m_Inventory[i].EntityInfo, m_Inventory[i].ItemInfo, {}, pack);
-
-					// Don't use packs that have more healing than we need
-					if (pack.HealingAmount <= healingNeeded &&
-						pack.HealingAmount > bestHealthPack.HealingAmount)
-					{
-						bestHealthPack = pack;
-						bestHealthPackIndex = i;
-					}
-				}
-			}
-
-			if (bestHealthPackIndex != -1)
-			{
-				DEBUG_LogMessage("----Using health pack (%i)\n", bestHealthPack.HealingAmount);
+				DEBUG_LogMessage("----Using health pack (%i)\n", (int)m_Inventory.GetValue(bestHealthPackIndex));
 				UseItemInInventory(bestHealthPackIndex);
 				RemoveItemFromInventory(bestHealthPackIndex);
 			}
@@ -882,46 +902,27 @@ PluginOutput TestBoxPlugin::Update(float dt)
 	}
 
 	bool useFoodItem = false;
-	pBlackboard->GetData("UseFoodItem", useFoodItem);
+	pBlackboard->GetData(BBKeys::UseFoodItem, useFoodItem);
 	if (useFoodItem)
 	{
-		pBlackboard->ChangeData("UseFoodItem", false);
+		pBlackboard->ChangeData(BBKeys::UseFoodItem, false);
 		int energyNeeded = (int)(m_StartingEnergy - agentInfo.Energy);
 		if (energyNeeded > 0.0f)
 		{
-			Food bestFood = {};
-			int bestFoodIndex = -1;
-
-			for (size_t i = 0; i < m_Inventory.size(); i++)
+			// Don't eat food that has more energy than we need
+			const int bestFoodIndex = m_Inventory.GetBestSlot(eItemType::FOOD, (float)energyNeeded);
+			if (bestFoodIndex != -1 && m_Inventory.GetValue(bestFoodIndex) > 0.0f)
 			{
-				if (m_Inventory[i].Valid && m_Inventory[i].ItemInfo.Type == eItemType::FOOD)
-				{
-					Food food;
-					ConstructFood(m_Inventory[i].EntityInfo, m_Inventory[i].ItemInfo, {}, food);
-
-					// Don't eat food that has more energy than we need
-					if (food.EnergyAmount <= energyNeeded &&
-						food.EnergyAmount > bestFood.EnergyAmount)
-					{
-						bestFood = food;
-						bestFoodIndex = i;
-					}
-				}
-			}
-
-			if (bestFoodIndex != -1)
-			{
-				DEBUG_LogMessage("----Eating food (%i)\n", bestFood.EnergyAmount);
+				DEBUG_LogMessage("----Eating food (%i)\n", (int)m_Inventory.GetValue(bestFoodIndex));
 				UseItemInInventory(bestFoodIndex);
 				RemoveItemFromInventory(bestFoodIndex);
 			}
 		}
 	}
 
-
+	m_FrameProfiler.BeginPhase(PHASE_STEERING);
 	SteeringOutput steeringOutput = m_pBlendedBehaviour->CalculateSteering(dt, agentInfo);
 
-
 	PluginOutput output = {};
 	output.RunMode = agentInfo.RunMode;
 	output.LinearVelocity = steeringOutput.LinearVelocity;
@@ -941,19 +942,43 @@ PluginOutput TestBoxPlugin::Update(float dt)
 		m_KnownFoodItems[i].Fresh = false;
 	}
 
+	m_TraceWriter.EndTick(output);
+
 	return output;
 }
 
 //Extend the UI [ImGui call only!]
 void TestBoxPlugin::ExtendUI_ImGui()
 {
+	m_FrameProfiler.ExtendUI_ImGui();
+	if (ImGui::Button("Dump frame profile to CSV"))
+	{
+		m_FrameProfiler.DumpToCSV("FrameProfile.csv");
+	}
+	ImGui::Text("Frame arena: %u of %u bytes peak, %u arena heap allocations (last in frame %u of %u)",
+		(unsigned int)m_FrameArena.GetPeakUsed(), (unsigned int)m_FrameArena.GetCapacity(),
+		m_FrameArena.GetArenaHeapAllocationCount(), m_FrameArena.GetLastArenaHeapAllocationFrame(), m_FrameArena.GetFrame());
+
+	if (ImGui::Button(m_pFlatBehaviourTree->IsProfiling() ? "Stop behaviour tree profile" : "Start behaviour tree profile"))
+	{
+		m_pFlatBehaviourTree->SetProfiling(!m_pFlatBehaviourTree->IsProfiling());
+	}
+	if (m_pFlatBehaviourTree->IsProfiling())
+	{
+		m_pFlatBehaviourTree->ExtendUI_ImGui();
+		if (ImGui::Button("Dump behaviour tree profile to CSV"))
+		{
+			m_pFlatBehaviourTree->DumpProfileToCSV("BehaviourTreeProfile.csv");
+		}
+	}
+
 	if (!m_KnownEnemies.empty())
 	{
 		ImGui::Text("Known enemies:");
 		for (size_t i = 0; i < m_KnownEnemies.size(); i++)
 		{
 			ImGui::Text("- Position: (%.2f, %.2f)\n  In FOV: %s",
-				m_KnownEnemies[i].Position.x, m_KnownEnemies[i].Position.y, m_KnownEnemies[i].InFieldOfView ? "true" : "false");
+				m_KnownEnemies.GetPosition(i).x, m_KnownEnemies.GetPosition(i).y, m_KnownEnemies.IsInFieldOfViewAt(i) ? "true" : "false");
 		}
 	}
 	if (!m_KnownFoodItems.empty())
@@ -990,9 +1015,96 @@ void TestBoxPlugin::ExtendUI_ImGui()
 
 void TestBoxPlugin::End()
 {
+	m_TraceWriter.Close();
 }
 
-void TestBoxPlugin::LogOnFail(bool succeeded, const std::string& message)
+#pragma region Recorded framework queries
+AgentInfo TestBoxPlugin::AGENT_GetInfo()
+{
+	AgentInfo agentInfo = IBehaviourPlugin::AGENT_GetInfo();
+	m_TraceWriter.RecordAgentInfo(agentInfo);
+	return agentInfo;
+}
+
+WorldInfo TestBoxPlugin::WORLD_GetInfo()
+{
+	WorldInfo worldInfo = IBehaviourPlugin::WORLD_GetInfo();
+	m_TraceWriter.RecordWorldInfo(worldInfo);
+	return worldInfo;
+}
+
+std::vector<EntityInfo> TestBoxPlugin::FOV_GetEntities()
+{
+	std::vector<EntityInfo> entities = IBehaviourPlugin::FOV_GetEntities();
+	m_TraceWriter.RecordEntities(entities);
+	return entities;
+}
+
+std::vector<HouseInfo> TestBoxPlugin::FOV_GetHouses()
+{
+	std::vector<HouseInfo> houses = IBehaviourPlugin::FOV_GetHouses();
+	m_TraceWriter.RecordHouses(houses);
+	return houses;
+}
+
+bool TestBoxPlugin::ENEMY_GetInfo(EntityInfo entity, EnemyInfo& enemy)
+{
+	const bool found = IBehaviourPlugin::ENEMY_GetInfo(entity, enemy);
+	m_TraceWriter.RecordEnemyInfo(entity, found, enemy);
+	return found;
+}
+
+bool TestBoxPlugin::ITEM_Grab(EntityInfo entity, ItemInfo& item)
+{
+	const bool grabbed = IBehaviourPlugin::ITEM_Grab(entity, item);
+	m_TraceWriter.RecordItemGrab(entity, grabbed, item);
+	return grabbed;
+}
+
+b2Vec2 TestBoxPlugin::NAVMESH_GetClosestPathPoint(b2Vec2 goal)
+{
+	const b2Vec2 pathPoint = IBehaviourPlugin::NAVMESH_GetClosestPathPoint(goal);
+	m_TraceWriter.RecordPathPoint(goal, pathPoint);
+	return pathPoint;
+}
+
+bool TestBoxPlugin::INVENTORY_AddItem(int slotId, ItemInfo item)
+{
+	const bool succeeded = IBehaviourPlugin::INVENTORY_AddItem(slotId, item);
+	m_TraceWriter.RecordInventoryAdd(slotId, item, succeeded);
+	return succeeded;
+}
+
+bool TestBoxPlugin::INVENTORY_UseItem(int slotId)
+{
+	const bool succeeded = IBehaviourPlugin::INVENTORY_UseItem(slotId);
+	m_TraceWriter.RecordInventoryUse(slotId, succeeded);
+	return succeeded;
+}
+
+bool TestBoxPlugin::INVENTORY_RemoveItem(int slotId)
+{
+	const bool succeeded = IBehaviourPlugin::INVENTORY_RemoveItem(slotId);
+	m_TraceWriter.RecordInventoryRemove(slotId, succeeded);
+	return succeeded;
+}
+
+bool TestBoxPlugin::INVENTORY_GetItem(int slotId, ItemInfo& item)
+{
+	const bool succeeded = IBehaviourPlugin::INVENTORY_GetItem(slotId, item);
+	m_TraceWriter.RecordInventoryGet(slotId, succeeded, item);
+	return succeeded;
+}
+
+int TestBoxPlugin::INVENTORY_GetCapacity()
+{
+	const int capacity = IBehaviourPlugin::INVENTORY_GetCapacity();
+	m_TraceWriter.RecordInventoryCapacity(capacity);
+	return capacity;
+}
+#pragma endregion
+
+void TestBoxPlugin::LogOnFail(bool succeeded, const char* message)
 {
 	if (!succeeded)
 	{
@@ -1000,32 +1112,45 @@ void TestBoxPlugin::LogOnFail(bool succeeded, const std::string& message)
 	}
 }
 
-void TestBoxPlugin::AddItemToInventory(int slotID, const EntityInfo& entityInfo, const ItemInfo& itemInfo)
+template<typename T>
+bool TestBoxPlugin::GetCachedItemMetadata(const ItemInfo& itemInfo, eItemMetadata field, T& val)
+{
+	if (m_ItemMetadata.Get(itemInfo.ItemHash, field, val))
+		return true;
+
+	if (!ITEM_GetMetadata(itemInfo, ItemMetadataCategory(field), val))
+		return false;
+
+	m_ItemMetadata.Set(itemInfo.ItemHash, field, val);
+	return true;
+}
+
+void TestBoxPlugin::AddItemToInventory(int slotID, const EntityInfo& entityInfo, const ItemInfo& itemInfo, float value)
 {
-	if (slotID < 0 || slotID >= (int)m_Inventory.size()) return;
+	if (!m_Inventory.IsSlot(slotID)) return;
 
-	if (!m_Inventory[slotID].Valid)
+	if (!m_Inventory.GetSlot(slotID).Valid)
 	{
 		INVENTORY_AddItem(slotID, itemInfo);
-		m_Inventory[slotID].EntityInfo = entityInfo;
-		m_Inventory[slotID].ItemInfo = itemInfo;
-		m_Inventory[slotID].Valid = true;
+		m_Inventory.Add(slotID, entityInfo, itemInfo, value);
 
-		RemoveFromKnownItems(m_Inventory[slotID].EntityInfo);
+		// It's off the ground now, don't go back for it
+		ForgetItem(entityInfo);
 	}
 }
 
 void TestBoxPlugin::RemoveItemFromInventory(int slotID)
 {
-	if (slotID < 0 || slotID >= (int)m_Inventory.size()) return;
+	if (!m_Inventory.IsSlot(slotID)) return;
 
-	if (m_Inventory[slotID].Valid)
+	const Item& item = m_Inventory.GetSlot(slotID);
+	if (item.Valid)
 	{
-		RemoveFromKnownItems(m_Inventory[slotID].EntityInfo);
+		RemoveFromKnownItems(item.EntityInfo);
+		m_ItemMetadata.Remove(item.ItemInfo.ItemHash);
 
 		INVENTORY_RemoveItem(slotID);
-		m_Inventory[slotID].ItemInfo = {};
-		m_Inventory[slotID].Valid = false;
+		m_Inventory.Remove(slotID);
 	}
 }
 
@@ -1034,55 +1159,57 @@ Item TestBoxPlugin::GetItemFromInventory(int slotID)
 	Item invalidItem = {};
 	invalidItem.Valid = false;
 
-	if (slotID < 0 || slotID >= (int)m_Inventory.size()) return invalidItem;
+	if (!m_Inventory.IsSlot(slotID)) return invalidItem;
 
-	if (m_Inventory[slotID].Valid)
+	if (m_Inventory.GetSlot(slotID).Valid)
 	{
 		ItemInfo newInfo;
 		INVENTORY_GetItem(slotID, newInfo);
-
-		m_Inventory[slotID].ItemInfo = newInfo;
+		m_Inventory.Refresh(slotID, newInfo);
 	}
 
-	return m_Inventory[slotID];
+	return m_Inventory.GetSlot(slotID);
 }
 
 void TestBoxPlugin::UseItemInInventory(int slotID)
 {
-	if (slotID < 0 || slotID >= (int)m_Inventory.size()) return;
+	if (!m_Inventory.IsSlot(slotID)) return;
 
-	if (m_Inventory[slotID].Valid)
+	const Item& item = m_Inventory.GetSlot(slotID);
+	if (item.Valid)
 	{
 		INVENTORY_UseItem(slotID);
+		if (item.ItemInfo.Type == eItemType::PISTOL)
+		{
+			m_ItemMetadata.Invalidate(item.ItemInfo.ItemHash, ITEM_METADATA_AMMO);
+		}
 	}
 }
 
-int TestBoxPlugin::InventoryItemCount(eItemType itemType)
+bool TestBoxPlugin::IsEntityVisible(int entityHash)
 {
-	int count = 0;
+	const int index = m_Perception.GetFov().IndexOf(entityHash);
+	if (index == -1) return false;
 
-	for (size_t i = 0; i < m_Inventory.size(); i++)
+	if (!m_Perception.IsVerified(index))
 	{
-		if (m_Inventory[i].ItemInfo.Type == itemType)
+		const EntityInfo& entityInfo = m_Perception.GetEntities()[index];
+		if (entityInfo.Type == eEntityType::ENEMY)
 		{
-			++count;
+			// Nothing moves during Update, so an enemy that's still around is still in view
+			EnemyInfo enemyInfo = {};
+			const bool found = ENEMY_GetInfo(entityInfo, enemyInfo);
+			m_Perception.SetVerified(index, found);
+			if (found) m_Perception.SetEnemyInfo(index, enemyInfo);
 		}
-	}
-
-	return count;
-}
-
-int TestBoxPlugin::InventoryFirstSlotWithItemType(eItemType itemType)
-{
-	for (int i = 0; i < (int)m_Inventory.size(); i++)
-	{
-		if (m_Inventory[i].ItemInfo.Type == itemType)
+		else
 		{
-			return i;
+			// There's no query for single items, take the whole FOV again
+			m_Perception.VerifyAll(FOV_GetEntities());
 		}
 	}
 
-	return -1;
+	return m_Perception.IsVisible(index);
 }
 
 bool TestBoxPlugin::PointInFOV(const b2Vec2& point, const AgentInfo& agentInfo)
@@ -1107,9 +1234,9 @@ void TestBoxPlugin::ConstructPistol(const EntityInfo& entityInfo, const ItemInfo
 {
 	pistol.entityInfo = entityInfo;
 	pistol.itemInfo = itemInfo;
-	LogOnFail(ITEM_GetMetadata(itemInfo, "ammo", pistol.Ammo), "ammo metadata not found on pistol!\n");
-	LogOnFail(ITEM_GetMetadata(itemInfo, "dps", pistol.DPS), "dps metadata not found on pistol!\n");
-	LogOnFail(ITEM_GetMetadata(itemInfo, "range", pistol.Range), "range metadata not found on pistol!\n");
+	LogOnFail(GetCachedItemMetadata(itemInfo, ITEM_METADATA_AMMO, pistol.Ammo), "ammo metadata not found on pistol!\n");
+	LogOnFail(GetCachedItemMetadata(itemInfo, ITEM_METADATA_DPS, pistol.DPS), "dps metadata not found on pistol!\n");
+	LogOnFail(GetCachedItemMetadata(itemInfo, ITEM_METADATA_RANGE, pistol.Range), "range metadata not found on pistol!\n");
 	pistol.Position = Position;
 	pistol.Fresh = true;
 }
@@ -1118,14 +1245,14 @@ void TestBoxPlugin::ConstructHealthPack(const EntityInfo& entityInfo, const Item
 {
 	healthPack.EntityInfo = entityInfo;
 	healthPack.ItemInfo = itemInfo;
-	LogOnFail(ITEM_GetMetadata(itemInfo, "health", healthPack.HealingAmount), "health metadata not found on health!\n");
+	LogOnFail(GetCachedItemMetadata(itemInfo, ITEM_METADATA_HEALTH, healthPack.HealingAmount), "health metadata not found on health!\n");
 	healthPack.Position = Position;
 	healthPack.Fresh = true;
 }
 
 void TestBoxPlugin::ConstructFood(const EntityInfo& entityInfo, const ItemInfo& itemInfo, b2Vec2 Position, Food& food)
 {
-	LogOnFail(ITEM_GetMetadata(itemInfo, "energy", food.EnergyAmount), "energy metadata not found on food!\n");
+	LogOnFail(GetCachedItemMetadata(itemInfo, ITEM_METADATA_ENERGY, food.EnergyAmount), "energy metadata not found on food!\n");
 	food.EntityInfo = entityInfo;
 	food.ItemInfo = itemInfo;
 	food.Position = Position;
@@ -1134,9 +1261,20 @@ void TestBoxPlugin::ConstructFood(const EntityInfo& entityInfo, const ItemInfo&
 
 void TestBoxPlugin::ConstructEnemy(const EntityInfo& entityInfo, b2Vec2 Position, Enemy& enemy)
 {
+	// Enemies in this tick's FOV only get asked about once
 	EnemyInfo enemyInfo = {};
-	ENEMY_GetInfo(entityInfo, enemyInfo);
+	const int index = m_Perception.GetFov().IndexOf(entityInfo.EntityHash);
+	if (index != -1 && m_Perception.HasEnemyInfo(index))
+	{
+		enemyInfo = m_Perception.GetEnemyInfo(index);
+	}
+	else
+	{
+		ENEMY_GetInfo(entityInfo, enemyInfo);
+		if (index != -1) m_Perception.SetEnemyInfo(index, enemyInfo);
+	}
 
+	enemy.entityInfo = entityInfo;
 	enemy.enemyInfo = enemyInfo;
 	enemy.Position = Position;
 	enemy.LastPosition = Position;
@@ -1146,48 +1284,69 @@ void TestBoxPlugin::ConstructEnemy(const EntityInfo& entityInfo, b2Vec2 Position
 void TestBoxPlugin::ConstructHouse(const HouseInfo& houseInfo, House& house)
 {
 	house.Info = houseInfo;
-	house.SecondsSinceLastVisit = m_SecondsBetweenHouseRevisits + 1.0f; // Flag so we know to go in here
+	house.LastVisitTime = 0.0f;
+	house.DueForRevisit = true; // Flag so we know to go in here
 	house.Unexplored = true;
 }
 
-int TestBoxPlugin::FirstEmptyInventorySlotID() const
+void TestBoxPlugin::CheckHouseAgainstLevel(const HouseInfo& houseInfo)
 {
-	for (size_t i = 0; i < m_Inventory.size(); i++)
+	if (!m_NavigationGrid.IsBuilt())
+		return;
+
+	for (const HouseInfo& levelHouse : m_LevelHouses)
 	{
-		if (!m_Inventory[i].Valid)
-		{
-			return i;
-		}
+		if (SamePoint(levelHouse.Center, houseInfo.Center) && SamePoint(levelHouse.Size, houseInfo.Size))
+			return;
 	}
 
-	return -1;
+	printf("WARNING: The framework shows a house at (%.1f, %.1f) that isn't in %s. Using the framework's navmesh\n",
+		houseInfo.Center.x, houseInfo.Center.y, m_LevelPath.c_str());
+	m_NavigationGrid.Clear();
+	m_LevelHouses.clear();
+	m_Path.clear();
 }
 
-int TestBoxPlugin::EmptyInventorySlots() const
+b2Vec2 TestBoxPlugin::NextPathPoint(const b2Vec2& agentPos, const b2Vec2& goal)
 {
-	int emptySlots = 0;
+	if (!m_NavigationGrid.IsBuilt())
+	{
+		return NAVMESH_GetClosestPathPoint(goal);
+	}
 
-	for (size_t i = 0; i < m_Inventory.size(); i++)
+	// Re-plan when the goal changes or something pushed us off the corridor
+	const bool onCorridor = m_PathIndex < m_Path.size() && m_NavigationGrid.IsLineClear(agentPos, m_Path[m_PathIndex]);
+	if (goal != m_PathGoal || !onCorridor)
 	{
-		if (!m_Inventory[i].Valid)
+		m_PathGoal = goal;
+		m_PathIndex = 0;
+		if (!m_NavigationGrid.FindPath(agentPos, goal, m_Path))
 		{
-			++emptySlots;
+			return goal;
 		}
 	}
 
-	return emptySlots;
+	// Skip waypoints we've reached or can already see past
+	while (m_PathIndex + 1 < m_Path.size() &&
+		(b2DistanceSquared(agentPos, m_Path[m_PathIndex]) < 1.0f || m_NavigationGrid.IsLineClear(agentPos, m_Path[m_PathIndex + 1])))
+	{
+		++m_PathIndex;
+	}
+	return m_Path[m_PathIndex];
 }
 
 void TestBoxPlugin::RemoveFromKnownItems(const EntityInfo& entityInfo)
 {
-	for (auto iter = m_KnownItems.begin(); iter != m_KnownItems.end(); ++iter)
-	{
-		if (iter->EntityHash == entityInfo.EntityHash)
-		{
-			iter = m_KnownItems.erase(iter);
-			return;
-		}
-	}
+	m_KnownItems.Remove(entityInfo.EntityHash);
+	m_KnownEntityGrid.Remove(SPATIAL_ITEM, entityInfo.EntityHash);
+}
+
+void TestBoxPlugin::ForgetItem(const EntityInfo& entityInfo)
+{
+	RemoveFromKnownItems(entityInfo);
+	if (m_KnownHealthPacks.Remove(entityInfo.EntityHash)) m_KnownEntityGrid.Remove(SPATIAL_HEALTH, entityInfo.EntityHash);
+	if (m_KnownFoodItems.Remove(entityInfo.EntityHash)) m_KnownEntityGrid.Remove(SPATIAL_FOOD, entityInfo.EntityHash);
+	if (m_KnownPistols.Remove(entityInfo.EntityHash)) m_KnownEntityGrid.Remove(SPATIAL_PISTOL, entityInfo.EntityHash);
 }
 
 void TestBoxPlugin::DetermineInHouseIndex(const b2Vec2& agentPos)
@@ -1196,6 +1355,7 @@ void TestBoxPlugin::DetermineInHouseIndex(const b2Vec2& agentPos)
 	{
 		if (PointInAABB(agentPos, m_KnownHouses[i].Info.Center, m_KnownHouses[i].Info.Size))
 		{
+			if (m_KnownHouses[i].Unexplored) ++m_KnownHousesRevision;
 			m_KnownHouses[i].Unexplored = false;
 			m_InHouseIndex = i;
 			return;
@@ -2,6 +2,17 @@
 
 #include "IBehaviourPlugin.h"
 #include "SteeringBehaviours.h"
+#include "TickTrace.h"
+#include "FrameProfiler.h"
+#include "EnemyTracker.h"
+#include "FrameArena.h"
+#include "InventoryModel.h"
+#include "ItemMetadataCache.h"
+#include "NavigationGrid.h"
+#include "Perception.h"
+#include "SpatialGrid.h"
+#include "TimingWheel.h"
+#include "WorldCache.h"
 
 #include <vector>
 
@@ -10,6 +21,35 @@ namespace CombinedSB
 	class BlendedSteering;
 }
 class BehaviourTree;
+class FlatBehaviourTree;
+
+// Phases of TestBoxPlugin::Update, in the order they run
+enum eUpdatePhase
+{
+	PHASE_ENEMY_DECAY,
+	PHASE_FOV_INGESTION,
+	PHASE_FLEE_WEIGHTS,
+	PHASE_HOUSE_CACHE,
+	PHASE_FOOD_PICKUP,
+	PHASE_HEALTH_PICKUP,
+	PHASE_PISTOL_PICKUP,
+	PHASE_BLACKBOARD_SYNC,
+	PHASE_BEHAVIOUR_TREE,
+	PHASE_NAVIGATION,
+	PHASE_DEBUG_DRAW,
+	PHASE_SHOOTING,
+	PHASE_CONSUMABLES,
+	PHASE_STEERING,
+	PHASE_TOTAL,
+	_PHASE_COUNT
+};
+
+// TimerEvent::Kind of the timers TestBoxPlugin keeps in m_Timers
+enum eTimerKind
+{
+	TIMER_ENEMY_EXPIRY,		// Id is the EnemyHash
+	TIMER_HOUSE_REVISIT		// Id is the index into m_KnownHouses
+};
 
 class TestBoxPlugin : public IBehaviourPlugin
 {
@@ -23,22 +63,70 @@ public:
 	void End() override;
 	//void ProcessEvents(const SDL_Event& e) override;
 
+	// Records every tick from Start to End into a binary trace (see TickTrace.h)
+	// Also enabled by setting the TESTBOX_TRACE environment variable
+	void RecordTrace(const std::string& path) { m_TracePath = path; }
+	// Level to build the local navigation grid from in Start. When it can't be
+	// loaded (or is empty), or turns out not to be the level the framework runs,
+	// paths come from NAVMESH_GetClosestPathPoint instead
+	void SetLevelPath(const std::string& path) { m_LevelPath = path; }
+	// For parameter sweeps, call before Start
+	void SetFleeWeightNearEnemies(float weight) { m_FleeWeightNearEnemies = weight; }
+
+	const FrameProfiler& GetFrameProfiler() const { return m_FrameProfiler; }
+	const FrameArena& GetFrameArena() const { return m_FrameArena; }
+	BehaviourTree* GetBehaviourTree() const { return m_pBehaviourTree; }
+	FlatBehaviourTree* GetFlatBehaviourTree() const { return m_pFlatBehaviourTree; }
+
+	// Framework queries, shadowed so each answer can be written to the trace
+	AgentInfo AGENT_GetInfo();
+	WorldInfo WORLD_GetInfo();
+	std::vector<EntityInfo> FOV_GetEntities();
+	std::vector<HouseInfo> FOV_GetHouses();
+	bool ENEMY_GetInfo(EntityInfo entity, EnemyInfo& enemy);
+	bool ITEM_Grab(EntityInfo entity, ItemInfo& item);
+	b2Vec2 NAVMESH_GetClosestPathPoint(b2Vec2 goal);
+	bool INVENTORY_AddItem(int slotId, ItemInfo item);
+	bool INVENTORY_UseItem(int slotId);
+	bool INVENTORY_RemoveItem(int slotId);
+	bool INVENTORY_GetItem(int slotId, ItemInfo& item);
+	int INVENTORY_GetCapacity();
+
+	template<typename T>
+	bool ITEM_GetMetadata(ItemInfo item, std::string category, T& val)
+	{
+		const bool found = IBehaviourPlugin::ITEM_GetMetadata(item, category, val);
+		m_TraceWriter.RecordItemMetadata(item, category, found, found ? CheapVariant(val) : CheapVariant(0));
+		return found;
+	}
+
 protected:
-	void LogOnFail(bool succeeded, const std::string& message);
+	void LogOnFail(bool succeeded, const char* message);
+	// ITEM_GetMetadata, answered from m_ItemMetadata when it can be
+	template<typename T>
+	bool GetCachedItemMetadata(const ItemInfo& itemInfo, eItemMetadata field, T& val);
 
-	void AddItemToInventory(int slotID, const EntityInfo& entityInfo, const ItemInfo& itemInfo);
+	// value ranks the item among others of its type, see InventoryModel
+	void AddItemToInventory(int slotID, const EntityInfo& entityInfo, const ItemInfo& itemInfo, float value);
 	void RemoveItemFromInventory(int slotID);
 	Item GetItemFromInventory(int slotID);
 	void UseItemInInventory(int slotID);
 
-	int FirstEmptyInventorySlotID() const;
-	int EmptyInventorySlots() const;
-	int InventoryItemCount(eItemType itemType);
-	int InventoryFirstSlotWithItemType(eItemType itemType);
+	int FirstEmptyInventorySlotID() const { return m_Inventory.GetFirstEmptySlot(); }
+	int EmptyInventorySlots() const { return m_Inventory.GetEmptySlotCount(); }
+	int InventoryItemCount(eItemType itemType) const { return m_Inventory.GetCount(itemType); }
+	int InventoryFirstSlotWithItemType(eItemType itemType) const { return m_Inventory.GetFirstSlot(itemType); }
 
 	bool PointInFOV(const b2Vec2& point, const AgentInfo& agentInfo);
+	// Whether the entity was in this tick's FOV and, if the snapshot has been
+	// invalidated since, still is. Asks the framework at most once per Invalidate
+	bool IsEntityVisible(int entityHash);
+	b2Vec2 NextPathPoint(const b2Vec2& agentPos, const b2Vec2& goal);
+	// Drops the navigation grid if the framework shows a house the level file doesn't have
+	void CheckHouseAgainstLevel(const HouseInfo& houseInfo);
 
 	void RemoveFromKnownItems(const EntityInfo& entityInfo);
+	void ForgetItem(const EntityInfo& entityInfo); // Removes the item from every item cache
 	void DetermineInHouseIndex(const b2Vec2& agentPos);
 
 	// Read the appropriate metadata for each item type
@@ -53,11 +141,19 @@ protected:
 	float m_SecondsBetweenNavMeshTargetUpdates = 0.1f;
 	Enemy m_EmptyTargetEnemy;
 
-	BehaviourTree* m_pBehaviourTree = nullptr;
+	BehaviourTree* m_pBehaviourTree = nullptr; // Owns the blackboard and the source nodes
+	FlatBehaviourTree* m_pFlatBehaviourTree = nullptr; // What Update actually ticks
 	SteeringParams m_Goal = {};
 	bool m_GoalSet = false;
 	SteeringParams m_NextNavMeshGoal = {};
 
+	std::string m_LevelPath = "data/LevelOne.gppl"; // The level PluginEntry runs the framework with
+	NavigationGrid m_NavigationGrid;
+	std::vector<HouseInfo> m_LevelHouses; // From m_LevelPath, while m_NavigationGrid is built from it
+	std::vector<b2Vec2> m_Path; // Corridor to m_PathGoal, m_PathIndex is the waypoint we're heading to
+	size_t m_PathIndex = 0;
+	b2Vec2 m_PathGoal = b2Vec2(0.0f, 0.0f);
+
 	std::vector<SteeringBehaviours::ISteeringBehaviour*> m_BehaviourVec = {};
 	SteeringParams m_AverageNearbyEnemy;
 	CombinedSB::BlendedSteering* m_pBlendedBehaviour = nullptr;
@@ -68,7 +164,8 @@ protected:
 	std::vector<b2Vec2> m_SearchPoints;
 	int m_SearchPointIndex;
 
-	std::vector<Item> m_Inventory; // Store this ourselves because the engine yells at us when we ask if a certain slot is full
+	InventoryModel m_Inventory;
+	ItemMetadataCache m_ItemMetadata; // Keyed by ItemHash
 
 	float m_SecondsBetweenHouseRevisits = 90.0f; // How long to wait until visiting a house again
 	float m_SecondsToEstimateEnemyPositionsFor = 4.0f;
@@ -83,11 +180,29 @@ protected:
 	float m_LongestPistolRange = 0.0f;
 	int m_LongestPistolRangeInventoryIndex = -1;
 
+	// Enemy expiry and house revisits, keyed on m_SecondsElapsed. A timer is only a
+	// reminder to check, the handler schedules it again if it came too early
+	TimingWheel m_Timers;
+	std::vector<TimerEvent> m_FiredTimers; // Scratch for TimingWheel::Advance
+
+	PerceptionSnapshot m_Perception; // This tick's FOV and what changed since the last one
+
 	// Cached world vectors
-	std::vector<HealthPack> m_KnownHealthPacks;
-	std::vector<Food> m_KnownFoodItems;
-	std::vector<Pistol> m_KnownPistols;
-	std::vector<EntityInfo> m_KnownItems; // Stores items we've seen in our FOV but we haven't gotten close enough to see their type
-	std::vector<Enemy> m_KnownEnemies;
+	// Item caches are keyed by EntityHash, enemies by EnemyHash
+	WorldCache<HealthPack> m_KnownHealthPacks;
+	WorldCache<Food> m_KnownFoodItems;
+	WorldCache<Pistol> m_KnownPistols;
+	WorldCache<EntityInfo> m_KnownItems; // Stores items we've seen in our FOV but we haven't gotten close enough to see their type
+	EnemyTracker m_KnownEnemies;
 	std::vector<House> m_KnownHouses;
+	unsigned int m_KnownHousesRevision = 0; // Bumped when a house is added, explored or becomes due for a revisit
+	int m_HousesDueForRevisit = 0;
+	SpatialGrid m_KnownEntityGrid; // Positions of everything in the caches above, except houses
+	std::vector<unsigned int> m_SyncedRevisions; // Per blackboard slot, the revision of its pointee when it was last touched
+
+	std::string m_TracePath;
+	TickTraceWriter m_TraceWriter;
+
+	FrameProfiler m_FrameProfiler;
+	FrameArena m_FrameArena; // Reset at the top of every Update
 };
@@ -0,0 +1,532 @@
+#include "stdafx.h"
+
+#include "TickTrace.h"
+
+namespace
+{
+	const char TraceMagic[4] = { 'T', 'B', 'T', 'R' };
+	// Bump whenever the records or the sequence of framework queries TestBoxPlugin makes change,
+	// so older traces are refused instead of diverging part way through
+	const uint32_t TraceVersion = 5;
+	const uint32_t MaxLevelPathLength = 4096;
+	const size_t FlushThreshold = 64 * 1024;
+	const float OutputTolerance = 0.0001f;
+}
+
+//-----------------------------------------------------------------
+// WRITER
+//-----------------------------------------------------------------
+TickTraceWriter::~TickTraceWriter()
+{
+	Close();
+}
+
+bool TickTraceWriter::Open(const std::string& path, const std::string& levelPath)
+{
+	Close();
+
+	m_pFile = fopen(path.c_str(), "wb");
+	if (m_pFile == nullptr)
+	{
+		printf("WARNING: Couldn't open trace file '%s' for writing\n", path.c_str());
+		return false;
+	}
+
+	m_Buffer.reserve(FlushThreshold * 2);
+	m_Buffer.insert(m_Buffer.end(), TraceMagic, TraceMagic + sizeof(TraceMagic));
+	Write(TraceVersion);
+	Write((uint32_t)levelPath.size());
+	m_Buffer.insert(m_Buffer.end(), levelPath.begin(), levelPath.end());
+	return true;
+}
+
+void TickTraceWriter::Close()
+{
+	if (m_pFile != nullptr)
+	{
+		Flush();
+		fclose(m_pFile);
+		m_pFile = nullptr;
+	}
+}
+
+void TickTraceWriter::Flush()
+{
+	if (m_pFile != nullptr && !m_Buffer.empty())
+	{
+		fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_pFile);
+		fflush(m_pFile);
+	}
+	m_Buffer.clear();
+}
+
+void TickTraceWriter::BeginTick(float dt)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::TICK_BEGIN);
+	Write(dt);
+}
+
+void TickTraceWriter::EndTick(const PluginOutput& output)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::TICK_END);
+	WriteVec(output.LinearVelocity);
+	Write(output.AngularVelocity);
+	WriteBool(output.AutoOrientate);
+	WriteBool(output.RunMode);
+
+	// Only whole ticks hit the disk, so a crash leaves a replayable prefix
+	if (m_Buffer.size() >= FlushThreshold)
+	{
+		Flush();
+	}
+}
+
+void TickTraceWriter::RecordAgentInfo(const AgentInfo& agentInfo)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::AGENT_INFO);
+	Write(agentInfo.Stamina);
+	Write(agentInfo.Health);
+	Write(agentInfo.Energy);
+	WriteBool(agentInfo.RunMode);
+	Write(agentInfo.GrabRange);
+	WriteBool(agentInfo.IsInHouse);
+	WriteBool(agentInfo.Bitten);
+	WriteBool(agentInfo.Death);
+	Write(agentInfo.FOV_Angle);
+	Write(agentInfo.FOV_Range);
+	WriteVec(agentInfo.LinearVelocity);
+	Write(agentInfo.AngularVelocity);
+	Write(agentInfo.CurrentLinearSpeed);
+	WriteVec(agentInfo.Position);
+	Write(agentInfo.Orientation);
+	Write(agentInfo.MaxLinearSpeed);
+	Write(agentInfo.MaxAngularSpeed);
+	Write(agentInfo.AgentSize);
+}
+
+void TickTraceWriter::RecordWorldInfo(const WorldInfo& worldInfo)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::WORLD_INFO);
+	WriteVec(worldInfo.Center);
+	WriteVec(worldInfo.Dimensions);
+}
+
+void TickTraceWriter::RecordEntities(const std::vector<EntityInfo>& entities)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::FOV_ENTITIES);
+	Write((uint16_t)entities.size());
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		Write((uint8_t)entities[i].Type);
+		Write((int32_t)entities[i].EntityHash);
+		WriteVec(entities[i].Position);
+	}
+}
+
+void TickTraceWriter::RecordHouses(const std::vector<HouseInfo>& houses)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::FOV_HOUSES);
+	Write((uint16_t)houses.size());
+	for (size_t i = 0; i < houses.size(); i++)
+	{
+		WriteVec(houses[i].Center);
+		WriteVec(houses[i].Size);
+	}
+}
+
+void TickTraceWriter::RecordEnemyInfo(const EntityInfo& entity, bool found, const EnemyInfo& enemy)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::ENEMY_INFO);
+	Write((int32_t)entity.EntityHash);
+	WriteBool(found);
+	Write((int32_t)enemy.EnemyHash);
+	Write((int32_t)enemy.Health);
+}
+
+void TickTraceWriter::RecordItemMetadata(const ItemInfo& item, const std::string& category, bool found, CheapVariant val)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::ITEM_METADATA);
+	Write((int32_t)item.ItemHash);
+	Write((uint8_t)category.size());
+	m_Buffer.insert(m_Buffer.end(), category.begin(), category.begin() + std::min(category.size(), (size_t)UINT8_MAX));
+	WriteBool(found);
+	Write(val.uiVal);
+}
+
+void TickTraceWriter::RecordItemGrab(const EntityInfo& entity, bool grabbed, const ItemInfo& item)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::ITEM_GRAB);
+	Write((int32_t)entity.EntityHash);
+	WriteBool(grabbed);
+	WriteItemInfo(item);
+}
+
+void TickTraceWriter::RecordPathPoint(const b2Vec2& goal, const b2Vec2& pathPoint)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::NAVMESH_PATH_POINT);
+	WriteVec(goal);
+	WriteVec(pathPoint);
+}
+
+void TickTraceWriter::RecordInventoryAdd(int slotId, const ItemInfo& item, bool succeeded)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::INVENTORY_ADD);
+	Write((int8_t)slotId);
+	Write((int32_t)item.ItemHash);
+	WriteBool(succeeded);
+}
+
+void TickTraceWriter::RecordInventoryUse(int slotId, bool succeeded)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::INVENTORY_USE);
+	Write((int8_t)slotId);
+	WriteBool(succeeded);
+}
+
+void TickTraceWriter::RecordInventoryRemove(int slotId, bool succeeded)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::INVENTORY_REMOVE);
+	Write((int8_t)slotId);
+	WriteBool(succeeded);
+}
+
+void TickTraceWriter::RecordInventoryGet(int slotId, bool succeeded, const ItemInfo& item)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::INVENTORY_GET);
+	Write((int8_t)slotId);
+	WriteBool(succeeded);
+	WriteItemInfo(item);
+}
+
+void TickTraceWriter::RecordInventoryCapacity(int capacity)
+{
+	if (!IsOpen()) return;
+	WriteTag(eTraceRecord::INVENTORY_CAPACITY);
+	Write((int32_t)capacity);
+}
+
+//-----------------------------------------------------------------
+// READER
+//-----------------------------------------------------------------
+bool TickTraceReader::Open(const std::string& path)
+{
+	m_Data.clear();
+	m_LevelPath.clear();
+
+	FILE* pFile = fopen(path.c_str(), "rb");
+	if (pFile == nullptr)
+	{
+		printf("WARNING: Couldn't open trace file '%s'\n", path.c_str());
+		return false;
+	}
+
+	fseek(pFile, 0, SEEK_END);
+	const long size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	if (size > 0)
+	{
+		m_Data.resize((size_t)size);
+		if (fread(m_Data.data(), 1, m_Data.size(), pFile) != m_Data.size())
+		{
+			m_Data.clear();
+		}
+	}
+	fclose(pFile);
+
+	size_t headerSize = sizeof(TraceMagic) + sizeof(TraceVersion) + sizeof(uint32_t);
+	if (m_Data.size() < headerSize || memcmp(m_Data.data(), TraceMagic, sizeof(TraceMagic)) != 0)
+	{
+		printf("WARNING: '%s' is not a tick trace\n", path.c_str());
+		m_Data.clear();
+		return false;
+	}
+
+	uint32_t version;
+	memcpy(&version, &m_Data[sizeof(TraceMagic)], sizeof(version));
+	if (version != TraceVersion)
+	{
+		printf("WARNING: Trace '%s' has version %u, expected %u\n", path.c_str(), version, TraceVersion);
+		m_Data.clear();
+		return false;
+	}
+
+	uint32_t levelPathLength;
+	memcpy(&levelPathLength, &m_Data[headerSize - sizeof(levelPathLength)], sizeof(levelPathLength));
+	if (levelPathLength > MaxLevelPathLength || m_Data.size() < headerSize + levelPathLength)
+	{
+		printf("WARNING: Trace '%s' has a broken header\n", path.c_str());
+		m_Data.clear();
+		return false;
+	}
+	m_LevelPath.assign(reinterpret_cast<const char*>(&m_Data[headerSize]), levelPathLength);
+	headerSize += levelPathLength;
+
+	m_FirstRecord = headerSize;
+	Rewind();
+	return true;
+}
+
+void TickTraceReader::Rewind()
+{
+	m_Cursor = m_FirstRecord;
+	m_Diverged = false;
+	m_TicksReplayed = 0;
+	m_OutputMismatches = 0;
+}
+
+void TickTraceReader::Diverge(const char* reason)
+{
+	if (!m_Diverged)
+	{
+		printf("WARNING: Replay diverged from trace at tick %i: %s\n", m_TicksReplayed, reason);
+		m_Diverged = true;
+	}
+}
+
+bool TickTraceReader::ExpectRecord(eTraceRecord tag)
+{
+	if (m_Diverged)
+		return false;
+
+	if (m_Cursor >= m_Data.size())
+	{
+		Diverge("trace ended");
+		return false;
+	}
+
+	if ((eTraceRecord)m_Data[m_Cursor] != tag)
+	{
+		Diverge("plugin made a different query than recorded");
+		return false;
+	}
+
+	++m_Cursor;
+	return true;
+}
+
+bool TickTraceReader::BeginTick(float& dt)
+{
+	if (m_Diverged || m_Cursor >= m_Data.size())
+		return false;
+
+	if (!ExpectRecord(eTraceRecord::TICK_BEGIN))
+		return false;
+
+	dt = Read<float>();
+	return !m_Diverged;
+}
+
+bool TickTraceReader::EndTick(const PluginOutput& output)
+{
+	if (!ExpectRecord(eTraceRecord::TICK_END))
+		return false;
+
+	PluginOutput recorded;
+	recorded.LinearVelocity = ReadVec();
+	recorded.AngularVelocity = Read<float>();
+	recorded.AutoOrientate = ReadBool();
+	recorded.RunMode = ReadBool();
+	++m_TicksReplayed;
+
+	const bool matches =
+		b2Abs(recorded.LinearVelocity.x - output.LinearVelocity.x) <= OutputTolerance &&
+		b2Abs(recorded.LinearVelocity.y - output.LinearVelocity.y) <= OutputTolerance &&
+		b2Abs(recorded.AngularVelocity - output.AngularVelocity) <= OutputTolerance &&
+		recorded.AutoOrientate == output.AutoOrientate &&
+		recorded.RunMode == output.RunMode;
+	if (!matches)
+	{
+		++m_OutputMismatches;
+	}
+	return matches;
+}
+
+AgentInfo TickTraceReader::ReadAgentInfo()
+{
+	AgentInfo agentInfo = {};
+	if (!ExpectRecord(eTraceRecord::AGENT_INFO))
+		return agentInfo;
+
+	agentInfo.Stamina = Read<float>();
+	agentInfo.Health = Read<float>();
+	agentInfo.Energy = Read<float>();
+	agentInfo.RunMode = ReadBool();
+	agentInfo.GrabRange = Read<float>();
+	agentInfo.IsInHouse = ReadBool();
+	agentInfo.Bitten = ReadBool();
+	agentInfo.Death = ReadBool();
+	agentInfo.FOV_Angle = Read<float>();
+	agentInfo.FOV_Range = Read<float>();
+	agentInfo.LinearVelocity = ReadVec();
+	agentInfo.AngularVelocity = Read<float>();
+	agentInfo.CurrentLinearSpeed = Read<float>();
+	agentInfo.Position = ReadVec();
+	agentInfo.Orientation = Read<float>();
+	agentInfo.MaxLinearSpeed = Read<float>();
+	agentInfo.MaxAngularSpeed = Read<float>();
+	agentInfo.AgentSize = Read<float>();
+	return agentInfo;
+}
+
+WorldInfo TickTraceReader::ReadWorldInfo()
+{
+	WorldInfo worldInfo = {};
+	if (!ExpectRecord(eTraceRecord::WORLD_INFO))
+		return worldInfo;
+
+	worldInfo.Center = ReadVec();
+	worldInfo.Dimensions = ReadVec();
+	return worldInfo;
+}
+
+std::vector<EntityInfo> TickTraceReader::ReadEntities()
+{
+	std::vector<EntityInfo> entities;
+	if (!ExpectRecord(eTraceRecord::FOV_ENTITIES))
+		return entities;
+
+	const uint16_t count = Read<uint16_t>();
+	entities.resize(count);
+	for (uint16_t i = 0; i < count; i++)
+	{
+		entities[i].Type = (eEntityType)Read<uint8_t>();
+		entities[i].EntityHash = Read<int32_t>();
+		entities[i].Position = ReadVec();
+	}
+	return entities;
+}
+
+std::vector<HouseInfo> TickTraceReader::ReadHouses()
+{
+	std::vector<HouseInfo> houses;
+	if (!ExpectRecord(eTraceRecord::FOV_HOUSES))
+		return houses;
+
+	const uint16_t count = Read<uint16_t>();
+	houses.resize(count);
+	for (uint16_t i = 0; i < count; i++)
+	{
+		houses[i].Center = ReadVec();
+		houses[i].Size = ReadVec();
+	}
+	return houses;
+}
+
+bool TickTraceReader::ReadEnemyInfo(const EntityInfo& entity, EnemyInfo& enemy)
+{
+	if (!ExpectRecord(eTraceRecord::ENEMY_INFO))
+		return false;
+
+	if (Read<int32_t>() != entity.EntityHash)
+		Diverge("ENEMY_GetInfo asked about a different entity");
+	const bool found = ReadBool();
+	enemy.EnemyHash = Read<int32_t>();
+	enemy.Health = Read<int32_t>();
+	return found;
+}
+
+bool TickTraceReader::ReadItemMetadata(const ItemInfo& item, const std::string& category, CheapVariant& val)
+{
+	if (!ExpectRecord(eTraceRecord::ITEM_METADATA))
+		return false;
+
+	if (Read<int32_t>() != item.ItemHash)
+		Diverge("ITEM_GetMetadata asked about a different item");
+	const uint8_t categoryLength = Read<uint8_t>();
+	if (m_Cursor + categoryLength > m_Data.size() ||
+		category.compare(0, std::string::npos, (const char*)&m_Data[m_Cursor], categoryLength) != 0)
+	{
+		Diverge("ITEM_GetMetadata asked for a different category");
+	}
+	m_Cursor = std::min(m_Cursor + categoryLength, m_Data.size());
+	const bool found = ReadBool();
+	val.uiVal = Read<UINT>();
+	return found;
+}
+
+bool TickTraceReader::ReadItemGrab(const EntityInfo& entity, ItemInfo& item)
+{
+	if (!ExpectRecord(eTraceRecord::ITEM_GRAB))
+		return false;
+
+	if (Read<int32_t>() != entity.EntityHash)
+		Diverge("ITEM_Grab grabbed a different entity");
+	const bool grabbed = ReadBool();
+	item = ReadItemInfo();
+	return grabbed;
+}
+
+b2Vec2 TickTraceReader::ReadPathPoint(const b2Vec2& goal)
+{
+	if (!ExpectRecord(eTraceRecord::NAVMESH_PATH_POINT))
+		return goal;
+
+	const b2Vec2 recordedGoal = ReadVec();
+	if (b2DistanceSquared(recordedGoal, goal) > OutputTolerance)
+		Diverge("NAVMESH_GetClosestPathPoint asked for a different goal");
+	return ReadVec();
+}
+
+bool TickTraceReader::ReadInventoryAdd(int slotId, const ItemInfo& item)
+{
+	if (!ExpectRecord(eTraceRecord::INVENTORY_ADD))
+		return false;
+
+	if (Read<int8_t>() != slotId || Read<int32_t>() != item.ItemHash)
+		Diverge("INVENTORY_AddItem added a different item");
+	return ReadBool();
+}
+
+bool TickTraceReader::ReadInventoryUse(int slotId)
+{
+	if (!ExpectRecord(eTraceRecord::INVENTORY_USE))
+		return false;
+
+	if (Read<int8_t>() != slotId)
+		Diverge("INVENTORY_UseItem used a different slot");
+	return ReadBool();
+}
+
+bool TickTraceReader::ReadInventoryRemove(int slotId)
+{
+	if (!ExpectRecord(eTraceRecord::INVENTORY_REMOVE))
+		return false;
+
+	if (Read<int8_t>() != slotId)
+		Diverge("INVENTORY_RemoveItem removed a different slot");
+	return ReadBool();
+}
+
+bool TickTraceReader::ReadInventoryGet(int slotId, ItemInfo& item)
+{
+	if (!ExpectRecord(eTraceRecord::INVENTORY_GET))
+		return false;
+
+	if (Read<int8_t>() != slotId)
+		Diverge("INVENTORY_GetItem read a different slot");
+	const bool succeeded = ReadBool();
+	item = ReadItemInfo();
+	return succeeded;
+}
+
+int TickTraceReader::ReadInventoryCapacity()
+{
+	if (!ExpectRecord(eTraceRecord::INVENTORY_CAPACITY))
+		return 0;
+
+	return Read<int32_t>();
+}
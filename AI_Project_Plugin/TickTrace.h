@@ -0,0 +1,155 @@
+#pragma once
+
+#include "HelperStructs.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------
+// TICK TRACE
+// Compact append-only binary log of every framework query the
+// plugin makes (and the answer it got), framed per Update call.
+// Replaying a trace answers the same queries in the same order, so
+// Update runs deterministically without the game.
+//
+// File layout: "TBTR" + uint32 version + the level path the plugin
+// planned paths on (uint32 length + chars, empty for the framework's
+// navmesh), followed by records of [uint8 tag][payload]. All values
+// little endian, no padding.
+//-----------------------------------------------------------------
+enum class eTraceRecord : uint8_t
+{
+	TICK_BEGIN = 1,		// float dt
+	TICK_END,			// PluginOutput returned by Update
+	AGENT_INFO,
+	WORLD_INFO,
+	FOV_ENTITIES,
+	FOV_HOUSES,
+	ENEMY_INFO,			// entity hash, found, EnemyInfo
+	ITEM_METADATA,		// item hash, category, found, raw CheapVariant
+	ITEM_GRAB,			// entity hash, grabbed, ItemInfo
+	NAVMESH_PATH_POINT,	// goal, path point
+	INVENTORY_ADD,		// slot, item hash, succeeded
+	INVENTORY_USE,		// slot, succeeded
+	INVENTORY_REMOVE,	// slot, succeeded
+	INVENTORY_GET,		// slot, succeeded, ItemInfo
+	INVENTORY_CAPACITY
+};
+
+class TickTraceWriter final
+{
+public:
+	TickTraceWriter() {}
+	~TickTraceWriter();
+
+	// levelPath is what TestBoxPlugin::SetLevelPath was given, replays need the same
+	bool Open(const std::string& path, const std::string& levelPath);
+	void Close();
+	bool IsOpen() const { return m_pFile != nullptr; }
+
+	void BeginTick(float dt);
+	void EndTick(const PluginOutput& output);
+
+	void RecordAgentInfo(const AgentInfo& agentInfo);
+	void RecordWorldInfo(const WorldInfo& worldInfo);
+	void RecordEntities(const std::vector<EntityInfo>& entities);
+	void RecordHouses(const std::vector<HouseInfo>& houses);
+	void RecordEnemyInfo(const EntityInfo& entity, bool found, const EnemyInfo& enemy);
+	void RecordItemMetadata(const ItemInfo& item, const std::string& category, bool found, CheapVariant val);
+	void RecordItemGrab(const EntityInfo& entity, bool grabbed, const ItemInfo& item);
+	void RecordPathPoint(const b2Vec2& goal, const b2Vec2& pathPoint);
+	void RecordInventoryAdd(int slotId, const ItemInfo& item, bool succeeded);
+	void RecordInventoryUse(int slotId, bool succeeded);
+	void RecordInventoryRemove(int slotId, bool succeeded);
+	void RecordInventoryGet(int slotId, bool succeeded, const ItemInfo& item);
+	void RecordInventoryCapacity(int capacity);
+
+private:
+	void Flush();
+
+	template<typename T> void Write(T val)
+	{
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&val);
+		m_Buffer.insert(m_Buffer.end(), pBytes, pBytes + sizeof(T));
+	}
+	void WriteTag(eTraceRecord tag) { Write((uint8_t)tag); }
+	void WriteBool(bool val) { Write((uint8_t)(val ? 1 : 0)); }
+	void WriteVec(const b2Vec2& val) { Write(val.x); Write(val.y); }
+	void WriteItemInfo(const ItemInfo& item) { Write((uint8_t)item.Type); Write((int32_t)item.ItemHash); }
+
+	FILE* m_pFile = nullptr;
+	std::vector<uint8_t> m_Buffer; // Written out in large chunks, not per record
+};
+
+class TickTraceReader final
+{
+public:
+	TickTraceReader() {}
+	~TickTraceReader() {}
+
+	// Reads the whole trace into memory so replay timings don't include disk IO
+	bool Open(const std::string& path);
+	bool IsOpen() const { return !m_Data.empty(); }
+
+	// Returns false once the trace has no more complete ticks
+	bool BeginTick(float& dt);
+	// Compares the plugin's output with the recorded one, true when they match
+	bool EndTick(const PluginOutput& output);
+	// Rewinds to the first record so a trace can be replayed repeatedly
+	void Rewind();
+	// The level the recording plugin planned paths on, empty if it used the framework's navmesh
+	const std::string& GetLevelPath() const { return m_LevelPath; }
+
+	// Each answer consumes the next record, a record of the wrong kind
+	// (or for a different argument) means the replay has diverged
+	AgentInfo ReadAgentInfo();
+	WorldInfo ReadWorldInfo();
+	std::vector<EntityInfo> ReadEntities();
+	std::vector<HouseInfo> ReadHouses();
+	bool ReadEnemyInfo(const EntityInfo& entity, EnemyInfo& enemy);
+	bool ReadItemMetadata(const ItemInfo& item, const std::string& category, CheapVariant& val);
+	bool ReadItemGrab(const EntityInfo& entity, ItemInfo& item);
+	b2Vec2 ReadPathPoint(const b2Vec2& goal);
+	bool ReadInventoryAdd(int slotId, const ItemInfo& item);
+	bool ReadInventoryUse(int slotId);
+	bool ReadInventoryRemove(int slotId);
+	bool ReadInventoryGet(int slotId, ItemInfo& item);
+	int ReadInventoryCapacity();
+
+	bool HasDiverged() const { return m_Diverged; }
+	int GetTicksReplayed() const { return m_TicksReplayed; }
+	int GetOutputMismatches() const { return m_OutputMismatches; }
+
+private:
+	bool ExpectRecord(eTraceRecord tag);
+	void Diverge(const char* reason);
+
+	template<typename T> T Read()
+	{
+		T val = {};
+		if (m_Cursor + sizeof(T) <= m_Data.size())
+		{
+			memcpy(&val, &m_Data[m_Cursor], sizeof(T));
+			m_Cursor += sizeof(T);
+		}
+		else
+		{
+			Diverge("trace ended mid record");
+		}
+		return val;
+	}
+	bool ReadBool() { return Read<uint8_t>() != 0; }
+	b2Vec2 ReadVec() { b2Vec2 val; val.x = Read<float>(); val.y = Read<float>(); return val; }
+	ItemInfo ReadItemInfo() { ItemInfo item; item.Type = (eItemType)Read<uint8_t>(); item.ItemHash = Read<int32_t>(); return item; }
+
+	std::vector<uint8_t> m_Data;
+	std::string m_LevelPath;
+	size_t m_Cursor = 0;
+	size_t m_FirstRecord = 0;
+
+	bool m_Diverged = false;
+	int m_TicksReplayed = 0;
+	int m_OutputMismatches = 0;
+};
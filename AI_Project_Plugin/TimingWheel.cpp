@@ -0,0 +1,175 @@
+#include "stdafx.h"
+
+#include "TimingWheel.h"
+
+#include <cmath>
+
+TimingWheel::TimingWheel()
+{
+	Clear();
+}
+
+TimerHandle TimingWheel::Schedule(float dueTime, const TimerEvent& event)
+{
+	int timerIndex = m_FirstFree;
+	if (timerIndex != -1)
+	{
+		m_FirstFree = m_Timers[timerIndex].Next;
+	}
+	else
+	{
+		timerIndex = (int)m_Timers.size();
+		m_Timers.push_back({});
+	}
+
+	Timer& timer = m_Timers[timerIndex];
+	timer.Event = event;
+	timer.DueTick = ToTick(dueTime);
+	timer.Cancelled = false;
+	Insert(timerIndex);
+	++m_PendingCount;
+
+	TimerHandle handle;
+	handle.Index = timerIndex;
+	handle.Generation = timer.Generation;
+	return handle;
+}
+
+bool TimingWheel::Cancel(const TimerHandle& handle)
+{
+	if (handle.Index < 0 || handle.Index >= (int)m_Timers.size())
+		return false;
+
+	Timer& timer = m_Timers[handle.Index];
+	if (timer.Generation != handle.Generation || timer.Cancelled)
+		return false;
+
+	timer.Cancelled = true;
+	--m_PendingCount;
+	return true;
+}
+
+void TimingWheel::Advance(float now, std::vector<TimerEvent>& fired)
+{
+	Fire(m_Overdue, fired);
+
+	const uint32_t lastTick = ToTick(now);
+	if (m_PendingCount == 0)
+	{
+		// Nothing to cascade or fire on the way
+		if (lastTick >= m_NextTick) m_NextTick = lastTick + 1;
+		return;
+	}
+
+	while (m_NextTick <= lastTick)
+	{
+		const int index = (int)(m_NextTick & (SlotsPerLevel - 1));
+		if (index == 0)
+		{
+			// Entering a new span of the level above, bring its timers down
+			for (int level = 1; level < LevelCount; level++)
+			{
+				const int slot = (int)((m_NextTick >> (LevelBits * level)) & (SlotsPerLevel - 1));
+				Cascade(level, slot);
+				if (slot != 0) break;
+			}
+		}
+
+		Fire(m_Slots[0][index], fired);
+		++m_NextTick;
+	}
+}
+
+void TimingWheel::Clear()
+{
+	// The timers stay allocated, free, with a new generation
+	m_FirstFree = -1;
+	for (int i = (int)m_Timers.size() - 1; i >= 0; i--)
+	{
+		++m_Timers[i].Generation;
+		m_Timers[i].Next = m_FirstFree;
+		m_FirstFree = i;
+	}
+	for (int level = 0; level < LevelCount; level++)
+	{
+		for (int slot = 0; slot < SlotsPerLevel; slot++)
+		{
+			m_Slots[level][slot] = -1;
+		}
+	}
+	m_Overdue = -1;
+	m_NextTick = 0;
+	m_PendingCount = 0;
+}
+
+uint32_t TimingWheel::ToTick(float time)
+{
+	const double tick = std::floor((double)time * TicksPerSecond);
+	if (tick <= 0.0) return 0;
+	if (tick >= (double)(UINT32_MAX - 1)) return UINT32_MAX - 1;
+	return (uint32_t)tick;
+}
+
+void TimingWheel::Insert(int timerIndex)
+{
+	Timer& timer = m_Timers[timerIndex];
+
+	if (timer.DueTick < m_NextTick)
+	{
+		timer.Next = m_Overdue;
+		m_Overdue = timerIndex;
+		return;
+	}
+
+	// Timers too far out wait in the top level and get placed again every time it cascades
+	uint32_t placedTick = timer.DueTick;
+	uint32_t delta = placedTick - m_NextTick;
+	if (delta > MaxDelta)
+	{
+		placedTick = m_NextTick + MaxDelta;
+		delta = MaxDelta;
+	}
+
+	int level = 0;
+	while (level < LevelCount - 1 && delta >= (1u << (LevelBits * (level + 1))))
+	{
+		++level;
+	}
+
+	const int slot = (int)((placedTick >> (LevelBits * level)) & (SlotsPerLevel - 1));
+	timer.Next = m_Slots[level][slot];
+	m_Slots[level][slot] = timerIndex;
+}
+
+void TimingWheel::Fire(int& slot, std::vector<TimerEvent>& fired)
+{
+	int timerIndex = slot;
+	slot = -1;
+	while (timerIndex != -1)
+	{
+		Timer& timer = m_Timers[timerIndex];
+		const int next = timer.Next;
+		if (!timer.Cancelled)
+		{
+			fired.push_back(timer.Event);
+			--m_PendingCount;
+		}
+
+		++timer.Generation;
+		timer.Next = m_FirstFree;
+		m_FirstFree = timerIndex;
+		timerIndex = next;
+	}
+}
+
+void TimingWheel::Cascade(int level, int slot)
+{
+	int timerIndex = m_Slots[level][slot];
+	m_Slots[level][slot] = -1;
+	while (timerIndex != -1)
+	{
+		const int next = m_Timers[timerIndex].Next;
+		Insert(timerIndex);
+		timerIndex = next;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// What a timer stands for is up to whoever scheduled it
+struct TimerEvent
+{
+	int Kind;
+	int Id;
+};
+
+// Names one scheduled timer for Cancel. Stays safe to use after the timer fired
+// or was cancelled, Cancel then does nothing
+struct TimerHandle
+{
+	int Index = -1;
+	uint32_t Generation = 0;
+};
+
+//-----------------------------------------------------------------
+// TIMING WHEEL
+// Hierarchical timing wheel keyed on absolute time in seconds. Time is
+// cut into ticks of 1/TicksPerSecond; level 0 has a slot per tick for
+// the next 64 ticks, every level above covers 64 times the span of the
+// one below, and a timer moves down a level whenever the wheel reaches
+// its slot. Scheduling and firing are O(1) per timer and Advance only
+// touches the slots it passes, so nothing is done for timers that
+// aren't due.
+// Timers fire on the first Advance at or after their due time, or up
+// to one tick before it. Callers that need the exact moment check it
+// themselves and schedule again if it's too early.
+// Cancelling only marks the timer, it's dropped when the wheel gets to
+// its slot.
+//-----------------------------------------------------------------
+class TimingWheel final
+{
+public:
+	static const int TicksPerSecond = 64;
+
+	TimingWheel();
+	~TimingWheel() {}
+
+	TimerHandle Schedule(float dueTime, const TimerEvent& event);
+	// Returns false if the timer already fired or was cancelled
+	bool Cancel(const TimerHandle& handle);
+	// Moves the wheel up to now and appends every timer that came due to fired
+	void Advance(float now, std::vector<TimerEvent>& fired);
+	// Drops every timer and rewinds to 0, handles from before don't cancel anything
+	void Clear();
+
+	// Scheduled, not fired and not cancelled
+	int GetPendingCount() const { return m_PendingCount; }
+
+private:
+	static const int LevelBits = 6;
+	static const int SlotsPerLevel = 1 << LevelBits;
+	static const int LevelCount = 4;
+	static const uint32_t MaxDelta = (1u << (LevelBits * LevelCount)) - 1;
+
+	struct Timer
+	{
+		TimerEvent Event;
+		uint32_t DueTick;
+		uint32_t Generation; // Bumped when the timer is freed, so old handles stop matching
+		int Next; // Next timer in the same slot, or in the free list
+		bool Cancelled;
+	};
+
+	static uint32_t ToTick(float time);
+
+	void Insert(int timerIndex);
+	// Appends a slot's timers that weren't cancelled to fired and frees them all
+	void Fire(int& slot, std::vector<TimerEvent>& fired);
+	// Re-inserts every timer of a slot on the given level, they all land lower down
+	void Cascade(int level, int slot);
+
+	std::vector<Timer> m_Timers;
+	int m_FirstFree = -1;
+	int m_Slots[LevelCount][SlotsPerLevel]; // First timer in each slot, -1 if empty
+	int m_Overdue = -1; // Timers whose tick Advance already passed, fired on the next Advance
+	uint32_t m_NextTick = 0; // The next tick Advance will process
+	int m_PendingCount = 0;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+//-----------------------------------------------------------------
+// WORLD CACHE
+// Densely packed list of known entities, keyed by EntityHash or
+// EnemyHash. Lookup, insert and removal are O(1): removal moves the
+// last element into the hole, so element order isn't stable.
+// Iterates like a std::vector so behaviours can loop over it.
+// GetRevision counts adds and removals, so whoever hands the cache to
+// a blackboard knows when to Touch it. Edits to elements through Find
+// or operator[] aren't counted.
+//-----------------------------------------------------------------
+template<typename T>
+class WorldCache final
+{
+public:
+	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T>::const_iterator const_iterator;
+
+	T* Find(int key)
+	{
+		auto it = m_Indices.find(key);
+		return it != m_Indices.end() ? &m_Items[it->second] : nullptr;
+	}
+	const T* Find(int key) const
+	{
+		auto it = m_Indices.find(key);
+		return it != m_Indices.end() ? &m_Items[it->second] : nullptr;
+	}
+	bool Contains(int key) const
+	{
+		return m_Indices.find(key) != m_Indices.end();
+	}
+
+	// Returns false (and leaves the cached element alone) if key is already known
+	bool Add(int key, const T& item)
+	{
+		if (!m_Indices.emplace(key, m_Items.size()).second)
+			return false;
+
+		m_Items.push_back(item);
+		m_Keys.push_back(key);
+		++m_Revision;
+		return true;
+	}
+
+	bool Remove(int key)
+	{
+		auto it = m_Indices.find(key);
+		if (it == m_Indices.end())
+			return false;
+
+		RemoveAt(it->second);
+		return true;
+	}
+
+	void RemoveAt(size_t index)
+	{
+		const size_t last = m_Items.size() - 1;
+		m_Indices.erase(m_Keys[index]);
+		if (index != last)
+		{
+			m_Items[index] = m_Items[last];
+			m_Keys[index] = m_Keys[last];
+			m_Indices[m_Keys[index]] = index;
+		}
+		m_Items.pop_back();
+		m_Keys.pop_back();
+		++m_Revision;
+	}
+
+	void Clear()
+	{
+		m_Items.clear();
+		m_Keys.clear();
+		m_Indices.clear();
+		++m_Revision;
+	}
+
+	int KeyAt(size_t index) const { return m_Keys[index]; }
+	unsigned int GetRevision() const { return m_Revision; }
+
+	// std::vector style access to the packed elements
+	size_t size() const { return m_Items.size(); }
+	bool empty() const { return m_Items.empty(); }
+	T& at(size_t index) { return m_Items.at(index); }
+	const T& at(size_t index) const { return m_Items.at(index); }
+	T& operator[](size_t index) { return m_Items[index]; }
+	const T& operator[](size_t index) const { return m_Items[index]; }
+	iterator begin() { return m_Items.begin(); }
+	iterator end() { return m_Items.end(); }
+	const_iterator begin() const { return m_Items.begin(); }
+	const_iterator end() const { return m_Items.end(); }
+
+private:
+	std::vector<T> m_Items;
+	std::vector<int> m_Keys; // Key of the element at the same index
+	std::unordered_map<int, size_t> m_Indices; // Key -> index into m_Items
+	unsigned int m_Revision = 0;
+};
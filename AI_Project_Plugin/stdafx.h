@@ -9,6 +9,15 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_syswm.h>
 
+#include <string>
+#include <memory>
+#include <cstdio>
+#include <cfloat>
+
+#ifndef _WIN32
+typedef unsigned int UINT; // Pulled in through windows.h by SDL_syswm on Windows
+#endif
+
 #undef min
 #undef max
 